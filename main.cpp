@@ -9,470 +9,8025 @@
 #include <memory>
 #include <thread>
 #include <mutex>
+#include <atomic>
 #include <future>
 #include <chrono>
 #include <filesystem>
 #include <queue>
+#include <deque>
+#include <list>
+#include <condition_variable>
 #include <iomanip>
+#include <functional>
+#include <cstdint>
+#include <limits>
+#include <cmath>
+#include <string_view>
+#include <array>
+#include <cstring>
+#include <type_traits>
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+#if defined(__SSE2__) || defined(_M_X64)
+#include <emmintrin.h>
+#endif
 
 using namespace std;
 
 /**
- * @brief Estructura para almacenar información de una película
+ * @brief Película encontrada por una consulta, con su puntuación local a esa consulta
  */
-struct Pelicula {
-    string titulo;
-    string sinopsis;
-    vector<string> tags;
-    string split;
-    string fuente_sinopsis;
-    double relevancia = 0.0;
-
-    Pelicula() = default;
-    Pelicula(const string& t, const string& s, const vector<string>& tgs,
-             const string& sp, const string& fs)
-        : titulo(t), sinopsis(s), tags(tgs), split(sp), fuente_sinopsis(fs) {}
+struct ResultadoBusqueda {
+    uint32_t id;         // Posición de la película en el catálogo
+    double puntuacion;
 };
 
+using ResultadosBusqueda = vector<ResultadoBusqueda>;
+
 /**
- * @brief Nodo genérico para el Trie
+ * @brief Normalización y tokenización de texto UTF-8, la misma al indexar y al consultar
+ *
+ * Pasa a minúsculas (también las letras latinas acentuadas, las griegas y las
+ * cirílicas), quita los acentos de las latinas ("Amélie" → "amelie", "Straße" →
+ * "strasse", también en forma descompuesta) y trata como separador todo lo que no
+ * es letra ni dígito, así "Batman," y "batman" son la misma palabra. Los demás
+ * alfabetos se conservan tal cual. Ningún carácter se alarga al normalizarse, así
+ * que el resultado nunca ocupa más que el texto original.
+ *
+ * El texto ASCII se procesa de a 16 bytes con SSE2; solo los bloques con bytes
+ * no ASCII pasan por el decodificador.
  */
-template<typename T>
-class TrieNode {
+class NormalizadorTexto {
 public:
-    unordered_map<char, unique_ptr<TrieNode<T>>> children;
-    vector<T*> elementos;
-    bool esFinDePalabra = false;
+    /**
+     * @brief Llama a visitar(token) por cada palabra normalizada de 'texto'
+     *
+     * Los tokens son vistas sobre 'buffer', que se reutiliza entre llamadas: no se
+     * asigna memoria por palabra. Solo son válidos durante la visita.
+     */
+    template<typename Visitante>
+    static void paraCadaToken(string_view texto, string& buffer, Visitante&& visitar) {
+        normalizarEn(texto, buffer, true);
+        const char* p = buffer.data();
+        const char* fin = p + buffer.size();
+        while (p < fin) {
+            while (p < fin && *p == ' ') ++p;
+            const char* inicio = p;
+            while (p < fin && *p != ' ') ++p;
+            if (p > inicio) visitar(string_view(inicio, static_cast<size_t>(p - inicio)));
+        }
+    }
 
-    TrieNode() = default;
-    ~TrieNode() = default;
-};
+    /**
+     * @brief Palabras normalizadas de 'texto' unidas por un espacio ("¡Amélie!" → "amelie")
+     */
+    static string normalizar(string_view texto) {
+        string buffer;
+        string resultado;
+        paraCadaToken(texto, buffer, [&resultado](string_view token) {
+            if (!resultado.empty()) resultado += ' ';
+            resultado.append(token);
+        });
+        return resultado;
+    }
 
-/**
- * @brief Clase genérica para manejo de Trie
- */
-template<typename T>
-class Trie {
-private:
-    unique_ptr<TrieNode<T>> raiz;
-    mutable mutex trie_mutex;
+    /**
+     * @brief Minúsculas y sin acentos, pero conservando la puntuación ("Sci-Fi" → "sci-fi")
+     *
+     * Es la forma de los nombres de tags, en el CSV y en las consultas.
+     */
+    static void normalizarTag(string_view tag, string& destino) {
+        normalizarEn(tag, destino, false);
+    }
 
-public:
-    Trie() : raiz(make_unique<TrieNode<T>>()) {}
+    static string normalizarTag(string_view tag) {
+        string destino;
+        normalizarEn(tag, destino, false);
+        return destino;
+    }
 
-    void insertar(const string& palabra, T* elemento) {
-        lock_guard<mutex> lock(trie_mutex);
-        auto actual = raiz.get();
-        string palabraLimpia = toLower(palabra);
+    /**
+     * @brief true si 'texto' ya está normalizado como tag (ASCII sin mayúsculas)
+     */
+    static bool esTagNormalizado(string_view texto) {
+        return none_of(texto.begin(), texto.end(), [](char c) {
+            const unsigned char u = static_cast<unsigned char>(c);
+            return u >= 0x80 || (u >= 'A' && u <= 'Z');
+        });
+    }
 
-        for (char c : palabraLimpia) {
-            if (actual->children.find(c) == actual->children.end()) {
-                actual->children[c] = make_unique<TrieNode<T>>();
+private:
+    /**
+     * @brief Escribe en 'destino' el texto normalizado; con separarPuntuacion todo
+     *        lo que no es letra ni dígito queda como ' '
+     */
+    static void normalizarEn(string_view texto, string& destino, bool separarPuntuacion) {
+        destino.resize(texto.size());
+        const unsigned char* p = reinterpret_cast<const unsigned char*>(texto.data());
+        const unsigned char* fin = p + texto.size();
+        char* salida = &destino[0];
+        char* const inicioSalida = salida;
+
+        while (p < fin) {
+#if defined(__SSE2__) || defined(_M_X64)
+            if (separarPuntuacion && fin - p >= 16) {
+                const __m128i bloque = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p));
+                if (_mm_movemask_epi8(bloque) == 0) {
+                    _mm_storeu_si128(reinterpret_cast<__m128i*>(salida), minusculasAscii(bloque));
+                    p += 16;
+                    salida += 16;
+                    continue;
+                }
+            }
+#endif
+            if (*p < 0x80) {
+                salida = escribirAscii(*p++, salida, separarPuntuacion);
+            } else {
+                salida = escribirCodigo(decodificar(p, fin), salida, separarPuntuacion);
             }
-            actual = actual->children[c].get();
-            actual->elementos.push_back(elemento);
         }
-        actual->esFinDePalabra = true;
+        destino.resize(static_cast<size_t>(salida - inicioSalida));
     }
 
-    vector<T*> buscarPorPrefijo(const string& prefijo) const {
-        lock_guard<mutex> lock(trie_mutex);
-        auto actual = raiz.get();
-        string prefijoLimpio = toLower(prefijo);
+#if defined(__SSE2__) || defined(_M_X64)
+    /**
+     * @brief Minúsculas de 16 bytes ASCII; lo que no es letra ni dígito pasa a ' '
+     */
+    static __m128i minusculasAscii(__m128i bloque) {
+        const __m128i mayuscula = _mm_and_si128(_mm_cmpgt_epi8(bloque, _mm_set1_epi8('A' - 1)),
+                                                _mm_cmplt_epi8(bloque, _mm_set1_epi8('Z' + 1)));
+        const __m128i letras = _mm_or_si128(bloque, _mm_and_si128(mayuscula, _mm_set1_epi8(0x20)));
+        const __m128i minuscula = _mm_and_si128(_mm_cmpgt_epi8(letras, _mm_set1_epi8('a' - 1)),
+                                                _mm_cmplt_epi8(letras, _mm_set1_epi8('z' + 1)));
+        const __m128i digito = _mm_and_si128(_mm_cmpgt_epi8(letras, _mm_set1_epi8('0' - 1)),
+                                             _mm_cmplt_epi8(letras, _mm_set1_epi8('9' + 1)));
+        const __m128i palabra = _mm_or_si128(minuscula, digito);
+        return _mm_or_si128(_mm_and_si128(palabra, letras), _mm_andnot_si128(palabra, _mm_set1_epi8(' ')));
+    }
+#endif
 
-        for (char c : prefijoLimpio) {
-            if (actual->children.find(c) == actual->children.end()) {
-                return {};
-            }
-            actual = actual->children[c].get();
+    static char* escribirAscii(unsigned char c, char* salida, bool separarPuntuacion) {
+        if (c >= 'A' && c <= 'Z') {
+            *salida++ = static_cast<char>(c + ('a' - 'A'));
+        } else if (!separarPuntuacion || (c >= 'a' && c <= 'z') || (c >= '0' && c <= '9')) {
+            *salida++ = static_cast<char>(c);
+        } else {
+            *salida++ = ' ';
         }
-        return actual->elementos;
+        return salida;
     }
 
-    vector<T*> buscarPalabraExacta(const string& palabra) const {
-        lock_guard<mutex> lock(trie_mutex);
-        auto actual = raiz.get();
-        string palabraLimpia = toLower(palabra);
+    /**
+     * @brief Decodifica un código UTF-8 y avanza 'p'; un byte inválido devuelve SEPARADOR
+     */
+    static uint32_t decodificar(const unsigned char*& p, const unsigned char* fin) {
+        const unsigned char primero = *p++;
+        size_t continuaciones;
+        uint32_t codigo;
+        if (primero >= 0xC2 && primero <= 0xDF) {
+            continuaciones = 1;
+            codigo = primero & 0x1F;
+        } else if (primero >= 0xE0 && primero <= 0xEF) {
+            continuaciones = 2;
+            codigo = primero & 0x0F;
+        } else if (primero >= 0xF0 && primero <= 0xF4) {
+            continuaciones = 3;
+            codigo = primero & 0x07;
+        } else {
+            return SEPARADOR;
+        }
+        if (static_cast<size_t>(fin - p) < continuaciones) {
+            p = fin;
+            return SEPARADOR;
+        }
+        for (size_t i = 0; i < continuaciones; ++i) {
+            if ((p[i] & 0xC0) != 0x80) {
+                p += i;
+                return SEPARADOR;
+            }
+            codigo = (codigo << 6) | (p[i] & 0x3F);
+        }
+        p += continuaciones;
+        return codigo;
+    }
 
-        for (char c : palabraLimpia) {
-            if (actual->children.find(c) == actual->children.end()) {
-                return {};
+    static char* escribirCodigo(uint32_t codigo, char* salida, bool separarPuntuacion) {
+        if (codigo >= 0xC0 && codigo < 0x180 && (separarPuntuacion || (codigo != 0xD7 && codigo != 0xF7))) {
+            for (const char* c = LATINAS[codigo - 0xC0]; *c; ++c) {
+                *salida++ = *c;
             }
-            actual = actual->children[c].get();
+            return salida;
+        }
+        if (codigo >= 0x300 && codigo < 0x370) {
+            return salida; // Acentos combinables (texto en forma descompuesta)
         }
-        return actual->esFinDePalabra ? actual->elementos : vector<T*>{};
+        if (codigo >= 0x391 && codigo <= 0x3AB && codigo != 0x3A2) {
+            codigo += 0x20; // Griego
+        } else if (codigo >= 0x410 && codigo <= 0x42F) {
+            codigo += 0x20; // Cirílico
+        } else if (codigo >= 0x400 && codigo <= 0x40F) {
+            codigo += 0x50;
+        } else if (codigo == SEPARADOR || (separarPuntuacion && esPuntuacion(codigo))) {
+            *salida++ = ' ';
+            return salida;
+        }
+        return codificar(codigo, salida);
     }
 
-private:
-    string toLower(const string& str) const {
-        string result = str;
-        transform(result.begin(), result.end(), result.begin(), ::tolower);
-        return result;
+    /**
+     * @brief Signos y espacios fuera de ASCII: Latin-1 (¡ ¿ « » nbsp), puntuación general (“ ” — …) y CJK
+     */
+    static bool esPuntuacion(uint32_t codigo) {
+        return codigo < 0xC0 || (codigo >= 0x2000 && codigo <= 0x206F) ||
+               (codigo >= 0x3000 && codigo <= 0x303F) || codigo == 0xFEFF;
+    }
+
+    static char* codificar(uint32_t codigo, char* salida) {
+        if (codigo < 0x800) {
+            *salida++ = static_cast<char>(0xC0 | (codigo >> 6));
+        } else if (codigo < 0x10000) {
+            *salida++ = static_cast<char>(0xE0 | (codigo >> 12));
+            *salida++ = static_cast<char>(0x80 | ((codigo >> 6) & 0x3F));
+        } else {
+            *salida++ = static_cast<char>(0xF0 | (codigo >> 18));
+            *salida++ = static_cast<char>(0x80 | ((codigo >> 12) & 0x3F));
+            *salida++ = static_cast<char>(0x80 | ((codigo >> 6) & 0x3F));
+        }
+        *salida++ = static_cast<char>(0x80 | (codigo & 0x3F));
+        return salida;
     }
+
+    static constexpr uint32_t SEPARADOR = 0xFFFFFFFF;
+
+    // Forma sin acento y en minúsculas de U+00C0..U+017F (Latin-1 y Latin Extended-A)
+    static constexpr const char* LATINAS[0xC0] = {
+        "a", "a", "a", "a", "a", "a", "ae", "c", "e", "e", "e", "e", "i", "i", "i", "i", // U+00C0
+        "d", "n", "o", "o", "o", "o", "o", " ", "o", "u", "u", "u", "u", "y", "th", "ss", // U+00D0
+        "a", "a", "a", "a", "a", "a", "ae", "c", "e", "e", "e", "e", "i", "i", "i", "i", // U+00E0
+        "d", "n", "o", "o", "o", "o", "o", " ", "o", "u", "u", "u", "u", "y", "th", "y", // U+00F0
+        "a", "a", "a", "a", "a", "a", "c", "c", "c", "c", "c", "c", "c", "c", "d", "d", // U+0100
+        "d", "d", "e", "e", "e", "e", "e", "e", "e", "e", "e", "e", "g", "g", "g", "g", // U+0110
+        "g", "g", "g", "g", "h", "h", "h", "h", "i", "i", "i", "i", "i", "i", "i", "i", // U+0120
+        "i", "i", "ij", "ij", "j", "j", "k", "k", "k", "l", "l", "l", "l", "l", "l", "l", // U+0130
+        "l", "l", "l", "n", "n", "n", "n", "n", "n", "n", "n", "n", "o", "o", "o", "o", // U+0140
+        "o", "o", "oe", "oe", "r", "r", "r", "r", "r", "r", "s", "s", "s", "s", "s", "s", // U+0150
+        "s", "s", "t", "t", "t", "t", "t", "t", "u", "u", "u", "u", "u", "u", "u", "u", // U+0160
+        "u", "u", "u", "u", "w", "w", "y", "y", "y", "z", "z", "z", "z", "z", "z", "s", // U+0170
+    };
 };
 
 /**
- * @brief Clase genérica para índices de búsqueda
+ * @brief Grupo de hilos persistente con robo de tareas
+ *
+ * Cada hilo tiene su propia cola: toma las tareas de su cola desde el final (la
+ * más reciente, con los datos aún en caché) y, cuando se vacía, roba desde el
+ * principio de la cola de otro. Las tareas enviadas desde fuera del grupo se
+ * reparten por turnos. Quien espera un resultado (esperar, paraCada) ejecuta
+ * tareas pendientes mientras tanto, así que una tarea puede enviar y esperar
+ * subtareas sin bloquear el grupo.
  */
-template<typename T, typename KeyType = string>
-class IndiceGenerico {
+class GrupoHilos {
 private:
-    unordered_map<KeyType, vector<T*>> indice;
-    mutable mutex indice_mutex;
+    struct Cola {
+        mutex cola_mutex;
+        deque<function<void()>> tareas;
+    };
+
+    vector<unique_ptr<Cola>> colas;
+    vector<thread> hilos;
+    atomic<size_t> pendientes{0};
+    atomic<size_t> turno{0};
+    mutex espera_mutex;
+    condition_variable hayTareas;
+    bool detener = false;
+
+    // Hilo del grupo que ejecuta el código actual (nullptr fuera de cualquier grupo)
+    static inline thread_local const GrupoHilos* grupoActual = nullptr;
+    static inline thread_local size_t colaActual = 0;
 
 public:
-    void agregar(const KeyType& clave, T* elemento) {
-        lock_guard<mutex> lock(indice_mutex);
-        indice[clave].push_back(elemento);
-    }
-
-    vector<T*> buscar(const KeyType& clave) const {
-        lock_guard<mutex> lock(indice_mutex);
-        auto it = indice.find(clave);
-        return (it != indice.end()) ? it->second : vector<T*>{};
+    /**
+     * @param numHilos Cantidad de hilos (0 = hardware_concurrency())
+     */
+    explicit GrupoHilos(size_t numHilos = 0) {
+        if (numHilos == 0) {
+            numHilos = max<unsigned>(1, thread::hardware_concurrency());
+        }
+        for (size_t i = 0; i < numHilos; ++i) {
+            colas.push_back(make_unique<Cola>());
+        }
+        for (size_t i = 0; i < numHilos; ++i) {
+            hilos.emplace_back([this, i]() { trabajar(i); });
+        }
     }
 
-    vector<KeyType> obtenerClaves() const {
-        lock_guard<mutex> lock(indice_mutex);
-        vector<KeyType> claves;
-        for (const auto& par : indice) {
-            claves.push_back(par.first);
+    ~GrupoHilos() {
+        {
+            lock_guard<mutex> lock(espera_mutex);
+            detener = true;
+        }
+        hayTareas.notify_all();
+        for (auto& hilo : hilos) {
+            hilo.join();
         }
-        return claves;
     }
-};
-
-/**
- * @brief Sistema de puntuación para ranking de películas
- */
-class SistemaPuntuacion {
-public:
-    static double calcularPuntuacion(const Pelicula& pelicula, const string& termino, size_t totalPeliculas) {
-        double puntuacion = 0.0;
-        string terminoLower = toLower(termino);
 
-        // Frecuencia del término en título (peso mayor)
-        string tituloLower = toLower(pelicula.titulo);
-        size_t frecuenciaTitulo = contarOcurrencias(tituloLower, terminoLower);
-        puntuacion += frecuenciaTitulo * 3.0;
+    GrupoHilos(const GrupoHilos&) = delete;
+    GrupoHilos& operator=(const GrupoHilos&) = delete;
 
-        // Frecuencia del término en sinopsis
-        string sinopsisLower = toLower(pelicula.sinopsis);
-        size_t frecuenciaSinopsis = contarOcurrencias(sinopsisLower, terminoLower);
-        puntuacion += frecuenciaSinopsis * 1.0;
+    size_t size() const {
+        return hilos.size();
+    }
 
-        // Bonus por coincidencia exacta en título
-        if (tituloLower == terminoLower) {
-            puntuacion += 10.0;
+    /**
+     * @brief Encola una tarea y devuelve el futuro de su resultado
+     */
+    template<typename F>
+    auto enviar(F&& tarea) -> future<invoke_result_t<decay_t<F>>> {
+        using Resultado = invoke_result_t<decay_t<F>>;
+        auto empaquetada = make_shared<packaged_task<Resultado()>>(forward<F>(tarea));
+        future<Resultado> resultado = empaquetada->get_future();
+
+        const size_t destino = (grupoActual == this) ? colaActual : turno.fetch_add(1) % colas.size();
+        pendientes.fetch_add(1); // Antes de encolar: quien la tome la descuenta
+        {
+            lock_guard<mutex> lock(colas[destino]->cola_mutex);
+            colas[destino]->tareas.emplace_back([empaquetada]() { (*empaquetada)(); });
+        }
+        {
+            // Vacío a propósito: un hilo que ya evaluó 'pendientes' está dentro de wait()
+            lock_guard<mutex> lock(espera_mutex);
         }
+        hayTareas.notify_one();
+        return resultado;
+    }
 
-        // Bonus por coincidencia en tags
-        for (const auto& tag : pelicula.tags) {
-            if (toLower(tag) == terminoLower) {
-                puntuacion += 5.0;
-                break;
+    /**
+     * @brief Espera un futuro de este grupo ejecutando otras tareas mientras tanto
+     */
+    template<typename T>
+    T esperar(future<T>& resultado) {
+        while (resultado.wait_for(chrono::seconds(0)) != future_status::ready) {
+            // Sin tareas en cola, la que falta ya la está ejecutando otro hilo
+            if (!ejecutarUna()) {
+                resultado.wait();
             }
         }
+        return resultado.get();
+    }
+
+    /**
+     * @brief Ejecuta cuerpo(i) para cada i en [0, n) y espera a que terminen todos
+     *
+     * Quien llama también toma índices, de a uno y en orden, igual que los
+     * ayudantes encolados; un ayudante que arranca tarde no encuentra nada que
+     * hacer. Si algún cuerpo lanza una excepción, se relanza la primera.
+     */
+    template<typename F>
+    void paraCada(size_t n, F&& cuerpo) {
+        if (n == 0) return;
+        struct Estado {
+            atomic<size_t> siguiente{0};
+            atomic<size_t> ayudantesActivos{0};
+            mutex error_mutex;
+            exception_ptr error;
+        };
+        auto estado = make_shared<Estado>();
+        auto procesar = [estado, &cuerpo, n]() {
+            for (size_t i = estado->siguiente.fetch_add(1); i < n; i = estado->siguiente.fetch_add(1)) {
+                try {
+                    cuerpo(i);
+                } catch (...) {
+                    lock_guard<mutex> lock(estado->error_mutex);
+                    if (!estado->error) estado->error = current_exception();
+                }
+            }
+        };
 
-        return puntuacion;
+        const size_t ayudantes = min(n, hilos.size()) - 1;
+        vector<future<void>> terminados;
+        for (size_t h = 0; h < ayudantes; ++h) {
+            terminados.push_back(enviar(procesar));
+        }
+        procesar();
+        for (auto& terminado : terminados) {
+            esperar(terminado);
+        }
+        if (estado->error) rethrow_exception(estado->error);
     }
 
 private:
-    static string toLower(const string& str) {
-        string result = str;
-        transform(result.begin(), result.end(), result.begin(), ::tolower);
-        return result;
+    /**
+     * @brief Ejecuta una tarea de la cola propia o robada; false si no había ninguna
+     */
+    bool ejecutarUna() {
+        const size_t propia = (grupoActual == this) ? colaActual : turno.load() % colas.size();
+        function<void()> tarea;
+        for (size_t k = 0; k < colas.size() && !tarea; ++k) {
+            Cola& cola = *colas[(propia + k) % colas.size()];
+            lock_guard<mutex> lock(cola.cola_mutex);
+            if (cola.tareas.empty()) continue;
+            if (k == 0) {
+                tarea = move(cola.tareas.back());
+                cola.tareas.pop_back();
+            } else {
+                tarea = move(cola.tareas.front());
+                cola.tareas.pop_front();
+            }
+        }
+        if (!tarea) return false;
+        pendientes.fetch_sub(1);
+        tarea();
+        return true;
     }
 
-    static size_t contarOcurrencias(const string& texto, const string& patron) {
-        size_t count = 0;
-        size_t pos = 0;
-        while ((pos = texto.find(patron, pos)) != string::npos) {
-            count++;
-            pos += patron.length();
+    void trabajar(size_t indice) {
+        grupoActual = this;
+        colaActual = indice;
+        while (true) {
+            if (ejecutarUna()) continue;
+            unique_lock<mutex> lock(espera_mutex);
+            hayTareas.wait(lock, [this]() { return detener || pendientes.load() > 0; });
+            if (detener && pendientes.load() == 0) return;
         }
-        return count;
     }
 };
 
 /**
- * @brief Clase principal para gestión de películas
+ * @brief Rango contiguo de IDs ordenados (vista sin propiedad sobre una posting list)
  */
-class GestorPeliculas {
-private:
-    vector<Pelicula> peliculas;
-    Trie<Pelicula> indiceTitulos;
-    Trie<Pelicula> indiceSinopsis;
-    IndiceGenerico<Pelicula, string> indiceTags;
-    mutable mutex peliculas_mutex;
+struct RangoIds {
+    const uint32_t* inicio = nullptr;
+    const uint32_t* fin = nullptr;
 
-public:
-    GestorPeliculas(const string& nombreArchivo) {
-        auto inicio = chrono::high_resolution_clock::now();
+    RangoIds() = default;
+    RangoIds(const uint32_t* i, const uint32_t* f) : inicio(i), fin(f) {}
+    explicit RangoIds(const vector<uint32_t>& v) : inicio(v.data()), fin(v.data() + v.size()) {}
 
-        cout << "Cargando base de datos..." << endl;
-        peliculas = leerCSV(nombreArchivo);
-
-        cout << "Indexando películas..." << endl;
-        indexarPeliculasConcurrente();
+    size_t size() const { return static_cast<size_t>(fin - inicio); }
+    bool empty() const { return inicio == fin; }
+};
 
-        auto fin = chrono::high_resolution_clock::now();
-        auto duracion = chrono::duration_cast<chrono::milliseconds>(fin - inicio);
+/**
+ * @brief Arreglo contiguo de solo lectura (vista sin propiedad)
+ *
+ * Las estructuras congeladas leen sus datos a través de vistas, que pueden
+ * apuntar a vectores propios o directamente a una imagen mapeada en memoria.
+ */
+template<typename T>
+struct Vista {
+    const T* datos = nullptr;
+    size_t cantidad = 0;
+
+    Vista() = default;
+    Vista(const T* d, size_t n) : datos(d), cantidad(n) {}
+    explicit Vista(const vector<T>& v) : datos(v.data()), cantidad(v.size()) {}
+
+    const T* data() const { return datos; }
+    size_t size() const { return cantidad; }
+    bool empty() const { return cantidad == 0; }
+    const T& operator[](size_t i) const { return datos[i]; }
+    const T& back() const { return datos[cantidad - 1]; }
+    const T* begin() const { return datos; }
+    const T* end() const { return datos + cantidad; }
+};
 
-        cout << "Base de datos cargada: " << peliculas.size() << " películas en "
-             << duracion.count() << " ms" << endl;
-    }
+/**
+ * @brief Arreglo que solo crece, en bloques que nunca se mueven
+ *
+ * El bloque b guarda 2^b elementos, así que agregar nunca copia ni reubica los
+ * anteriores. Lo modifica un solo escritor; los lectores solo acceden a
+ * elementos que el escritor terminó de agregar antes de publicar (con
+ * memory_order_release) el tamaño que ellos ven, así que ningún elemento leído
+ * cambia ni se mueve mientras se lee.
+ */
+template<typename T>
+class BloquesEstables {
+private:
+    static constexpr size_t BLOQUES = 32;
 
-    vector<Pelicula*> buscarPorTituloOSinopsis(const string& busqueda) {
-        auto inicio = chrono::high_resolution_clock::now();
+    array<unique_ptr<T[]>, BLOQUES> bloques;
+    size_t cantidad = 0;
 
-        future<vector<Pelicula*>> futureTitulos = async(launch::async, [this, &busqueda]() {
-            return indiceTitulos.buscarPorPrefijo(busqueda);
-        });
+    static size_t bloqueDe(size_t i) {
+        return 63 - static_cast<size_t>(__builtin_clzll(static_cast<unsigned long long>(i) + 1));
+    }
 
-        future<vector<Pelicula*>> futureSinopsis = async(launch::async, [this, &busqueda]() {
-            return indiceSinopsis.buscarPorPrefijo(busqueda);
-        });
+public:
+    /**
+     * @return Posición del elemento agregado
+     */
+    size_t agregar(T valor) {
+        const size_t bloque = bloqueDe(cantidad);
+        if (bloque >= BLOQUES) {
+            throw runtime_error("BloquesEstables lleno");
+        }
+        if (!bloques[bloque]) {
+            bloques[bloque] = make_unique<T[]>(size_t(1) << bloque);
+        }
+        (*this)[cantidad] = move(valor);
+        return cantidad++;
+    }
 
-        vector<Pelicula*> resultadosTitulos = futureTitulos.get();
-        vector<Pelicula*> resultadosSinopsis = futureSinopsis.get();
+    const T& operator[](size_t i) const {
+        const size_t bloque = bloqueDe(i);
+        return bloques[bloque][i + 1 - (size_t(1) << bloque)];
+    }
 
-        unordered_set<Pelicula*> resultadosUnicos(resultadosTitulos.begin(), resultadosTitulos.end());
-        resultadosUnicos.insert(resultadosSinopsis.begin(), resultadosSinopsis.end());
+    T& operator[](size_t i) {
+        const size_t bloque = bloqueDe(i);
+        return bloques[bloque][i + 1 - (size_t(1) << bloque)];
+    }
 
-        vector<Pelicula*> resultados(resultadosUnicos.begin(), resultadosUnicos.end());
+    size_t size() const {
+        return cantidad;
+    }
+};
 
-        for (auto* pelicula : resultados) {
-            pelicula->relevancia = SistemaPuntuacion::calcularPuntuacion(*pelicula, busqueda, peliculas.size());
-        }
+/**
+ * @brief Bloque de una posting list comprimida: su primer ID y dónde empiezan sus datos
+ */
+struct BloquePostings {
+    uint32_t primerId;
+    uint32_t offset; // En palabras de 32 bits dentro de los datos comprimidos
+};
 
-        sort(resultados.begin(), resultados.end(), [](const Pelicula* a, const Pelicula* b) {
-            return a->relevancia > b->relevancia;
-        });
+/**
+ * @brief Compresión de posting lists en bloques de 128 IDs con empaquetado de bits
+ *
+ * Cada bloque guarda las diferencias entre IDs consecutivos (la primera es 0: el
+ * primer ID está en su BloquePostings) y las frecuencias - 1, cada arreglo con
+ * los bits que necesita su mayor valor. El valor i va al carril i % 4 y cada
+ * carril es un flujo de bits propio, intercalado palabra a palabra con los
+ * otros tres: con SSE2 se desempacan 4 valores por instrucción y la suma
+ * prefija reconstruye 4 IDs a la vez. La primera palabra del bloque guarda los
+ * dos anchos.
+ *
+ * La tabla de bloques hace de índice de saltos: buscar un ID cuesta galopar
+ * sobre los primerId y descomprimir un solo bloque.
+ */
+class CodecPostings {
+public:
+    static constexpr uint32_t TAMANO_BLOQUE = 128;
 
-        auto fin = chrono::high_resolution_clock::now();
-        auto duracion = chrono::duration_cast<chrono::microseconds>(fin - inicio);
+    /**
+     * @brief Agrega la lista (IDs crecientes) como ceil(cantidad / 128) bloques
+     *
+     * @param frecuencias Frecuencia de cada ID (nullptr = 1)
+     */
+    static void comprimir(const uint32_t* ids, const uint16_t* frecuencias, uint32_t cantidad,
+                          vector<BloquePostings>& bloques, vector<uint32_t>& datos) {
+        alignas(16) uint32_t diferencias[TAMANO_BLOQUE];
+        alignas(16) uint32_t extras[TAMANO_BLOQUE];
+        for (uint32_t inicio = 0; inicio < cantidad; inicio += TAMANO_BLOQUE) {
+            const uint32_t n = min(TAMANO_BLOQUE, cantidad - inicio);
+            const uint32_t filas = (n + 3) / 4;
+            uint32_t mayorDiferencia = 0;
+            uint32_t mayorExtra = 0;
+            for (uint32_t i = 0; i < filas * 4; ++i) {
+                diferencias[i] = (i > 0 && i < n) ? ids[inicio + i] - ids[inicio + i - 1] : 0;
+                extras[i] = (frecuencias && i < n) ? frecuencias[inicio + i] - 1u : 0;
+                mayorDiferencia = max(mayorDiferencia, diferencias[i]);
+                mayorExtra = max(mayorExtra, extras[i]);
+            }
+            const uint32_t anchoIds = bitsNecesarios(mayorDiferencia);
+            const uint32_t anchoFrecuencias = bitsNecesarios(mayorExtra);
 
-        cout << "Búsqueda completada en " << duracion.count() << " μs" << endl;
-        return resultados;
+            bloques.push_back({ids[inicio], static_cast<uint32_t>(datos.size())});
+            datos.push_back(anchoIds | (anchoFrecuencias << 8));
+            empaquetar(diferencias, filas, anchoIds, datos);
+            empaquetar(extras, filas, anchoFrecuencias, datos);
+        }
     }
 
-    // FUNCIÓN CORREGIDA PARA BÚSQUEDA POR TAG
-    vector<Pelicula*> buscarPorTag(const string& tag) {
-        auto inicio = chrono::high_resolution_clock::now();
-
-        // Normalizar el tag de búsqueda (minúsculas y sin espacios)
-        string tagNormalizado = normalizarTag(tag);
+    /**
+     * @brief Descomprime los 'cantidad' IDs (y frecuencias, si no es nullptr) de un bloque
+     *
+     * Los destinos deben tener lugar para TAMANO_BLOQUE elementos.
+     */
+    static void descomprimir(const BloquePostings& bloque, const uint32_t* datos, uint32_t cantidad,
+                             uint32_t* ids, uint16_t* frecuencias) {
+        const uint32_t* p = datos + bloque.offset;
+        const uint32_t anchoIds = p[0] & 0xFF;
+        const uint32_t anchoFrecuencias = (p[0] >> 8) & 0xFF;
+        const uint32_t filas = (cantidad + 3) / 4;
+        p = desempaquetar(p + 1, filas, anchoIds, ids);
+        sumaPrefija(ids, filas, bloque.primerId);
+        if (frecuencias) {
+            alignas(16) uint32_t extras[TAMANO_BLOQUE];
+            desempaquetar(p, filas, anchoFrecuencias, extras);
+            aFrecuencias(extras, filas, frecuencias);
+        }
+    }
 
-        cout << "Buscando tag: '" << tagNormalizado << "'" << endl;
+    /**
+     * @brief Descomprime solo las frecuencias de un bloque, saltando sus IDs
+     */
+    static void descomprimirFrecuencias(const BloquePostings& bloque, const uint32_t* datos, uint32_t cantidad,
+                                        uint16_t* frecuencias) {
+        const uint32_t* p = datos + bloque.offset;
+        const uint32_t anchoIds = p[0] & 0xFF;
+        const uint32_t anchoFrecuencias = (p[0] >> 8) & 0xFF;
+        const uint32_t filas = (cantidad + 3) / 4;
+        alignas(16) uint32_t extras[TAMANO_BLOQUE];
+        desempaquetar(p + 1 + 4 * ((static_cast<size_t>(filas) * anchoIds + 31) / 32), filas, anchoFrecuencias,
+                      extras);
+        aFrecuencias(extras, filas, frecuencias);
+    }
 
-        // Buscar en el índice usando el tag normalizado
-        vector<Pelicula*> resultados = indiceTags.buscar(tagNormalizado);
+private:
+    static uint32_t bitsNecesarios(uint32_t valor) {
+        return valor == 0 ? 0 : 32 - static_cast<uint32_t>(__builtin_clz(valor));
+    }
 
-        auto fin = chrono::high_resolution_clock::now();
-        auto duracion = chrono::duration_cast<chrono::microseconds>(fin - inicio);
+    /**
+     * @brief Agrega filas × 4 valores de 'ancho' bits en el formato de 4 carriles intercalados
+     */
+    static void empaquetar(const uint32_t* valores, uint32_t filas, uint32_t ancho, vector<uint32_t>& datos) {
+        const size_t inicio = datos.size();
+        const size_t palabras = (static_cast<size_t>(filas) * ancho + 31) / 32;
+        datos.resize(inicio + 4 * palabras, 0);
+        for (uint32_t carril = 0; carril < 4 && ancho > 0; ++carril) {
+            size_t bit = 0;
+            for (uint32_t fila = 0; fila < filas; ++fila, bit += ancho) {
+                const uint64_t valor = valores[fila * 4 + carril];
+                const size_t palabra = bit / 32;
+                const uint32_t desplazamiento = static_cast<uint32_t>(bit % 32);
+                datos[inicio + 4 * palabra + carril] |= static_cast<uint32_t>(valor << desplazamiento);
+                if (desplazamiento + ancho > 32) {
+                    datos[inicio + 4 * (palabra + 1) + carril] |= static_cast<uint32_t>(valor >> (32 - desplazamiento));
+                }
+            }
+        }
+    }
 
-        cout << "Búsqueda por tag completada en " << duracion.count() << " μs" << endl;
-        cout << "Resultados encontrados: " << resultados.size() << endl;
+    /**
+     * @brief Inversa de empaquetar; devuelve el puntero a los datos siguientes
+     */
+    static const uint32_t* desempaquetar(const uint32_t* entrada, uint32_t filas, uint32_t ancho, uint32_t* valores) {
+        if (ancho == 0) {
+            fill(valores, valores + filas * 4, 0u);
+            return entrada;
+        }
+        const size_t palabras = (static_cast<size_t>(filas) * ancho + 31) / 32;
+#if defined(__SSE2__) || defined(_M_X64)
+        // Sin saltos: la palabra siguiente siempre se combina y la máscara descarta
+        // lo que sobra (desplazar 32 bits o más deja el carril en cero)
+        const __m128i* origen = reinterpret_cast<const __m128i*>(entrada);
+        __m128i* destino = reinterpret_cast<__m128i*>(valores);
+        const __m128i mascara = _mm_set1_epi32(static_cast<int>(ancho == 32 ? ~0u : (1u << ancho) - 1));
+        __m128i actual = _mm_loadu_si128(origen);
+        __m128i siguiente = palabras > 1 ? _mm_loadu_si128(origen + 1) : _mm_setzero_si128();
+        size_t palabra = 0;
+        uint32_t bit = 0;
+        for (uint32_t fila = 0; fila < filas; ++fila, bit += ancho) {
+            const uint32_t desplazamiento = bit % 32;
+            if (bit / 32 != palabra) {
+                ++palabra;
+                actual = siguiente;
+                siguiente = palabra + 1 < palabras ? _mm_loadu_si128(origen + palabra + 1) : _mm_setzero_si128();
+            }
+            const __m128i valor = _mm_or_si128(
+                _mm_srl_epi32(actual, _mm_cvtsi32_si128(static_cast<int>(desplazamiento))),
+                _mm_sll_epi32(siguiente, _mm_cvtsi32_si128(static_cast<int>(32 - desplazamiento))));
+            _mm_storeu_si128(destino + fila, _mm_and_si128(valor, mascara));
+        }
+#else
+        const uint32_t mascara = ancho == 32 ? ~0u : (1u << ancho) - 1;
+        for (uint32_t carril = 0; carril < 4; ++carril) {
+            size_t bit = 0;
+            for (uint32_t fila = 0; fila < filas; ++fila, bit += ancho) {
+                const size_t palabra = bit / 32;
+                const uint32_t desplazamiento = static_cast<uint32_t>(bit % 32);
+                uint64_t valor = entrada[4 * palabra + carril] >> desplazamiento;
+                if (desplazamiento + ancho > 32) {
+                    valor |= static_cast<uint64_t>(entrada[4 * (palabra + 1) + carril]) << (32 - desplazamiento);
+                }
+                valores[fila * 4 + carril] = static_cast<uint32_t>(valor) & mascara;
+            }
+        }
+#endif
+        return entrada + 4 * palabras;
+    }
 
-        return resultados;
+    /**
+     * @brief Frecuencias (extra + 1) de 16 bits a partir de los extras desempaquetados
+     */
+    static void aFrecuencias(const uint32_t* extras, uint32_t filas, uint16_t* frecuencias) {
+        uint32_t i = 0;
+#if defined(__SSE2__) || defined(_M_X64)
+        // packs satura con signo: se corre el rango a [-32768, 32767] y se vuelve
+        const __m128i uno = _mm_set1_epi32(1 - 32768);
+        const __m128i corrimiento = _mm_set1_epi16(-32768);
+        for (; i + 8 <= filas * 4; i += 8) {
+            const __m128i bajos = _mm_add_epi32(_mm_loadu_si128(reinterpret_cast<const __m128i*>(extras + i)), uno);
+            const __m128i altos = _mm_add_epi32(_mm_loadu_si128(reinterpret_cast<const __m128i*>(extras + i + 4)), uno);
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(frecuencias + i),
+                             _mm_add_epi16(_mm_packs_epi32(bajos, altos), corrimiento));
+        }
+#endif
+        for (; i < filas * 4; ++i) {
+            frecuencias[i] = static_cast<uint16_t>(extras[i] + 1);
+        }
     }
 
-    const vector<Pelicula>& getPeliculas() const {
-        return peliculas;
+    /**
+     * @brief Convierte las diferencias en IDs, fila por fila
+     */
+    static void sumaPrefija(uint32_t* valores, uint32_t filas, uint32_t base) {
+#if defined(__SSE2__) || defined(_M_X64)
+        __m128i* fila = reinterpret_cast<__m128i*>(valores);
+        __m128i acumulado = _mm_set1_epi32(static_cast<int>(base));
+        for (uint32_t f = 0; f < filas; ++f) {
+            __m128i x = _mm_loadu_si128(fila + f);
+            x = _mm_add_epi32(x, _mm_slli_si128(x, 4));
+            x = _mm_add_epi32(x, _mm_slli_si128(x, 8));
+            x = _mm_add_epi32(x, acumulado);
+            _mm_storeu_si128(fila + f, x);
+            acumulado = _mm_shuffle_epi32(x, 0xFF);
+        }
+#else
+        for (uint32_t i = 0; i < filas * 4; ++i) {
+            base += valores[i];
+            valores[i] = base;
+        }
+#endif
     }
+};
 
-    string obtenerEstadisticas() const {
-        lock_guard<mutex> lock(peliculas_mutex);
+/**
+ * @brief Posting list de IDs ordenados con sus frecuencias, plana o comprimida (vista sin propiedad)
+ *
+ * Plana: 'ids' y 'frecuencias' son arreglos de df elementos. Comprimida: 'ids'
+ * es nulo y la lista son ceil(df / 128) bloques de CodecPostings a partir de
+ * 'bloques'. Se recorre de a tramos (recorrer) o con un CursorPostings.
+ */
+struct ListaPostings {
+    const uint32_t* ids = nullptr;
+    const uint16_t* frecuencias = nullptr; // nullptr = frecuencia 1 en todos los documentos
+    const BloquePostings* bloques = nullptr;
+    const uint32_t* datos = nullptr;
+    uint32_t df = 0;
+
+    ListaPostings() = default;
+    ListaPostings(const uint32_t* ids, const uint16_t* frecuencias, uint32_t df)
+        : ids(ids), frecuencias(frecuencias), df(df) {}
+    ListaPostings(RangoIds rango) : ids(rango.inicio), df(static_cast<uint32_t>(rango.size())) {}
+
+    static ListaPostings comprimida(const BloquePostings* bloques, const uint32_t* datos, uint32_t df) {
+        ListaPostings lista;
+        lista.bloques = bloques;
+        lista.datos = datos;
+        lista.df = df;
+        return lista;
+    }
 
-        stringstream ss;
-        ss << "\n=== ESTADÍSTICAS DE LA BASE DE DATOS ===\n";
-        ss << "Total de películas: " << peliculas.size() << "\n";
+    bool esComprimida() const {
+        return bloques != nullptr;
+    }
 
-        unordered_set<string> tagsUnicos;
-        for (const auto& pelicula : peliculas) {
-            for (const auto& tag : pelicula.tags) {
-                tagsUnicos.insert(tag);
-            }
+    /**
+     * @brief Llama a visitar(ids, frecuencias, cantidad) por cada tramo contiguo de la lista
+     *
+     * Una lista plana es un único tramo; una comprimida se descomprime de a un
+     * bloque. 'frecuencias' es nulo si todas valen 1 o si !conFrecuencias (así
+     * una comprimida no las descomprime).
+     */
+    template<typename Visitante>
+    void recorrer(Visitante&& visitar, bool conFrecuencias = true) const {
+        if (!bloques) {
+            if (df > 0) visitar(ids, conFrecuencias ? frecuencias : nullptr, df);
+            return;
         }
-        ss << "Tags únicos: " << tagsUnicos.size() << "\n";
-
-        double longitudPromedio = 0.0;
-        for (const auto& pelicula : peliculas) {
-            longitudPromedio += pelicula.sinopsis.length();
+        alignas(16) uint32_t bufferIds[CodecPostings::TAMANO_BLOQUE];
+        uint16_t bufferFrecuencias[CodecPostings::TAMANO_BLOQUE];
+        uint16_t* destinoFrecuencias = conFrecuencias ? bufferFrecuencias : nullptr;
+        for (uint32_t inicio = 0, b = 0; inicio < df; inicio += CodecPostings::TAMANO_BLOQUE, ++b) {
+            const uint32_t cantidad = min(CodecPostings::TAMANO_BLOQUE, df - inicio);
+            CodecPostings::descomprimir(bloques[b], datos, cantidad, bufferIds, destinoFrecuencias);
+            visitar(static_cast<const uint32_t*>(bufferIds), static_cast<const uint16_t*>(destinoFrecuencias),
+                    cantidad);
         }
-        longitudPromedio /= peliculas.size();
-        ss << "Longitud promedio de sinopsis: " << fixed << setprecision(2) << longitudPromedio << " caracteres\n";
-
-        ss << "=====================================\n";
-        return ss.str();
     }
 
-private:
-    vector<Pelicula> leerCSV(const string& nombreArchivo) {
-        vector<Pelicula> peliculas;
+    vector<uint32_t> aIds() const {
+        vector<uint32_t> resultado;
+        resultado.reserve(df);
+        recorrer([&resultado](const uint32_t* tramo, const uint16_t*, uint32_t cantidad) {
+            resultado.insert(resultado.end(), tramo, tramo + cantidad);
+        }, false);
+        return resultado;
+    }
+};
 
+/**
+ * @brief Posting list de una palabra con sus posiciones (vista sin propiedad)
+ *
+ * Las posiciones de cada documento están agrupadas en el orden de los IDs y
+ * hay tantas como su frecuencia. Si inicioPosiciones no es nulo permite saltar
+ * directamente al grupo de un documento: tiene df + 1 offsets si la lista es
+ * plana y uno por bloque (más uno) si es comprimida.
+ */
+struct ListaPosicional {
+    ListaPostings postings;
+    const uint32_t* posiciones = nullptr;
+    const uint32_t* inicioPosiciones = nullptr;
+};
+
+/**
+ * @brief Operaciones sobre posting lists ordenadas de IDs
+ */
+class OperacionesPostings {
+public:
+    /**
+     * @brief Fusiona listas ordenadas de IDs eliminando duplicados
+     *
+     * Con pocas listas usa un k-way merge con heap. Si hay muchas listas y el
+     * universo de IDs es conocido, marca un bitmap denso y lo recorre, que es
+     * lineal y no depende del número de listas.
+     *
+     * Complejidad: O(N log k), o bien O(N + U/64) con bitmap (U = universo de IDs)
+     */
+    static vector<uint32_t> fusionar(const vector<ListaPostings>& listas, uint32_t universo = 0) {
+        if (listas.empty()) return {};
+        if (listas.size() == 1) return listas[0].aIds();
+
+        size_t total = 0;
+        for (const auto& lista : listas) total += lista.df;
+
+        if (universo > 0 && listas.size() > 16 && total > universo / 32) {
+            return fusionarConBitmap(listas, universo, total);
+        }
+        // El heap recorre listas planas: las comprimidas se descomprimen antes, el resultado ya cuesta O(N)
+        vector<vector<uint32_t>> descomprimidas;
+        descomprimidas.reserve(listas.size());
+        vector<RangoIds> planas;
+        planas.reserve(listas.size());
+        for (const auto& lista : listas) {
+            if (lista.esComprimida()) {
+                descomprimidas.push_back(lista.aIds());
+                planas.emplace_back(descomprimidas.back());
+            } else {
+                planas.emplace_back(lista.ids, lista.ids + lista.df);
+            }
+        }
+        return fusionarConHeap(planas, total);
+    }
+
+    /**
+     * @brief Primer elemento >= objetivo a partir de 'inicio' (búsqueda galopante)
+     *
+     * Avanza con saltos de tamaño doble y termina con una búsqueda binaria, así que
+     * cuesta O(log d) donde d es la distancia al resultado, no el largo de la lista.
+     */
+    static const uint32_t* galopar(const uint32_t* inicio, const uint32_t* fin, uint32_t objetivo) {
+        if (inicio == fin || *inicio >= objetivo) return inicio;
+        const uint32_t* bajo = inicio;
+        size_t paso = 1;
+        while (paso < static_cast<size_t>(fin - bajo) && bajo[paso] < objetivo) {
+            bajo += paso;
+            paso *= 2;
+        }
+        const uint32_t* alto = (paso < static_cast<size_t>(fin - bajo)) ? bajo + paso + 1 : fin;
+        return lower_bound(bajo, alto, objetivo);
+    }
+
+    /**
+     * @brief Llama a coincidencia(i, j) por cada ID común a dos listas ordenadas
+     *
+     * Recorre la lista más corta y galopa en la más larga, así que el costo es
+     * O(m log(n/m)) con m <= n en lugar de O(n + m) de un merge lineal.
+     */
+    template<typename Coincidencia>
+    static void intersectar(RangoIds a, RangoIds b, Coincidencia&& coincidencia) {
+        const bool invertir = a.size() > b.size();
+        const RangoIds corta = invertir ? b : a;
+        const RangoIds larga = invertir ? a : b;
+
+        const uint32_t* cursor = larga.inicio;
+        for (const uint32_t* p = corta.inicio; p != corta.fin; ++p) {
+            cursor = galopar(cursor, larga.fin, *p);
+            if (cursor == larga.fin) break;
+            if (*cursor == *p) {
+                const size_t i = static_cast<size_t>(p - corta.inicio);
+                const size_t j = static_cast<size_t>(cursor - larga.inicio);
+                invertir ? coincidencia(j, i) : coincidencia(i, j);
+            }
+        }
+    }
+
+private:
+    static vector<uint32_t> fusionarConHeap(const vector<RangoIds>& listas, size_t total) {
+        using Cursor = pair<uint32_t, size_t>; // (ID actual, índice de lista)
+        priority_queue<Cursor, vector<Cursor>, greater<Cursor>> heap;
+        vector<const uint32_t*> posiciones(listas.size());
+
+        for (size_t i = 0; i < listas.size(); ++i) {
+            posiciones[i] = listas[i].inicio;
+            if (!listas[i].empty()) {
+                heap.push({*listas[i].inicio, i});
+            }
+        }
+
+        vector<uint32_t> resultado;
+        resultado.reserve(total);
+        while (!heap.empty()) {
+            auto [id, i] = heap.top();
+            heap.pop();
+            if (resultado.empty() || resultado.back() != id) {
+                resultado.push_back(id);
+            }
+            if (++posiciones[i] != listas[i].fin) {
+                heap.push({*posiciones[i], i});
+            }
+        }
+        return resultado;
+    }
+
+    static vector<uint32_t> fusionarConBitmap(const vector<ListaPostings>& listas, uint32_t universo, size_t total) {
+        vector<uint64_t> bits((universo + 63) / 64, 0);
+        for (const auto& lista : listas) {
+            lista.recorrer([&bits](const uint32_t* ids, const uint16_t*, uint32_t cantidad) {
+                for (uint32_t k = 0; k < cantidad; ++k) {
+                    bits[ids[k] >> 6] |= uint64_t(1) << (ids[k] & 63);
+                }
+            }, false);
+        }
+
+        vector<uint32_t> resultado;
+        resultado.reserve(min<size_t>(total, universo));
+        for (size_t w = 0; w < bits.size(); ++w) {
+            uint64_t palabra = bits[w];
+            while (palabra) {
+                resultado.push_back(static_cast<uint32_t>(w * 64 + __builtin_ctzll(palabra)));
+                palabra &= palabra - 1;
+            }
+        }
+        return resultado;
+    }
+};
+
+/**
+ * @brief Recorre una ListaPostings en orden creciente de IDs
+ *
+ * En una lista comprimida tiene descomprimido solo el bloque actual, y
+ * avanzarHasta salta los bloques intermedios sin tocarlos.
+ */
+class CursorPostings {
+private:
+    ListaPostings lista;
+    uint32_t indice = 0;   // Dentro del bloque actual (o de la lista, si es plana)
+    uint32_t cantidad = 0; // Elementos del bloque actual (o de la lista)
+    uint32_t bloque = 0;
+    mutable bool frecuenciasCargadas = false; // Las del bloque se descomprimen al pedir la primera
+    alignas(16) uint32_t bufferIds[CodecPostings::TAMANO_BLOQUE];
+    mutable uint16_t bufferFrecuencias[CodecPostings::TAMANO_BLOQUE];
+
+    const uint32_t* idsActuales() const {
+        return lista.bloques ? bufferIds : lista.ids;
+    }
+
+    const uint16_t* frecuenciasDelBloque() const {
+        if (!frecuenciasCargadas) {
+            CodecPostings::descomprimirFrecuencias(lista.bloques[bloque], lista.datos, cantidad, bufferFrecuencias);
+            frecuenciasCargadas = true;
+        }
+        return bufferFrecuencias;
+    }
+
+    void cargarBloque(uint32_t b) {
+        bloque = b;
+        indice = 0;
+        frecuenciasCargadas = false;
+        const uint64_t inicio = static_cast<uint64_t>(b) * CodecPostings::TAMANO_BLOQUE;
+        if (inicio >= lista.df) {
+            cantidad = 0;
+            return;
+        }
+        cantidad = min<uint32_t>(CodecPostings::TAMANO_BLOQUE, lista.df - static_cast<uint32_t>(inicio));
+        CodecPostings::descomprimir(lista.bloques[b], lista.datos, cantidad, bufferIds, nullptr);
+    }
+
+public:
+    explicit CursorPostings(const ListaPostings& l) : lista(l) {
+        if (lista.bloques) {
+            cargarBloque(0);
+        } else {
+            cantidad = lista.df;
+        }
+    }
+
+    bool terminado() const {
+        return indice >= cantidad;
+    }
+
+    uint32_t id() const {
+        return idsActuales()[indice];
+    }
+
+    uint16_t frecuencia() const {
+        if (lista.bloques) return frecuenciasDelBloque()[indice];
+        return lista.frecuencias ? lista.frecuencias[indice] : 1;
+    }
+
+    /**
+     * @brief Índice del elemento actual en la lista
+     */
+    uint32_t posicion() const {
+        return bloque * CodecPostings::TAMANO_BLOQUE + indice;
+    }
+
+    uint32_t bloqueActual() const {
+        return bloque;
+    }
+
+    /**
+     * @brief Suma de las frecuencias de los elementos anteriores al actual en su bloque
+     */
+    uint32_t frecuenciasPreviasEnBloque() const {
+        const uint16_t* frecuencias = frecuenciasDelBloque();
+        uint32_t suma = 0;
+        for (uint32_t i = 0; i < indice; ++i) suma += frecuencias[i];
+        return suma;
+    }
+
+    void avanzar() {
+        if (++indice == cantidad && lista.bloques) cargarBloque(bloque + 1);
+    }
+
+    /**
+     * @brief Avanza al primer ID >= objetivo (no menor que el actual); false si la lista se terminó
+     *
+     * Galopa sobre la tabla de bloques y luego dentro del bloque, así que cuesta
+     * O(log d) en la distancia d al resultado más la descompresión de un bloque.
+     */
+    bool avanzarHasta(uint32_t objetivo) {
+        if (terminado()) return false;
+        if (lista.bloques && objetivo > bufferIds[cantidad - 1]) {
+            const BloquePostings* inicio = lista.bloques + bloque + 1;
+            const BloquePostings* fin = lista.bloques + (lista.df + CodecPostings::TAMANO_BLOQUE - 1) /
+                                                        CodecPostings::TAMANO_BLOQUE;
+            // Primer bloque que empieza después del objetivo; el anterior es el que puede contenerlo
+            const BloquePostings* mayor = inicio;
+            if (inicio != fin && inicio->primerId <= objetivo) {
+                const BloquePostings* bajo = inicio;
+                size_t paso = 1;
+                while (paso < static_cast<size_t>(fin - bajo) && bajo[paso].primerId <= objetivo) {
+                    bajo += paso;
+                    paso *= 2;
+                }
+                const BloquePostings* alto = (paso < static_cast<size_t>(fin - bajo)) ? bajo + paso + 1 : fin;
+                mayor = upper_bound(bajo, alto, objetivo, [](uint32_t valor, const BloquePostings& b) {
+                    return valor < b.primerId;
+                });
+            }
+            cargarBloque(static_cast<uint32_t>((mayor == inicio ? inicio : mayor - 1) - lista.bloques));
+            if (terminado()) return false;
+        }
+        const uint32_t* ids = idsActuales();
+        indice = static_cast<uint32_t>(OperacionesPostings::galopar(ids + indice, ids + cantidad, objetivo) - ids);
+        // En el bloque que empieza antes del objetivo puede no haber ninguno >= objetivo: es el primero del siguiente
+        if (indice == cantidad && lista.bloques) cargarBloque(bloque + 1);
+        return !terminado();
+    }
+};
+
+/**
+ * @brief Recorre una ListaPosicional con IDs crecientes y entrega las posiciones de cada uno
+ *
+ * Sin offsets precalculados (Trie mutable) acumula las frecuencias saltadas, lo
+ * que es lineal en el largo de la lista; con offsets (Trie congelado) cada salto
+ * es una búsqueda galopante. En una lista comprimida el offset del bloque se
+ * completa con las frecuencias anteriores dentro del bloque.
+ */
+class CursorPosicional {
+private:
+    const ListaPosicional* lista;
+    CursorPostings cursor;
+    uint32_t offset = 0;  // Solo se usa sin inicioPosiciones
+
+public:
+    explicit CursorPosicional(const ListaPosicional& l) : lista(&l), cursor(l.postings) {}
+
+    /**
+     * @brief Avanza hasta 'id' (no menor que el anterior); false si no está en la lista
+     */
+    bool avanzarA(uint32_t id, RangoIds& posiciones) {
+        if (lista->inicioPosiciones) {
+            cursor.avanzarHasta(id);
+        } else {
+            for (; !cursor.terminado() && cursor.id() < id; cursor.avanzar()) offset += cursor.frecuencia();
+        }
+        if (cursor.terminado() || cursor.id() != id) return false;
+
+        uint32_t inicio = offset;
+        if (lista->inicioPosiciones && lista->postings.esComprimida()) {
+            inicio = lista->inicioPosiciones[cursor.bloqueActual()] + cursor.frecuenciasPreviasEnBloque();
+        } else if (lista->inicioPosiciones) {
+            inicio = lista->inicioPosiciones[cursor.posicion()];
+        }
+        posiciones = RangoIds(lista->posiciones + inicio, lista->posiciones + inicio + cursor.frecuencia());
+        return true;
+    }
+};
+
+/**
+ * @brief Posición de cada candidato en un arreglo denso indexado por ID
+ *
+ * Sirve para intersectar muchas posting lists contra un mismo conjunto de
+ * candidatos (por ejemplo todas las palabras de un prefijo): cada posting cuesta
+ * una lectura en lugar de una búsqueda galopante. Las listas mucho más largas que
+ * los candidatos se siguen intersectando con galope sobre la lista.
+ */
+class IndiceCandidatos {
+private:
+    static constexpr uint32_t NINGUNO = numeric_limits<uint32_t>::max();
+    static constexpr size_t FACTOR_GALOPE = 8;
+
+    vector<uint32_t> posicion;
+    const vector<uint32_t>* candidatos = nullptr;
+
+public:
+    /**
+     * @param universo Cota superior (exclusiva) de los IDs de candidatos y listas
+     */
+    void preparar(const vector<uint32_t>& ids, uint32_t universo) {
+        if (posicion.size() < universo) {
+            posicion.assign(universo, NINGUNO);
+        }
+        for (size_t i = 0; i < ids.size(); ++i) {
+            posicion[ids[i]] = static_cast<uint32_t>(i);
+        }
+        candidatos = &ids;
+    }
+
+    /**
+     * @brief Deja el arreglo listo para otro conjunto en O(candidatos)
+     */
+    void liberar() {
+        for (uint32_t id : *candidatos) {
+            posicion[id] = NINGUNO;
+        }
+        candidatos = nullptr;
+    }
+
+    /**
+     * @brief Llama a coincidencia(i, frecuencia) si candidatos[i] está en la lista
+     *
+     * Con una lista larga se galopa desde cada candidato, saltando los bloques
+     * comprimidos que no contienen ninguno.
+     */
+    template<typename Coincidencia>
+    void intersectar(const ListaPostings& lista, Coincidencia&& coincidencia) const {
+        if (lista.df > candidatos->size() * FACTOR_GALOPE) {
+            CursorPostings cursor(lista);
+            for (size_t i = 0; i < candidatos->size(); ++i) {
+                const uint32_t id = (*candidatos)[i];
+                if (!cursor.avanzarHasta(id)) break;
+                if (cursor.id() == id) coincidencia(i, cursor.frecuencia());
+            }
+            return;
+        }
+        lista.recorrer([&](const uint32_t* ids, const uint16_t* frecuencias, uint32_t cantidad) {
+            for (uint32_t k = 0; k < cantidad; ++k) {
+                const uint32_t i = posicion[ids[k]];
+                if (i != NINGUNO) {
+                    coincidencia(static_cast<size_t>(i), frecuencias ? frecuencias[k] : uint16_t(1));
+                }
+            }
+        });
+    }
+};
+
+/**
+ * @brief Contenedor de un BitmapIds: los IDs que comparten sus 16 bits altos
+ */
+struct ContenedorBitmap {
+    uint16_t clave;        // 16 bits altos de los IDs del contenedor
+    uint16_t denso;        // 1 = bitmap de 1024 palabras, 0 = arreglo ordenado de 16 bits bajos
+    uint32_t cardinalidad;
+    uint32_t inicio;       // Offset en 'palabras' (denso) o en 'valores' (arreglo)
+};
+
+/**
+ * @brief Conjunto comprimido de IDs de solo lectura (vista sin propiedad)
+ *
+ * Apunta a un BitmapIds o a los arreglos de IndiceTagsCongelado, que pueden
+ * estar en la imagen mapeada del índice.
+ */
+struct VistaBitmap {
+    Vista<ContenedorBitmap> contenedores; // Ordenados por clave
+    const uint16_t* valores = nullptr;
+    const uint64_t* palabras = nullptr;
+
+    bool empty() const { return contenedores.empty(); }
+
+    size_t cardinalidad() const {
+        size_t total = 0;
+        for (const auto& contenedor : contenedores) total += contenedor.cardinalidad;
+        return total;
+    }
+
+    /**
+     * @brief Llama a visitar(id) por cada ID del conjunto, en orden creciente
+     */
+    template<typename Visitante>
+    void recorrer(Visitante&& visitar) const {
+        for (const auto& c : contenedores) {
+            const uint32_t base = static_cast<uint32_t>(c.clave) << 16;
+            if (c.denso) {
+                for (size_t w = 0; w < 1024; ++w) {
+                    uint64_t palabra = palabras[c.inicio + w];
+                    while (palabra) {
+                        visitar(base + static_cast<uint32_t>(w * 64 + __builtin_ctzll(palabra)));
+                        palabra &= palabra - 1;
+                    }
+                }
+            } else {
+                for (uint32_t k = 0; k < c.cardinalidad; ++k) {
+                    visitar(base + valores[c.inicio + k]);
+                }
+            }
+        }
+    }
+
+    /**
+     * @brief IDs ordenados del conjunto
+     */
+    vector<uint32_t> aIds() const {
+        vector<uint32_t> ids;
+        ids.reserve(cardinalidad());
+        recorrer([&ids](uint32_t id) { ids.push_back(id); });
+        return ids;
+    }
+
+    /**
+     * @brief Marca los IDs del conjunto en un bitmap plano de (universo + 63) / 64 palabras
+     */
+    void marcar(vector<uint64_t>& bits) const {
+        for (const auto& c : contenedores) {
+            const size_t base = static_cast<size_t>(c.clave) << 10; // Primera palabra del contenedor
+            if (c.denso) {
+                const size_t n = min<size_t>(1024, bits.size() - min(base, bits.size()));
+                for (size_t w = 0; w < n; ++w) bits[base + w] |= palabras[c.inicio + w];
+            } else {
+                for (uint32_t k = 0; k < c.cardinalidad; ++k) {
+                    const uint16_t v = valores[c.inicio + k];
+                    bits[base + (v >> 6)] |= uint64_t(1) << (v & 63);
+                }
+            }
+        }
+    }
+};
+
+/**
+ * @brief Conjunto comprimido de IDs al estilo Roaring
+ *
+ * Los IDs se agrupan por sus 16 bits altos. Un contenedor con hasta
+ * UMBRAL_DENSO IDs guarda sus 16 bits bajos ordenados (2 bytes por ID); uno más
+ * poblado es un bitmap fijo de 8 KB. Así un tag raro ocupa poco y dos tags
+ * populares se combinan palabra a palabra, de a 128 bits con SSE2.
+ *
+ * Complejidad de AND/OR/AND NOT: O(contenedores + Σ min(|a|, |b|)) entre arreglos,
+ * O(1024 / 2) instrucciones entre dos contenedores densos.
+ */
+class BitmapIds {
+public:
+    static constexpr uint32_t UMBRAL_DENSO = 4096; // Por encima, el bitmap ocupa menos que el arreglo
+    static constexpr size_t PALABRAS_DENSO = 1024;
+
+    vector<ContenedorBitmap> contenedores;
+    vector<uint16_t> valores;
+    vector<uint64_t> palabras;
+
+    /**
+     * @param ids IDs ordenados y sin duplicados
+     */
+    static BitmapIds desdeIds(RangoIds ids) {
+        BitmapIds bitmap;
+        const uint32_t* p = ids.inicio;
+        vector<uint16_t> bajos;
+        while (p != ids.fin) {
+            const uint16_t clave = static_cast<uint16_t>(*p >> 16);
+            bajos.clear();
+            for (; p != ids.fin && (*p >> 16) == clave; ++p) {
+                bajos.push_back(static_cast<uint16_t>(*p));
+            }
+            bitmap.agregarArreglo(clave, bajos.data(), bajos.size());
+        }
+        return bitmap;
+    }
+
+    /**
+     * @brief Todos los IDs en [0, universo)
+     */
+    static BitmapIds completo(uint32_t universo) {
+        BitmapIds bitmap;
+        array<uint64_t, PALABRAS_DENSO> bits;
+        for (uint64_t base = 0; base < universo; base += 65536) {
+            const uint64_t cantidad = min<uint64_t>(65536, universo - base);
+            bits.fill(0);
+            fill(bits.begin(), bits.begin() + cantidad / 64, ~uint64_t(0));
+            if (cantidad % 64) bits[cantidad / 64] = (uint64_t(1) << (cantidad % 64)) - 1;
+            bitmap.agregarDenso(static_cast<uint16_t>(base >> 16), bits.data());
+        }
+        return bitmap;
+    }
+
+    static BitmapIds interseccion(const VistaBitmap& a, const VistaBitmap& b) {
+        BitmapIds resultado;
+        array<uint64_t, PALABRAS_DENSO> bits;
+        vector<uint16_t> bajos;
+        size_t i = 0, j = 0;
+        while (i < a.contenedores.size() && j < b.contenedores.size()) {
+            const ContenedorBitmap& ca = a.contenedores[i];
+            const ContenedorBitmap& cb = b.contenedores[j];
+            if (ca.clave != cb.clave) {
+                ca.clave < cb.clave ? ++i : ++j;
+                continue;
+            }
+            if (ca.denso && cb.denso) {
+                combinar<Operacion::Y>(a.palabras + ca.inicio, b.palabras + cb.inicio, bits.data());
+                resultado.agregarDenso(ca.clave, bits.data());
+            } else if (ca.denso || cb.denso) {
+                const bool aDenso = ca.denso;
+                filtrarArreglo(aDenso ? b.valores + cb.inicio : a.valores + ca.inicio,
+                               aDenso ? cb.cardinalidad : ca.cardinalidad,
+                               aDenso ? a.palabras + ca.inicio : b.palabras + cb.inicio, true, bajos);
+                resultado.agregarArreglo(ca.clave, bajos.data(), bajos.size());
+            } else {
+                bajos.clear();
+                set_intersection(a.valores + ca.inicio, a.valores + ca.inicio + ca.cardinalidad,
+                                 b.valores + cb.inicio, b.valores + cb.inicio + cb.cardinalidad,
+                                 back_inserter(bajos));
+                resultado.agregarArreglo(ca.clave, bajos.data(), bajos.size());
+            }
+            ++i;
+            ++j;
+        }
+        return resultado;
+    }
+
+    static BitmapIds unir(const VistaBitmap& a, const VistaBitmap& b) {
+        BitmapIds resultado;
+        array<uint64_t, PALABRAS_DENSO> bits;
+        vector<uint16_t> bajos;
+        size_t i = 0, j = 0;
+        while (i < a.contenedores.size() || j < b.contenedores.size()) {
+            if (j == b.contenedores.size() ||
+                (i < a.contenedores.size() && a.contenedores[i].clave < b.contenedores[j].clave)) {
+                resultado.copiar(a, a.contenedores[i++]);
+                continue;
+            }
+            if (i == a.contenedores.size() || b.contenedores[j].clave < a.contenedores[i].clave) {
+                resultado.copiar(b, b.contenedores[j++]);
+                continue;
+            }
+            const ContenedorBitmap& ca = a.contenedores[i++];
+            const ContenedorBitmap& cb = b.contenedores[j++];
+            if (ca.denso && cb.denso) {
+                combinar<Operacion::O>(a.palabras + ca.inicio, b.palabras + cb.inicio, bits.data());
+                resultado.agregarDenso(ca.clave, bits.data());
+            } else if (ca.denso || cb.denso) {
+                const VistaBitmap& densa = ca.denso ? a : b;
+                const ContenedorBitmap& cd = ca.denso ? ca : cb;
+                const VistaBitmap& otra = ca.denso ? b : a;
+                const ContenedorBitmap& co = ca.denso ? cb : ca;
+                copy(densa.palabras + cd.inicio, densa.palabras + cd.inicio + PALABRAS_DENSO, bits.begin());
+                for (uint32_t k = 0; k < co.cardinalidad; ++k) {
+                    const uint16_t v = otra.valores[co.inicio + k];
+                    bits[v >> 6] |= uint64_t(1) << (v & 63);
+                }
+                resultado.agregarDenso(ca.clave, bits.data());
+            } else {
+                bajos.clear();
+                set_union(a.valores + ca.inicio, a.valores + ca.inicio + ca.cardinalidad,
+                          b.valores + cb.inicio, b.valores + cb.inicio + cb.cardinalidad,
+                          back_inserter(bajos));
+                resultado.agregarArreglo(ca.clave, bajos.data(), bajos.size());
+            }
+        }
+        return resultado;
+    }
+
+    /**
+     * @brief a AND NOT b
+     */
+    static BitmapIds diferencia(const VistaBitmap& a, const VistaBitmap& b) {
+        BitmapIds resultado;
+        array<uint64_t, PALABRAS_DENSO> bits;
+        vector<uint16_t> bajos;
+        size_t j = 0;
+        for (const ContenedorBitmap& ca : a.contenedores) {
+            while (j < b.contenedores.size() && b.contenedores[j].clave < ca.clave) ++j;
+            if (j == b.contenedores.size() || b.contenedores[j].clave != ca.clave) {
+                resultado.copiar(a, ca);
+                continue;
+            }
+            const ContenedorBitmap& cb = b.contenedores[j];
+            if (ca.denso && cb.denso) {
+                combinar<Operacion::YNo>(a.palabras + ca.inicio, b.palabras + cb.inicio, bits.data());
+                resultado.agregarDenso(ca.clave, bits.data());
+            } else if (ca.denso) {
+                copy(a.palabras + ca.inicio, a.palabras + ca.inicio + PALABRAS_DENSO, bits.begin());
+                for (uint32_t k = 0; k < cb.cardinalidad; ++k) {
+                    const uint16_t v = b.valores[cb.inicio + k];
+                    bits[v >> 6] &= ~(uint64_t(1) << (v & 63));
+                }
+                resultado.agregarDenso(ca.clave, bits.data());
+            } else if (cb.denso) {
+                filtrarArreglo(a.valores + ca.inicio, ca.cardinalidad, b.palabras + cb.inicio, false, bajos);
+                resultado.agregarArreglo(ca.clave, bajos.data(), bajos.size());
+            } else {
+                bajos.clear();
+                set_difference(a.valores + ca.inicio, a.valores + ca.inicio + ca.cardinalidad,
+                               b.valores + cb.inicio, b.valores + cb.inicio + cb.cardinalidad,
+                               back_inserter(bajos));
+                resultado.agregarArreglo(ca.clave, bajos.data(), bajos.size());
+            }
+        }
+        return resultado;
+    }
+
+    VistaBitmap vista() const {
+        VistaBitmap v;
+        v.contenedores = Vista<ContenedorBitmap>(contenedores);
+        v.valores = valores.data();
+        v.palabras = palabras.data();
+        return v;
+    }
+
+    size_t memoria() const {
+        return contenedores.size() * sizeof(ContenedorBitmap) + valores.size() * sizeof(uint16_t) +
+               palabras.size() * sizeof(uint64_t);
+    }
+
+private:
+    enum class Operacion { Y, O, YNo };
+
+    /**
+     * @brief destino = a op b sobre las 1024 palabras de dos contenedores densos
+     */
+    template<Operacion op>
+    static void combinar(const uint64_t* a, const uint64_t* b, uint64_t* destino) {
+#if defined(__SSE2__) || defined(_M_X64)
+        for (size_t w = 0; w < PALABRAS_DENSO; w += 2) {
+            const __m128i va = _mm_loadu_si128(reinterpret_cast<const __m128i*>(a + w));
+            const __m128i vb = _mm_loadu_si128(reinterpret_cast<const __m128i*>(b + w));
+            const __m128i r = op == Operacion::Y ? _mm_and_si128(va, vb)
+                            : op == Operacion::O ? _mm_or_si128(va, vb)
+                                                 : _mm_andnot_si128(vb, va);
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(destino + w), r);
+        }
+#else
+        for (size_t w = 0; w < PALABRAS_DENSO; ++w) {
+            destino[w] = op == Operacion::Y ? (a[w] & b[w]) : op == Operacion::O ? (a[w] | b[w]) : (a[w] & ~b[w]);
+        }
+#endif
+    }
+
+    /**
+     * @brief Valores del arreglo cuyo bit en 'bits' vale 'presentes'
+     */
+    static void filtrarArreglo(const uint16_t* valores, uint32_t cantidad, const uint64_t* bits, bool presentes,
+                               vector<uint16_t>& destino) {
+        destino.clear();
+        for (uint32_t k = 0; k < cantidad; ++k) {
+            const uint16_t v = valores[k];
+            if (static_cast<bool>((bits[v >> 6] >> (v & 63)) & 1) == presentes) {
+                destino.push_back(v);
+            }
+        }
+    }
+
+    void copiar(const VistaBitmap& origen, const ContenedorBitmap& c) {
+        if (c.denso) {
+            agregarDenso(c.clave, origen.palabras + c.inicio);
+        } else {
+            agregarArreglo(c.clave, origen.valores + c.inicio, c.cardinalidad);
+        }
+    }
+
+    /**
+     * @brief Agrega un contenedor a partir de sus valores ordenados; denso si son muchos
+     */
+    void agregarArreglo(uint16_t clave, const uint16_t* bajos, size_t cantidad) {
+        if (cantidad == 0) return;
+        if (cantidad > UMBRAL_DENSO) {
+            array<uint64_t, PALABRAS_DENSO> bits{};
+            for (size_t k = 0; k < cantidad; ++k) {
+                bits[bajos[k] >> 6] |= uint64_t(1) << (bajos[k] & 63);
+            }
+            agregarDenso(clave, bits.data());
+            return;
+        }
+        contenedores.push_back({clave, 0, static_cast<uint32_t>(cantidad), static_cast<uint32_t>(valores.size())});
+        valores.insert(valores.end(), bajos, bajos + cantidad);
+    }
+
+    /**
+     * @brief Agrega un contenedor a partir de su bitmap; como arreglo si quedó con pocos IDs
+     */
+    void agregarDenso(uint16_t clave, const uint64_t* bits) {
+        uint32_t cardinalidad = 0;
+        for (size_t w = 0; w < PALABRAS_DENSO; ++w) {
+            cardinalidad += static_cast<uint32_t>(__builtin_popcountll(bits[w]));
+        }
+        if (cardinalidad == 0) return;
+        if (cardinalidad <= UMBRAL_DENSO) {
+            contenedores.push_back({clave, 0, cardinalidad, static_cast<uint32_t>(valores.size())});
+            for (size_t w = 0; w < PALABRAS_DENSO; ++w) {
+                uint64_t palabra = bits[w];
+                while (palabra) {
+                    valores.push_back(static_cast<uint16_t>(w * 64 + __builtin_ctzll(palabra)));
+                    palabra &= palabra - 1;
+                }
+            }
+            return;
+        }
+        contenedores.push_back({clave, 1, cardinalidad, static_cast<uint32_t>(palabras.size())});
+        palabras.insert(palabras.end(), bits, bits + PALABRAS_DENSO);
+    }
+};
+
+/**
+ * @brief Formato de la imagen binaria del índice (.idx)
+ *
+ * Una cabecera fija seguida de arreglos, cada uno como [cantidad u64][datos]
+ * rellenado a 8 bytes. Como el mapeo empieza alineado a página, cada arreglo
+ * queda alineado y se lee en su lugar, sin copiarlo.
+ */
+class FormatoImagen {
+public:
+    static constexpr char MAGIA[8] = {'P', 'E', 'L', 'I', 'D', 'X', '\r', '\n'};
+    static constexpr uint32_t VERSION = 10;
+    static constexpr uint32_t MARCA_ORDEN = 0x01020304; // Se lee distinto con otro orden de bytes
+    static constexpr uint64_t SEMILLA = 0x9E3779B97F4A7C15ULL;
+
+    struct Cabecera {
+        char magia[8];
+        uint32_t version;
+        uint32_t marcaOrden;
+        uint64_t huellaHash;     // Hash de un texto fijo: cambia si cambia la función de hash
+        uint64_t tamanoCsv;
+        int64_t fechaCsv;        // Fecha de modificación del CSV indexado
+        uint64_t sumaCsv;        // Suma de verificación del contenido del CSV
+        uint64_t tamanoDatos;    // Bytes después de la cabecera
+        uint64_t sumaDatos;
+    };
+
+    /**
+     * @brief Suma de verificación de 64 bits por palabras de 8 bytes
+     *
+     * No es criptográfica: detecta imágenes truncadas o corruptas a varios GB/s.
+     * Se puede calcular por partes pasando el estado anterior, siempre que cada
+     * parte salvo la última mida un múltiplo de 8 bytes.
+     */
+    static uint64_t sumaVerificacion(const char* datos, size_t bytes, uint64_t estado = SEMILLA) {
+        size_t i = 0;
+        for (; i + 8 <= bytes; i += 8) {
+            uint64_t palabra;
+            memcpy(&palabra, datos + i, 8);
+            estado = mezclar(estado, palabra);
+        }
+        if (i < bytes) {
+            uint64_t palabra = 0;
+            memcpy(&palabra, datos + i, bytes - i);
+            estado = mezclar(estado, palabra);
+        }
+        return estado;
+    }
+
+    static size_t redondear(size_t bytes) {
+        return (bytes + 7) & ~static_cast<size_t>(7);
+    }
+
+private:
+    static uint64_t mezclar(uint64_t estado, uint64_t palabra) {
+        estado ^= palabra * 0xC2B2AE3D27D4EB4FULL;
+        estado = (estado << 31) | (estado >> 33);
+        return estado * 0x9E3779B97F4A7C15ULL;
+    }
+};
+
+/**
+ * @brief Escribe una imagen del índice y completa su cabecera al cerrar
+ */
+class EscritorImagen {
+private:
+    ofstream salida;
+    uint64_t suma = FormatoImagen::SEMILLA;
+    uint64_t bytes = 0;
+
+public:
+    explicit EscritorImagen(const string& ruta) : salida(ruta, ios::binary | ios::trunc) {
+        if (!salida) {
+            throw runtime_error("No se puede crear el archivo: " + ruta);
+        }
+        const FormatoImagen::Cabecera provisional{};
+        salida.write(reinterpret_cast<const char*>(&provisional), sizeof(provisional));
+    }
+
+    template<typename T>
+    void escribir(const T* datos, size_t cantidad) {
+        static_assert(is_trivially_copyable<T>::value, "La imagen solo guarda tipos triviales");
+        const uint64_t n = cantidad;
+        agregar(reinterpret_cast<const char*>(&n), sizeof(n));
+        agregar(reinterpret_cast<const char*>(datos), cantidad * sizeof(T));
+    }
+
+    template<typename T>
+    void escribir(Vista<T> arreglo) {
+        escribir(arreglo.data(), arreglo.size());
+    }
+
+    template<typename T>
+    void escribir(const vector<T>& arreglo) {
+        escribir(arreglo.data(), arreglo.size());
+    }
+
+    template<typename T>
+    void escribirValor(const T& valor) {
+        escribir(&valor, 1);
+    }
+
+    /**
+     * @brief Escribe la cabecera con el tamaño y la suma de los datos
+     */
+    void cerrar(FormatoImagen::Cabecera cabecera) {
+        cabecera.tamanoDatos = bytes;
+        cabecera.sumaDatos = suma;
+        salida.seekp(0);
+        salida.write(reinterpret_cast<const char*>(&cabecera), sizeof(cabecera));
+        salida.close();
+        if (!salida) {
+            throw runtime_error("Error de escritura en la imagen del índice");
+        }
+    }
+
+private:
+    void agregar(const char* datos, size_t cantidad) {
+        const size_t completos = cantidad & ~static_cast<size_t>(7);
+        suma = FormatoImagen::sumaVerificacion(datos, completos, suma);
+        salida.write(datos, completos);
+        if (completos < cantidad) {
+            char resto[8] = {};
+            memcpy(resto, datos + completos, cantidad - completos);
+            suma = FormatoImagen::sumaVerificacion(resto, sizeof(resto), suma);
+            salida.write(resto, sizeof(resto));
+        }
+        bytes += FormatoImagen::redondear(cantidad);
+    }
+};
+
+/**
+ * @brief Recorre los arreglos de una imagen mapeada devolviendo vistas sobre ella
+ *
+ * Cada lectura comprueba que el arreglo cabe en lo que queda de la imagen.
+ */
+class LectorImagen {
+private:
+    const char* actual;
+    const char* fin;
+
+public:
+    explicit LectorImagen(string_view datos) : actual(datos.data()), fin(datos.data() + datos.size()) {}
+
+    template<typename T>
+    Vista<T> leer() {
+        if (fin - actual < static_cast<ptrdiff_t>(sizeof(uint64_t))) {
+            throw runtime_error("imagen truncada");
+        }
+        uint64_t cantidad;
+        memcpy(&cantidad, actual, sizeof(cantidad));
+        actual += sizeof(cantidad);
+        if (cantidad > static_cast<uint64_t>(fin - actual) / sizeof(T)) {
+            throw runtime_error("imagen truncada");
+        }
+        Vista<T> arreglo(reinterpret_cast<const T*>(actual), static_cast<size_t>(cantidad));
+        actual += FormatoImagen::redondear(arreglo.size() * sizeof(T));
+        return arreglo;
+    }
+
+    template<typename T>
+    T leerValor() {
+        const Vista<T> arreglo = leer<T>();
+        if (arreglo.size() != 1) {
+            throw runtime_error("imagen con formato inesperado");
+        }
+        return arreglo[0];
+    }
+
+    bool terminado() const {
+        return actual == fin;
+    }
+};
+
+/**
+ * @brief Nodo del Trie compacto: solo los nodos terminales guardan postings
+ *
+ * Los nodos intermedios no copian los elementos de las palabras que pasan por
+ * ellos. Opcionalmente guardan un resumen con la unión (ordenada) de los IDs de
+ * su subárbol, acotada en tamaño.
+ */
+class NodoTrieCompacto {
+public:
+    unordered_map<char, unique_ptr<NodoTrieCompacto>> children;
+    vector<uint32_t> postings;     // IDs ordenados y sin duplicados de la palabra terminal
+    vector<uint16_t> frecuencias;  // Apariciones de la palabra en cada documento (paralelo a postings)
+    vector<uint32_t> posiciones;   // Posición de cada aparición, agrupadas por documento
+    vector<uint32_t> resumen;      // Unión precalculada del subárbol (solo si tieneResumen)
+    bool tieneResumen = false;
+    bool esFinDePalabra = false;
+};
+
+/**
+ * @brief Distancia de edición de una palabra contra el camino que se recorre en un Trie
+ *
+ * Cada nivel del camino tiene una fila con la distancia de cada prefijo de la
+ * palabra contra el camino hasta ese nivel, calculada desde la fila anterior en
+ * O(m). Cuentan como una edición la inserción, el borrado, la sustitución y la
+ * transposición de dos letras vecinas ("batmna" → "batman"). La última celda es
+ * la distancia de la palabra completa; si el mínimo de la fila ya supera el
+ * máximo, ningún descendiente puede acercarse y la rama se poda.
+ */
+class DistanciaEdicion {
+private:
+    string palabra;
+    uint32_t maxima;
+    vector<uint16_t> filas; // Fila de cada nivel, de palabra.size() + 1 celdas
+    string camino;          // Etiqueta del nivel i en camino[i - 1]
+
+public:
+    DistanciaEdicion(string palabra, uint32_t maxima) : palabra(move(palabra)), maxima(maxima) {
+        const size_t ancho = this->palabra.size() + 1;
+        filas.resize(ancho);
+        for (size_t j = 0; j < ancho; ++j) {
+            filas[j] = static_cast<uint16_t>(j);
+        }
+    }
+
+    uint32_t distanciaMaxima() const {
+        return maxima;
+    }
+
+    /**
+     * @brief Calcula la fila del nivel + 1 al bajar por la etiqueta 'c'
+     * @return false si ninguna palabra del subárbol puede estar a distancia <= maxima
+     */
+    bool avanzar(size_t nivel, unsigned char c) {
+        const size_t ancho = palabra.size() + 1;
+        if (filas.size() < (nivel + 2) * ancho) {
+            filas.resize((nivel + 2) * ancho);
+            camino.resize(nivel + 1);
+        }
+        camino[nivel] = static_cast<char>(c);
+        const uint16_t* anterior = filas.data() + nivel * ancho;
+        uint16_t* fila = filas.data() + (nivel + 1) * ancho;
+
+        fila[0] = static_cast<uint16_t>(nivel + 1);
+        uint16_t minimo = fila[0];
+        for (size_t j = 1; j < ancho; ++j) {
+            const unsigned char letra = static_cast<unsigned char>(palabra[j - 1]);
+            uint16_t valor = min<uint16_t>(min(anterior[j], fila[j - 1]) + 1, anterior[j - 1] + (letra != c));
+            if (nivel > 0 && j > 1 && letra == static_cast<unsigned char>(camino[nivel - 1]) &&
+                static_cast<unsigned char>(palabra[j - 2]) == c) {
+                valor = min<uint16_t>(valor, (anterior - ancho)[j - 2] + 1);
+            }
+            fila[j] = valor;
+            minimo = min(minimo, valor);
+        }
+        return minimo <= maxima;
+    }
+
+    /**
+     * @brief Distancia entre la palabra completa y el camino hasta 'nivel'
+     */
+    uint32_t distancia(size_t nivel) const {
+        return filas[nivel * (palabra.size() + 1) + palabra.size()];
+    }
+};
+
+/**
+ * @brief Trie de solo lectura en arreglos contiguos, construido tras la indexación
+ *
+ * Los nodos se guardan en preorden con las etiquetas de sus hijos ordenadas, de
+ * modo que un subárbol ocupa un rango contiguo de nodos y sus postings un rango
+ * contiguo del arreglo de IDs. Cada paso de la navegación lee un bloque pequeño
+ * de etiquetas en lugar de un bucket de hash y un nodo separado en el heap.
+ *
+ * Los arreglos son vistas: tras construir() apuntan a vectores propios y tras
+ * leer() directamente a la imagen mapeada del índice, sin deserializarla.
+ *
+ * Comprimido, las postings y frecuencias de cada palabra son bloques de
+ * CodecPostings en lugar de arreglos planos, y inicioPosiciones guarda un
+ * offset por bloque en lugar de uno por posting.
+ */
+class TrieCongelado {
+private:
+    struct NodoPlano {
+        uint32_t finSubarbol;    // Índice (exclusivo) del último nodo del subárbol
+        uint32_t inicioHijos;    // Offset en etiquetas/hijos
+        uint32_t inicioPostings; // Postings de los nodos anteriores (offset en postings si no está comprimido)
+        uint32_t inicioResumen;  // Offset en resumenes
+    };
+
+    /**
+     * @brief Almacenamiento de un trie construido en memoria
+     */
+    struct Arreglos {
+        vector<NodoPlano> nodos;
+        vector<unsigned char> etiquetas;
+        vector<uint32_t> hijos;
+        vector<uint32_t> postings;
+        vector<uint16_t> frecuencias;
+        vector<uint16_t> maxFrecuencias;
+        vector<uint32_t> posiciones;
+        vector<uint32_t> inicioPosiciones;
+        vector<uint32_t> resumenes;
+        vector<BloquePostings> bloques;
+        vector<uint32_t> datosBloques;
+        vector<uint32_t> inicioBloques; // Primer bloque de cada nodo (+1 centinela)
+        vector<uint32_t> sugerencias;
+        vector<uint32_t> inicioSugerencias;
+        uint32_t universoIds = 0;
+        uint32_t cantidadPostings = 0;
+        bool comprimir = false;
+
+        /**
+         * @brief Emite el subárbol en preorden y devuelve el índice de su nodo
+         */
+        uint32_t emitir(const NodoTrieCompacto* nodo) {
+            const uint32_t indice = static_cast<uint32_t>(nodos.size());
+            nodos.push_back({0, static_cast<uint32_t>(etiquetas.size()), cantidadPostings,
+                             static_cast<uint32_t>(resumenes.size())});
+            cantidadPostings += static_cast<uint32_t>(nodo->postings.size());
+
+            uint32_t offset = static_cast<uint32_t>(posiciones.size());
+            if (comprimir) {
+                inicioBloques.push_back(static_cast<uint32_t>(bloques.size()));
+                CodecPostings::comprimir(nodo->postings.data(), nodo->frecuencias.data(),
+                                         static_cast<uint32_t>(nodo->postings.size()), bloques, datosBloques);
+                for (size_t k = 0; k < nodo->frecuencias.size(); ++k) {
+                    if (k % CodecPostings::TAMANO_BLOQUE == 0) inicioPosiciones.push_back(offset);
+                    offset += nodo->frecuencias[k];
+                }
+            } else {
+                postings.insert(postings.end(), nodo->postings.begin(), nodo->postings.end());
+                frecuencias.insert(frecuencias.end(), nodo->frecuencias.begin(), nodo->frecuencias.end());
+                for (uint16_t frecuencia : nodo->frecuencias) {
+                    inicioPosiciones.push_back(offset);
+                    offset += frecuencia;
+                }
+            }
+            posiciones.insert(posiciones.end(), nodo->posiciones.begin(), nodo->posiciones.end());
+            maxFrecuencias.push_back(nodo->frecuencias.empty()
+                ? 0 : *max_element(nodo->frecuencias.begin(), nodo->frecuencias.end()));
+            if (!nodo->postings.empty()) {
+                universoIds = max(universoIds, nodo->postings.back() + 1);
+            }
+            if (nodo->tieneResumen) {
+                resumenes.insert(resumenes.end(), nodo->resumen.begin(), nodo->resumen.end());
+            }
+
+            vector<pair<unsigned char, const NodoTrieCompacto*>> ordenados;
+            ordenados.reserve(nodo->children.size());
+            for (const auto& par : nodo->children) {
+                ordenados.emplace_back(static_cast<unsigned char>(par.first), par.second.get());
+            }
+            sort(ordenados.begin(), ordenados.end());
+
+            const size_t bloque = etiquetas.size();
+            for (const auto& par : ordenados) {
+                etiquetas.push_back(par.first);
+                hijos.push_back(0);
+            }
+            for (size_t k = 0; k < ordenados.size(); ++k) {
+                hijos[bloque + k] = emitir(ordenados[k].second);
+            }
+
+            nodos[indice].finSubarbol = static_cast<uint32_t>(nodos.size());
+            return indice;
+        }
+
+        /**
+         * @brief Agrega a 'destino' los IDs de la palabra terminal del nodo (ya emitido)
+         */
+        void agregarPropios(uint32_t nodo, vector<uint32_t>& destino) const {
+            const uint32_t df = nodos[nodo + 1].inicioPostings - nodos[nodo].inicioPostings;
+            if (comprimir) {
+                ListaPostings::comprimida(bloques.data() + inicioBloques[nodo], datosBloques.data(), df)
+                    .recorrer([&destino](const uint32_t* ids, const uint16_t*, uint32_t cantidad) {
+                        destino.insert(destino.end(), ids, ids + cantidad);
+                    }, false);
+            } else {
+                destino.insert(destino.end(), postings.begin() + nodos[nodo].inicioPostings,
+                               postings.begin() + nodos[nodo + 1].inicioPostings);
+            }
+        }
+
+        /**
+         * @brief Las SUGERENCIAS_POR_NODO mejores películas de cada subárbol con más postings que eso
+         *
+         * Se calcula de abajo hacia arriba (preorden invertido): las mejores de un nodo
+         * están entre las de su palabra y las mejores de cada hijo, porque lo que
+         * supera a una película en el subárbol de un hijo también la supera en el
+         * del padre. Los hijos sin lista aportan su subárbol completo, que es corto.
+         */
+        void calcularSugerencias(const function<float(uint32_t)>& calidad) {
+            const uint32_t total = static_cast<uint32_t>(nodos.size() - 1); // Sin el centinela
+            vector<vector<uint32_t>> mejores(total);
+            vector<uint32_t> ids;
+            vector<pair<float, uint32_t>> candidatos;
+            auto subarbolCorto = [this](uint32_t nodo) {
+                return nodos[nodos[nodo].finSubarbol].inicioPostings - nodos[nodo].inicioPostings <=
+                       SUGERENCIAS_POR_NODO;
+            };
+            for (uint32_t nodo = total; nodo-- > 0;) {
+                if (subarbolCorto(nodo)) continue;
+                ids.clear();
+                agregarPropios(nodo, ids);
+                for (uint32_t h = nodos[nodo].inicioHijos; h < nodos[nodo + 1].inicioHijos; ++h) {
+                    const uint32_t hijo = hijos[h];
+                    if (!subarbolCorto(hijo)) {
+                        ids.insert(ids.end(), mejores[hijo].begin(), mejores[hijo].end());
+                        continue;
+                    }
+                    for (uint32_t i = hijo; i < nodos[hijo].finSubarbol; ++i) agregarPropios(i, ids);
+                }
+                sort(ids.begin(), ids.end());
+                ids.erase(unique(ids.begin(), ids.end()), ids.end());
+                candidatos.clear();
+                for (uint32_t id : ids) candidatos.emplace_back(calidad(id), id);
+                mejores[nodo] = mejoresPorCalidad(candidatos, SUGERENCIAS_POR_NODO);
+            }
+
+            inicioSugerencias.reserve(nodos.size());
+            for (uint32_t nodo = 0; nodo < total; ++nodo) {
+                inicioSugerencias.push_back(static_cast<uint32_t>(sugerencias.size()));
+                sugerencias.insert(sugerencias.end(), mejores[nodo].begin(), mejores[nodo].end());
+            }
+            inicioSugerencias.push_back(static_cast<uint32_t>(sugerencias.size()));
+        }
+    };
+
+    shared_ptr<const Arreglos> propios; // Nulo si las vistas apuntan a una imagen mapeada
+    Vista<NodoPlano> nodos;      // Incluye un nodo centinela al final
+    Vista<unsigned char> etiquetas;
+    Vista<uint32_t> hijos;
+    Vista<uint32_t> postings;
+    Vista<uint16_t> frecuencias; // Paralelo a postings
+    Vista<uint16_t> maxFrecuencias; // Mayor frecuencia de la palabra terminal de cada nodo
+    Vista<uint32_t> posiciones;
+    Vista<uint32_t> inicioPosiciones; // Offset en posiciones de cada posting o bloque (+1 centinela)
+    Vista<uint32_t> resumenes;
+    Vista<BloquePostings> bloques;    // Vacías si no está comprimido
+    Vista<uint32_t> datosBloques;
+    Vista<uint32_t> inicioBloques;
+    Vista<uint32_t> sugerencias;       // Mejores IDs por calidad de cada subárbol largo
+    Vista<uint32_t> inicioSugerencias; // Por nodo (+1 centinela); vacío si no se precalcularon
+    uint32_t universoIds = 0;    // Mayor ID indexado + 1
+
+public:
+    static constexpr size_t SUGERENCIAS_POR_NODO = 20; // El doble de la página del menú
+
+    TrieCongelado() = default;
+
+    /**
+     * @param comprimir Si es true las postings se guardan en bloques de CodecPostings
+     * @param calidad Si no es nula, se precalculan las mejores películas por prefijo
+     *        según esta puntuación estática (ver mejoresConPrefijo)
+     */
+    static TrieCongelado construir(const NodoTrieCompacto* raiz, bool comprimir = false,
+                                   const function<float(uint32_t)>& calidad = nullptr) {
+        auto arreglos = make_shared<Arreglos>();
+        arreglos->comprimir = comprimir;
+        arreglos->emitir(raiz);
+        arreglos->inicioPosiciones.push_back(static_cast<uint32_t>(arreglos->posiciones.size()));
+        arreglos->nodos.push_back({0, static_cast<uint32_t>(arreglos->etiquetas.size()), arreglos->cantidadPostings,
+                                   static_cast<uint32_t>(arreglos->resumenes.size())});
+        arreglos->nodos.back().finSubarbol = static_cast<uint32_t>(arreglos->nodos.size());
+        if (comprimir) {
+            arreglos->inicioBloques.push_back(static_cast<uint32_t>(arreglos->bloques.size()));
+        }
+        if (calidad) {
+            arreglos->calcularSugerencias(calidad);
+        }
+        arreglos->nodos.shrink_to_fit();
+        arreglos->etiquetas.shrink_to_fit();
+        arreglos->hijos.shrink_to_fit();
+        arreglos->postings.shrink_to_fit();
+        arreglos->frecuencias.shrink_to_fit();
+        arreglos->maxFrecuencias.shrink_to_fit();
+        arreglos->posiciones.shrink_to_fit();
+        arreglos->inicioPosiciones.shrink_to_fit();
+        arreglos->resumenes.shrink_to_fit();
+        arreglos->bloques.shrink_to_fit();
+        arreglos->datosBloques.shrink_to_fit();
+        arreglos->inicioBloques.shrink_to_fit();
+        arreglos->sugerencias.shrink_to_fit();
+
+        TrieCongelado trie;
+        trie.nodos = Vista<NodoPlano>(arreglos->nodos);
+        trie.etiquetas = Vista<unsigned char>(arreglos->etiquetas);
+        trie.hijos = Vista<uint32_t>(arreglos->hijos);
+        trie.postings = Vista<uint32_t>(arreglos->postings);
+        trie.frecuencias = Vista<uint16_t>(arreglos->frecuencias);
+        trie.maxFrecuencias = Vista<uint16_t>(arreglos->maxFrecuencias);
+        trie.posiciones = Vista<uint32_t>(arreglos->posiciones);
+        trie.inicioPosiciones = Vista<uint32_t>(arreglos->inicioPosiciones);
+        trie.resumenes = Vista<uint32_t>(arreglos->resumenes);
+        trie.bloques = Vista<BloquePostings>(arreglos->bloques);
+        trie.datosBloques = Vista<uint32_t>(arreglos->datosBloques);
+        trie.inicioBloques = Vista<uint32_t>(arreglos->inicioBloques);
+        trie.sugerencias = Vista<uint32_t>(arreglos->sugerencias);
+        trie.inicioSugerencias = Vista<uint32_t>(arreglos->inicioSugerencias);
+        trie.universoIds = arreglos->universoIds;
+        trie.propios = move(arreglos);
+        return trie;
+    }
+
+    void escribir(EscritorImagen& escritor) const {
+        escritor.escribir(nodos);
+        escritor.escribir(etiquetas);
+        escritor.escribir(hijos);
+        escritor.escribir(postings);
+        escritor.escribir(frecuencias);
+        escritor.escribir(maxFrecuencias);
+        escritor.escribir(posiciones);
+        escritor.escribir(inicioPosiciones);
+        escritor.escribir(resumenes);
+        escritor.escribir(bloques);
+        escritor.escribir(datosBloques);
+        escritor.escribir(inicioBloques);
+        escritor.escribir(sugerencias);
+        escritor.escribir(inicioSugerencias);
+        escritor.escribirValor(universoIds);
+    }
+
+    /**
+     * @brief Trie cuyos arreglos apuntan a la imagen; deben vivir mientras ella esté mapeada
+     *
+     * Solo se comprueba que los tamaños de los arreglos sean coherentes entre sí
+     * (O(1)); la integridad del contenido la garantiza la suma de verificación.
+     */
+    static TrieCongelado leer(LectorImagen& lector) {
+        TrieCongelado trie;
+        trie.nodos = lector.leer<NodoPlano>();
+        trie.etiquetas = lector.leer<unsigned char>();
+        trie.hijos = lector.leer<uint32_t>();
+        trie.postings = lector.leer<uint32_t>();
+        trie.frecuencias = lector.leer<uint16_t>();
+        trie.maxFrecuencias = lector.leer<uint16_t>();
+        trie.posiciones = lector.leer<uint32_t>();
+        trie.inicioPosiciones = lector.leer<uint32_t>();
+        trie.resumenes = lector.leer<uint32_t>();
+        trie.bloques = lector.leer<BloquePostings>();
+        trie.datosBloques = lector.leer<uint32_t>();
+        trie.inicioBloques = lector.leer<uint32_t>();
+        trie.sugerencias = lector.leer<uint32_t>();
+        trie.inicioSugerencias = lector.leer<uint32_t>();
+        trie.universoIds = lector.leerValor<uint32_t>();
+
+        const bool coherente = !trie.nodos.empty() && trie.postingsCoherentes() &&
+            !trie.inicioPosiciones.empty() &&
+            trie.nodos.back().inicioHijos == trie.etiquetas.size() &&
+            trie.nodos.back().inicioResumen == trie.resumenes.size() &&
+            trie.hijos.size() == trie.etiquetas.size() &&
+            trie.maxFrecuencias.size() + 1 == trie.nodos.size() &&
+            trie.inicioPosiciones.back() == trie.posiciones.size() &&
+            (trie.inicioSugerencias.empty() ? trie.sugerencias.empty()
+                                            : trie.inicioSugerencias.size() == trie.nodos.size() &&
+                                              trie.inicioSugerencias.back() == trie.sugerencias.size());
+        if (!coherente) {
+            throw runtime_error("trie con arreglos incoherentes");
+        }
+        return trie;
+    }
+
+    bool vacio() const {
+        return nodos.empty();
+    }
+
+    uint32_t universo() const {
+        return universoIds;
+    }
+
+    vector<uint32_t> buscarPorPrefijo(const string& prefijo) const {
+        uint32_t nodo;
+        if (!navegar(NormalizadorTexto::normalizar(prefijo), nodo)) return {};
+
+        // Recorrido lineal del subárbol: los nodos con resumen se saltan completos
+        vector<ListaPostings> listas;
+        const uint32_t fin = nodos[nodo].finSubarbol;
+        for (uint32_t i = nodo; i < fin;) {
+            const NodoPlano& actual = nodos[i];
+            const NodoPlano& siguiente = nodos[i + 1];
+            if (actual.inicioResumen != siguiente.inicioResumen) {
+                listas.push_back(RangoIds(resumenes.data() + actual.inicioResumen,
+                                          resumenes.data() + siguiente.inicioResumen));
+                i = actual.finSubarbol;
+                continue;
+            }
+            if (actual.inicioPostings != siguiente.inicioPostings) {
+                listas.push_back(listaDe(i));
+            }
+            ++i;
+        }
+        return OperacionesPostings::fusionar(listas, universoIds);
+    }
+
+    /**
+     * @brief Postings de todas las palabras con el prefijo: lo que cuesta puntuarlo, en O(m)
+     */
+    size_t postingsConPrefijo(const string& prefijo) const {
+        uint32_t nodo;
+        if (!navegar(NormalizadorTexto::normalizar(prefijo), nodo)) return 0;
+        return nodos[nodos[nodo].finSubarbol].inicioPostings - nodos[nodo].inicioPostings;
+    }
+
+    vector<uint32_t> buscarPalabraExacta(const string& palabra) const {
+        uint32_t nodo;
+        if (!navegar(NormalizadorTexto::normalizar(palabra), nodo)) return {};
+        return listaDe(nodo).aIds();
+    }
+
+    /**
+     * @brief Hasta n IDs con una palabra que empieza con 'prefijo' (ya normalizado), de mayor a menor calidad
+     *
+     * Solo se consideran los IDs con admitir(id). Si el nodo del prefijo tiene sus
+     * mejores precalculadas y alcanzan n admitidos, cuesta O(m + n). Si no (n
+     * mayor que SUGERENCIAS_POR_NODO o muchas no admitidas) se combinan la
+     * palabra del nodo y las listas de los hijos, bajando solo por los que
+     * tampoco alcanzan; calidad(id) debe ser la usada al construir.
+     * Empates por ID creciente.
+     */
+    template<typename Calidad, typename Admitir>
+    vector<uint32_t> mejoresConPrefijo(const string& prefijo, size_t n, Calidad&& calidad, Admitir&& admitir) const {
+        uint32_t nodo;
+        if (n == 0 || !navegar(prefijo, nodo)) return {};
+
+        vector<pair<float, uint32_t>> candidatos;
+        if (agregarMejores(nodo, n, calidad, admitir, candidatos)) {
+            vector<uint32_t> resultado;
+            resultado.reserve(candidatos.size());
+            for (const auto& candidato : candidatos) resultado.push_back(candidato.second);
+            return resultado;
+        }
+        // Una película puede aparecer en varias palabras del subárbol
+        sort(candidatos.begin(), candidatos.end(),
+             [](const pair<float, uint32_t>& a, const pair<float, uint32_t>& b) { return a.second < b.second; });
+        candidatos.erase(unique(candidatos.begin(), candidatos.end()), candidatos.end());
+        return mejoresPorCalidad(candidatos, n);
+    }
+
+    /**
+     * @brief IDs de los n mejores pares (calidad, id): mayor calidad primero, empates por ID creciente
+     */
+    static vector<uint32_t> mejoresPorCalidad(vector<pair<float, uint32_t>>& candidatos, size_t n) {
+        auto mejor = [](const pair<float, uint32_t>& a, const pair<float, uint32_t>& b) {
+            return a.first != b.first ? a.first > b.first : a.second < b.second;
+        };
+        const size_t cantidad = min(n, candidatos.size());
+        partial_sort(candidatos.begin(), candidatos.begin() + cantidad, candidatos.end(), mejor);
+        vector<uint32_t> resultado;
+        resultado.reserve(cantidad);
+        for (size_t i = 0; i < cantidad; ++i) resultado.push_back(candidatos[i].second);
+        return resultado;
+    }
+
+    /**
+     * @brief Visita cada palabra del subárbol del prefijo con sus postings y frecuencias
+     *
+     * El visitante recibe (palabra, lista, frecuenciaMaxima), en orden
+     * lexicográfico; lista.df es la frecuencia documental de la palabra en este Trie.
+     */
+    template<typename Visitante>
+    void recorrerTerminos(const string& prefijo, Visitante&& visitar) const {
+        string palabra = NormalizadorTexto::normalizar(prefijo);
+        uint32_t nodo;
+        if (!navegar(palabra, nodo)) return;
+        terminosDesde(nodo, palabra, visitar);
+    }
+
+    /**
+     * @brief Películas con la palabra (ya normalizada); 0 si no está
+     */
+    uint32_t frecuenciaDocumental(string_view palabra) const {
+        uint32_t nodo;
+        if (!navegar(palabra, nodo)) return 0;
+        return nodos[nodo + 1].inicioPostings - nodos[nodo].inicioPostings;
+    }
+
+    /**
+     * @brief Visita las palabras a distancia de edición 1..maxDistancia de 'palabra' usada como prefijo
+     *
+     * Una palabra del Trie coincide si alguno de sus prefijos está a esa distancia,
+     * así que "batmna" encuentra "batman" y "batmanía". El visitante recibe
+     * (palabra, lista, frecuenciaMaxima, distancia); las coincidencias exactas son
+     * las de recorrerTerminos y no se repiten. Cada nodo visitado descuenta 1 de
+     * 'presupuesto'.
+     *
+     * @return false si se agotó el presupuesto y el recorrido quedó incompleto
+     */
+    template<typename Visitante>
+    bool recorrerDifusos(const string& palabra, uint32_t maxDistancia, size_t& presupuesto,
+                         Visitante&& visitar) const {
+        if (nodos.empty()) return true;
+        DistanciaEdicion distancia(NormalizadorTexto::normalizar(palabra), maxDistancia);
+        string camino;
+        return difusosDesde(0, 0, numeric_limits<uint32_t>::max(), distancia, camino, presupuesto, visitar);
+    }
+
+    /**
+     * @brief Posting list con posiciones de una palabra exacta; false si no existe
+     */
+    bool obtenerLista(const string& palabra, ListaPosicional& lista) const {
+        uint32_t nodo;
+        if (!navegar(NormalizadorTexto::normalizar(palabra), nodo)) return false;
+        lista = listaDeNodo(nodo);
+        return lista.postings.df > 0;
+    }
+
+    /**
+     * @brief Visita la ListaPosicional de cada palabra del subárbol del prefijo
+     */
+    template<typename Visitante>
+    void recorrerListas(const string& prefijo, Visitante&& visitar) const {
+        uint32_t nodo;
+        if (!navegar(NormalizadorTexto::normalizar(prefijo), nodo)) return;
+
+        const uint32_t fin = nodos[nodo].finSubarbol;
+        for (uint32_t i = nodo; i < fin; ++i) {
+            if (nodos[i + 1].inicioPostings != nodos[i].inicioPostings) {
+                visitar(listaDeNodo(i));
+            }
+        }
+    }
+
+    /**
+     * @brief Reconstruye el árbol mutable equivalente (sin resúmenes) para fusionarlo con otro Trie
+     *
+     * Complejidad: O(nodos + postings + posiciones)
+     */
+    unique_ptr<NodoTrieCompacto> descongelar() const {
+        auto raiz = make_unique<NodoTrieCompacto>();
+        if (!nodos.empty()) {
+            descongelarNodo(0, *raiz);
+        }
+        return raiz;
+    }
+
+    size_t memoriaPostings() const {
+        return nodos.size() * sizeof(NodoPlano) + etiquetas.size() +
+               (frecuencias.size() + maxFrecuencias.size()) * sizeof(uint16_t) +
+               (hijos.size() + postings.size() + resumenes.size() + posiciones.size() + inicioPosiciones.size() +
+                datosBloques.size() + inicioBloques.size() + sugerencias.size() + inicioSugerencias.size()) *
+                   sizeof(uint32_t) +
+               bloques.size() * sizeof(BloquePostings);
+    }
+
+private:
+    bool comprimido() const {
+        return !inicioBloques.empty();
+    }
+
+    bool postingsCoherentes() const {
+        if (comprimido()) {
+            return inicioBloques.size() == nodos.size() && inicioBloques.back() == bloques.size() &&
+                   postings.empty() && frecuencias.empty() && inicioPosiciones.size() == bloques.size() + 1;
+        }
+        return bloques.empty() && datosBloques.empty() && nodos.back().inicioPostings == postings.size() &&
+               frecuencias.size() == postings.size() && inicioPosiciones.size() == postings.size() + 1;
+    }
+
+    /**
+     * @brief Postings y frecuencias de la palabra que termina en el nodo
+     */
+    ListaPostings listaDe(uint32_t nodo) const {
+        const uint32_t inicio = nodos[nodo].inicioPostings;
+        const uint32_t cantidad = nodos[nodo + 1].inicioPostings - inicio;
+        if (comprimido()) {
+            return ListaPostings::comprimida(bloques.data() + inicioBloques[nodo], datosBloques.data(), cantidad);
+        }
+        return ListaPostings(postings.data() + inicio, frecuencias.data() + inicio, cantidad);
+    }
+
+    /**
+     * @brief Agrega a 'destino' un superconjunto de las n mejores películas admitidas del subárbol
+     *
+     * Vale el mismo argumento que en calcularSugerencias: las n mejores admitidas
+     * de un nodo están entre las de su palabra y las n mejores admitidas de cada
+     * hijo. Una lista precalculada sirve si da n admitidas o si es más corta que
+     * SUGERENCIAS_POR_NODO (contiene el subárbol entero). Devuelve true si lo
+     * agregado ya es el resultado, en orden y sin repetidos.
+     */
+    template<typename Calidad, typename Admitir>
+    bool agregarMejores(uint32_t nodo, size_t n, Calidad& calidad, Admitir& admitir,
+                        vector<pair<float, uint32_t>>& destino) const {
+        auto agregarPalabra = [&](uint32_t i) {
+            listaDe(i).recorrer([&](const uint32_t* tramo, const uint16_t*, uint32_t cantidad) {
+                for (uint32_t k = 0; k < cantidad; ++k) {
+                    if (admitir(tramo[k])) destino.emplace_back(calidad(tramo[k]), tramo[k]);
+                }
+            }, false);
+        };
+
+        if (inicioSugerencias.empty() || inicioSugerencias[nodo] == inicioSugerencias[nodo + 1]) {
+            // Sin precálculo o subárbol corto: se recorre entero
+            for (uint32_t i = nodo; i < nodos[nodo].finSubarbol; ++i) agregarPalabra(i);
+            return false;
+        }
+
+        const size_t antes = destino.size();
+        const uint32_t inicio = inicioSugerencias[nodo];
+        const uint32_t fin = inicioSugerencias[nodo + 1];
+        for (uint32_t i = inicio; i < fin && destino.size() - antes < n; ++i) {
+            if (admitir(sugerencias[i])) destino.emplace_back(calidad(sugerencias[i]), sugerencias[i]);
+        }
+        if (destino.size() - antes == n || fin - inicio < SUGERENCIAS_POR_NODO) return antes == 0;
+        destino.resize(antes);
+
+        agregarPalabra(nodo);
+        for (uint32_t h = nodos[nodo].inicioHijos; h < nodos[nodo + 1].inicioHijos; ++h) {
+            agregarMejores(hijos[h], n, calidad, admitir, destino);
+        }
+        return false;
+    }
+
+    /**
+     * @brief Offsets en inicioPosiciones de la primera posting del nodo y del siguiente
+     */
+    pair<uint32_t, uint32_t> rangoInicioPosiciones(uint32_t nodo) const {
+        if (comprimido()) return {inicioBloques[nodo], inicioBloques[nodo + 1]};
+        return {nodos[nodo].inicioPostings, nodos[nodo + 1].inicioPostings};
+    }
+
+    bool navegar(string_view palabra, uint32_t& nodo) const {
+        if (nodos.empty()) return false;
+        nodo = 0;
+        for (char c : palabra) {
+            const unsigned char etiqueta = static_cast<unsigned char>(c);
+            const unsigned char* inicio = etiquetas.data() + nodos[nodo].inicioHijos;
+            const unsigned char* fin = etiquetas.data() + nodos[nodo + 1].inicioHijos;
+            const unsigned char* it = lower_bound(inicio, fin, etiqueta);
+            if (it == fin || *it != etiqueta) {
+                return false;
+            }
+            nodo = hijos[it - etiquetas.data()];
+        }
+        return true;
+    }
+
+    /**
+     * @param palabra Camino hasta 'nodo'; se restaura al volver
+     */
+    template<typename Visitante>
+    void terminosDesde(uint32_t nodo, string& palabra, Visitante& visitar) const {
+        if (nodos[nodo + 1].inicioPostings != nodos[nodo].inicioPostings) {
+            visitar(string_view(palabra), listaDe(nodo), maxFrecuencias[nodo]);
+        }
+        for (uint32_t k = nodos[nodo].inicioHijos; k < nodos[nodo + 1].inicioHijos; ++k) {
+            palabra.push_back(static_cast<char>(etiquetas[k]));
+            terminosDesde(hijos[k], palabra, visitar);
+            palabra.pop_back();
+        }
+    }
+
+    /**
+     * @param mejor Menor distancia de la palabra contra los prefijos del camino hasta 'nodo'
+     * @param camino Etiquetas desde la raíz hasta 'nodo'; se restaura al volver
+     */
+    template<typename Visitante>
+    bool difusosDesde(uint32_t nodo, size_t nivel, uint32_t mejor, DistanciaEdicion& distancia, string& camino,
+                      size_t& presupuesto, Visitante& visitar) const {
+        if (presupuesto == 0) return false;
+        --presupuesto;
+        mejor = min(mejor, distancia.distancia(nivel));
+        if (mejor == 0) return true; // Todo el subárbol es coincidencia exacta
+        if (mejor <= distancia.distanciaMaxima()) {
+            visitarDifuso(nodo, camino, mejor, visitar);
+        }
+
+        for (uint32_t k = nodos[nodo].inicioHijos; k < nodos[nodo + 1].inicioHijos; ++k) {
+            camino.push_back(static_cast<char>(etiquetas[k]));
+            bool completo = true;
+            if (distancia.avanzar(nivel, etiquetas[k])) {
+                completo = difusosDesde(hijos[k], nivel + 1, mejor, distancia, camino, presupuesto, visitar);
+            } else if (mejor <= distancia.distanciaMaxima()) {
+                // Ningún descendiente se acerca más: todo el subárbol queda a 'mejor'
+                completo = difusosSubarbol(hijos[k], mejor, camino, presupuesto, visitar);
+            }
+            camino.pop_back();
+            if (!completo) return false;
+        }
+        return true;
+    }
+
+    template<typename Visitante>
+    bool difusosSubarbol(uint32_t nodo, uint32_t distancia, string& camino, size_t& presupuesto,
+                         Visitante& visitar) const {
+        if (presupuesto == 0) return false;
+        --presupuesto;
+        visitarDifuso(nodo, camino, distancia, visitar);
+        for (uint32_t k = nodos[nodo].inicioHijos; k < nodos[nodo + 1].inicioHijos; ++k) {
+            camino.push_back(static_cast<char>(etiquetas[k]));
+            const bool completo = difusosSubarbol(hijos[k], distancia, camino, presupuesto, visitar);
+            camino.pop_back();
+            if (!completo) return false;
+        }
+        return true;
+    }
+
+    template<typename Visitante>
+    void visitarDifuso(uint32_t nodo, const string& camino, uint32_t distancia, Visitante& visitar) const {
+        if (nodos[nodo + 1].inicioPostings != nodos[nodo].inicioPostings) {
+            visitar(string_view(camino), listaDe(nodo), maxFrecuencias[nodo], distancia);
+        }
+    }
+
+    void descongelarNodo(uint32_t nodo, NodoTrieCompacto& destino) const {
+        const ListaPostings lista = listaDe(nodo);
+        destino.postings.clear();
+        destino.frecuencias.clear();
+        lista.recorrer([&destino](const uint32_t* ids, const uint16_t* frecuencias, uint32_t cantidad) {
+            destino.postings.insert(destino.postings.end(), ids, ids + cantidad);
+            destino.frecuencias.insert(destino.frecuencias.end(), frecuencias, frecuencias + cantidad);
+        });
+        const auto [inicio, fin] = rangoInicioPosiciones(nodo);
+        destino.posiciones.assign(posiciones.begin() + inicioPosiciones[inicio],
+                                  posiciones.begin() + inicioPosiciones[fin]);
+        destino.esFinDePalabra = lista.df > 0;
+        for (uint32_t k = nodos[nodo].inicioHijos; k < nodos[nodo + 1].inicioHijos; ++k) {
+            auto& hijo = destino.children[static_cast<char>(etiquetas[k])];
+            hijo = make_unique<NodoTrieCompacto>();
+            descongelarNodo(hijos[k], *hijo);
+        }
+    }
+
+    ListaPosicional listaDeNodo(uint32_t nodo) const {
+        ListaPosicional lista;
+        lista.postings = listaDe(nodo);
+        lista.posiciones = posiciones.data();
+        lista.inicioPosiciones = inicioPosiciones.data() + rangoInicioPosiciones(nodo).first;
+        return lista;
+    }
+};
+
+/**
+ * @brief Trie compacto con una posting list de IDs de 32 bits por palabra
+ *
+ * Una palabra de longitud L cuesta un único ID en su nodo terminal en lugar de
+ * L punteros. La búsqueda por prefijo fusiona las postings del subárbol al
+ * momento de la consulta, cortando el recorrido en los nodos con resumen.
+ */
+class TrieCompacto {
+private:
+    unique_ptr<NodoTrieCompacto> raiz;
+    mutable mutex trie_mutex;
+
+public:
+    static constexpr size_t LIMITE_RESUMEN_DEFECTO = 1024;
+
+    TrieCompacto() : raiz(make_unique<NodoTrieCompacto>()) {}
+
+    /**
+     * @brief Trie sobre un árbol ya construido (ver TrieCongelado::descongelar)
+     */
+    explicit TrieCompacto(unique_ptr<NodoTrieCompacto> raiz) : raiz(move(raiz)) {}
+
+    /**
+     * @param palabra Token ya normalizado (ver NormalizadorTexto::paraCadaToken)
+     * @param posicion Índice de la palabra dentro del campo del documento
+     */
+    void insertar(string_view palabra, uint32_t id, uint32_t posicion) {
+        lock_guard<mutex> lock(trie_mutex);
+        auto actual = raiz.get();
+
+        for (char c : palabra) {
+            auto& hijo = actual->children[c];
+            if (!hijo) {
+                hijo = make_unique<NodoTrieCompacto>();
+            }
+            actual = hijo.get();
+        }
+        actual->esFinDePalabra = true;
+        insertarOrdenado(*actual, id, posicion);
+    }
+
+    /**
+     * @brief Precalcula los resúmenes de subárbol cuya unión no supera el límite
+     *
+     * Debe llamarse una vez terminada la indexación. Solo se guarda resumen en los
+     * nodos donde confluyen al menos dos listas, para no duplicar postings.
+     *
+     * Complejidad: O(P × h) donde P = postings totales y h = niveles con resumen
+     */
+    void finalizar(size_t limiteResumen = LIMITE_RESUMEN_DEFECTO) {
+        lock_guard<mutex> lock(trie_mutex);
+        vector<uint32_t> descartado;
+        calcularResumen(raiz.get(), limiteResumen, descartado);
+    }
+
+    /**
+     * @brief Construye la representación plana de solo lectura del Trie
+     *
+     * @param comprimirPostings Guarda las postings en bloques de CodecPostings
+     * @param calidad Puntuación estática para precalcular las mejores por prefijo (nula = no)
+     */
+    TrieCongelado congelar(bool comprimirPostings = false, const function<float(uint32_t)>& calidad = nullptr) const {
+        lock_guard<mutex> lock(trie_mutex);
+        return TrieCongelado::construir(raiz.get(), comprimirPostings, calidad);
+    }
+
+    /**
+     * @brief Absorbe todas las palabras de otro Trie, que queda vacío
+     *
+     * Pensado para combinar Tries locales de hilos que indexaron rangos de IDs
+     * consecutivos: si 'otro' contiene IDs mayores, las postings se concatenan.
+     *
+     * Complejidad: O(nodos de 'otro' + postings de las palabras compartidas)
+     */
+    void fusionar(TrieCompacto& otro) {
+        if (this == &otro) return;
+        scoped_lock lock(trie_mutex, otro.trie_mutex);
+        if (raiz->children.empty() && raiz->postings.empty()) {
+            swap(raiz, otro.raiz);
+            return;
+        }
+        auto origen = move(otro.raiz);
+        otro.raiz = make_unique<NodoTrieCompacto>();
+        fusionarNodos(raiz.get(), move(origen));
+    }
+
+    /**
+     * @brief Suma 'desplazamiento' a todos los IDs (de IDs locales de un fragmento a globales)
+     *
+     * Complejidad: O(nodos + postings)
+     */
+    void desplazarIds(uint32_t desplazamiento) {
+        if (desplazamiento == 0) return;
+        lock_guard<mutex> lock(trie_mutex);
+        desplazarSubarbol(raiz.get(), desplazamiento);
+    }
+
+    /**
+     * @brief Elimina las palabras que aparecen en más de maxDocumentos documentos
+     *
+     * Debe llamarse antes de finalizar(): los resúmenes ya calculados incluirían
+     * las postings podadas. Las ramas que quedan sin palabras se liberan.
+     *
+     * @param podadas Recibe las palabras eliminadas
+     * @return Cantidad de postings (documento, palabra) eliminadas
+     */
+    size_t podar(size_t maxDocumentos, vector<string>& podadas) {
+        lock_guard<mutex> lock(trie_mutex);
+        string camino;
+        size_t postings = 0;
+        podarSubarbol(raiz.get(), maxDocumentos, camino, podadas, postings);
+        return postings;
+    }
+
+    /**
+     * @brief Quita de todas las palabras los documentos para los que borrar(id) es true
+     *
+     * Las palabras que quedan sin documentos y las ramas vacías se liberan. Los
+     * resúmenes se descartan: hay que volver a llamar a finalizar() antes de congelar.
+     *
+     * @return Cantidad de postings (documento, palabra) eliminadas
+     * Complejidad: O(nodos + postings + posiciones)
+     */
+    template<typename Predicado>
+    size_t eliminarIds(Predicado&& borrar) {
+        lock_guard<mutex> lock(trie_mutex);
+        size_t eliminadas = 0;
+        eliminarEnSubarbol(raiz.get(), borrar, eliminadas);
+        return eliminadas;
+    }
+
+    /**
+     * @brief Libera todos los nodos (por ejemplo, tras congelar el Trie)
+     */
+    void vaciar() {
+        lock_guard<mutex> lock(trie_mutex);
+        raiz = make_unique<NodoTrieCompacto>();
+    }
+
+    vector<uint32_t> buscarPorPrefijo(const string& prefijo) const {
+        lock_guard<mutex> lock(trie_mutex);
+        const NodoTrieCompacto* nodo = navegar(NormalizadorTexto::normalizar(prefijo));
+        if (!nodo) return {};
+
+        vector<ListaPostings> listas;
+        recolectarListas(nodo, listas);
+        return OperacionesPostings::fusionar(listas);
+    }
+
+    vector<uint32_t> buscarPalabraExacta(const string& palabra) const {
+        lock_guard<mutex> lock(trie_mutex);
+        const NodoTrieCompacto* nodo = navegar(NormalizadorTexto::normalizar(palabra));
+        return (nodo && nodo->esFinDePalabra) ? nodo->postings : vector<uint32_t>{};
+    }
+
+    /**
+     * @brief Visita cada palabra del subárbol del prefijo con sus postings y frecuencias
+     *
+     * El visitante recibe (palabra, lista, frecuenciaMaxima), sin orden entre hermanos.
+     */
+    template<typename Visitante>
+    void recorrerTerminos(const string& prefijo, Visitante&& visitar) const {
+        lock_guard<mutex> lock(trie_mutex);
+        string palabra = NormalizadorTexto::normalizar(prefijo);
+        const NodoTrieCompacto* nodo = navegar(palabra);
+        if (nodo) {
+            recorrerSubarbol(nodo, palabra, visitar);
+        }
+    }
+
+    /**
+     * @brief Visita las palabras a distancia de edición 1..maxDistancia de 'palabra' usada como prefijo
+     *
+     * Una palabra del Trie coincide si alguno de sus prefijos está a esa distancia,
+     * así que "batmna" encuentra "batman" y "batmanía". El visitante recibe
+     * (palabra, lista, frecuenciaMaxima, distancia); las coincidencias exactas son
+     * las de recorrerTerminos y no se repiten. Cada nodo visitado descuenta 1 de
+     * 'presupuesto'.
+     *
+     * @return false si se agotó el presupuesto y el recorrido quedó incompleto
+     */
+    template<typename Visitante>
+    bool recorrerDifusos(const string& palabra, uint32_t maxDistancia, size_t& presupuesto,
+                         Visitante&& visitar) const {
+        lock_guard<mutex> lock(trie_mutex);
+        DistanciaEdicion distancia(NormalizadorTexto::normalizar(palabra), maxDistancia);
+        string camino;
+        return difusosDesde(raiz.get(), 0, numeric_limits<uint32_t>::max(), distancia, camino, presupuesto,
+                            visitar);
+    }
+
+    /**
+     * @brief Posting list con posiciones de una palabra exacta; false si no existe
+     *
+     * Sin offsets por documento: CursorPosicional los acumula al recorrerla.
+     */
+    bool obtenerLista(const string& palabra, ListaPosicional& lista) const {
+        lock_guard<mutex> lock(trie_mutex);
+        const NodoTrieCompacto* nodo = navegar(NormalizadorTexto::normalizar(palabra));
+        if (!nodo || nodo->postings.empty()) return false;
+        lista = listaDeNodo(nodo);
+        return true;
+    }
+
+    /**
+     * @brief Visita la ListaPosicional de cada palabra del subárbol del prefijo
+     */
+    template<typename Visitante>
+    void recorrerListas(const string& prefijo, Visitante&& visitar) const {
+        lock_guard<mutex> lock(trie_mutex);
+        const NodoTrieCompacto* nodo = navegar(NormalizadorTexto::normalizar(prefijo));
+        if (nodo) {
+            recorrerListasSubarbol(nodo, visitar);
+        }
+    }
+
+    /**
+     * @brief Bytes ocupados por postings, posiciones y resúmenes (sin contar nodos)
+     */
+    size_t memoriaPostings() const {
+        lock_guard<mutex> lock(trie_mutex);
+        return memoriaSubarbol(raiz.get());
+    }
+
+private:
+    const NodoTrieCompacto* navegar(const string& palabra) const {
+        const NodoTrieCompacto* actual = raiz.get();
+        for (char c : palabra) {
+            auto it = actual->children.find(c);
+            if (it == actual->children.end()) {
+                return nullptr;
+            }
+            actual = it->second.get();
+        }
+        return actual;
+    }
+
+    static void insertarOrdenado(NodoTrieCompacto& nodo, uint32_t id, uint32_t posicion) {
+        auto& postings = nodo.postings;
+        auto& frecuencias = nodo.frecuencias;
+        auto& posiciones = nodo.posiciones;
+
+        // Caso común: los IDs llegan en orden creciente y se repiten seguidos.
+        // Al saturar la frecuencia se deja de guardar posiciones, para que cada
+        // documento tenga siempre frecuencias[k] posiciones.
+        if (postings.empty() || postings.back() < id) {
+            postings.push_back(id);
+            frecuencias.push_back(1);
+            posiciones.push_back(posicion);
+            return;
+        }
+        if (postings.back() == id) {
+            if (frecuencias.back() < numeric_limits<uint16_t>::max()) {
+                ++frecuencias.back();
+                posiciones.push_back(posicion);
+            }
+            return;
+        }
+        auto it = lower_bound(postings.begin(), postings.end(), id);
+        const size_t pos = it - postings.begin();
+        size_t offset = 0;
+        for (size_t k = 0; k < pos; ++k) offset += frecuencias[k];
+
+        if (it == postings.end() || *it != id) {
+            postings.insert(it, id);
+            frecuencias.insert(frecuencias.begin() + pos, 1);
+            posiciones.insert(posiciones.begin() + offset, posicion);
+        } else if (frecuencias[pos] < numeric_limits<uint16_t>::max()) {
+            auto inicio = posiciones.begin() + offset;
+            posiciones.insert(upper_bound(inicio, inicio + frecuencias[pos], posicion), posicion);
+            ++frecuencias[pos];
+        }
+    }
+
+    /**
+     * @param palabra Camino hasta 'nodo'; se restaura al volver
+     */
+    template<typename Visitante>
+    static void recorrerSubarbol(const NodoTrieCompacto* nodo, string& palabra, Visitante& visitar) {
+        if (!nodo->postings.empty()) {
+            visitar(string_view(palabra), listaPostings(nodo),
+                    *max_element(nodo->frecuencias.begin(), nodo->frecuencias.end()));
+        }
+        for (const auto& par : nodo->children) {
+            palabra.push_back(par.first);
+            recorrerSubarbol(par.second.get(), palabra, visitar);
+            palabra.pop_back();
+        }
+    }
+
+    template<typename Visitante>
+    static bool difusosDesde(const NodoTrieCompacto* nodo, size_t nivel, uint32_t mejor, DistanciaEdicion& distancia,
+                             string& camino, size_t& presupuesto, Visitante& visitar) {
+        if (presupuesto == 0) return false;
+        --presupuesto;
+        mejor = min(mejor, distancia.distancia(nivel));
+        if (mejor == 0) return true; // Todo el subárbol es coincidencia exacta
+        if (mejor <= distancia.distanciaMaxima()) {
+            visitarDifuso(nodo, camino, mejor, visitar);
+        }
+
+        for (const auto& par : nodo->children) {
+            camino.push_back(par.first);
+            bool completo = true;
+            if (distancia.avanzar(nivel, static_cast<unsigned char>(par.first))) {
+                completo = difusosDesde(par.second.get(), nivel + 1, mejor, distancia, camino, presupuesto, visitar);
+            } else if (mejor <= distancia.distanciaMaxima()) {
+                completo = difusosSubarbol(par.second.get(), mejor, camino, presupuesto, visitar);
+            }
+            camino.pop_back();
+            if (!completo) return false;
+        }
+        return true;
+    }
+
+    /**
+     * @brief Visita todo el subárbol a la misma distancia (ningún descendiente se acerca más)
+     */
+    template<typename Visitante>
+    static bool difusosSubarbol(const NodoTrieCompacto* nodo, uint32_t distancia, string& camino,
+                                size_t& presupuesto, Visitante& visitar) {
+        if (presupuesto == 0) return false;
+        --presupuesto;
+        visitarDifuso(nodo, camino, distancia, visitar);
+        for (const auto& par : nodo->children) {
+            camino.push_back(par.first);
+            const bool completo = difusosSubarbol(par.second.get(), distancia, camino, presupuesto, visitar);
+            camino.pop_back();
+            if (!completo) return false;
+        }
+        return true;
+    }
+
+    template<typename Visitante>
+    static void visitarDifuso(const NodoTrieCompacto* nodo, const string& camino, uint32_t distancia,
+                              Visitante& visitar) {
+        if (!nodo->postings.empty()) {
+            visitar(string_view(camino), listaPostings(nodo),
+                    *max_element(nodo->frecuencias.begin(), nodo->frecuencias.end()), distancia);
+        }
+    }
+
+    static ListaPostings listaPostings(const NodoTrieCompacto* nodo) {
+        return ListaPostings(nodo->postings.data(), nodo->frecuencias.data(),
+                             static_cast<uint32_t>(nodo->postings.size()));
+    }
+
+    static ListaPosicional listaDeNodo(const NodoTrieCompacto* nodo) {
+        ListaPosicional lista;
+        lista.postings = listaPostings(nodo);
+        lista.posiciones = nodo->posiciones.data();
+        return lista;
+    }
+
+    template<typename Visitante>
+    static void recorrerListasSubarbol(const NodoTrieCompacto* nodo, Visitante& visitar) {
+        if (!nodo->postings.empty()) {
+            visitar(listaDeNodo(nodo));
+        }
+        for (const auto& par : nodo->children) {
+            recorrerListasSubarbol(par.second.get(), visitar);
+        }
+    }
+
+    static void fusionarNodos(NodoTrieCompacto* destino, unique_ptr<NodoTrieCompacto> origen) {
+        destino->esFinDePalabra = destino->esFinDePalabra || origen->esFinDePalabra;
+        destino->tieneResumen = false;
+        destino->resumen.clear();
+
+        auto& a = destino->postings;
+        auto& b = origen->postings;
+        auto& fa = destino->frecuencias;
+        auto& fb = origen->frecuencias;
+        auto& pa = destino->posiciones;
+        auto& pb = origen->posiciones;
+        if (a.empty()) {
+            a.swap(b);
+            fa.swap(fb);
+            pa.swap(pb);
+        } else if (!b.empty()) {
+            if (a.back() < b.front()) {
+                a.insert(a.end(), b.begin(), b.end());
+                fa.insert(fa.end(), fb.begin(), fb.end());
+                pa.insert(pa.end(), pb.begin(), pb.end());
+            } else {
+                vector<uint32_t> ids;
+                vector<uint16_t> frecuencias;
+                vector<uint32_t> posiciones;
+                ids.reserve(a.size() + b.size());
+                frecuencias.reserve(a.size() + b.size());
+                posiciones.reserve(pa.size() + pb.size());
+                size_t i = 0, j = 0;
+                auto posA = pa.begin();
+                auto posB = pb.begin();
+                while (i < a.size() || j < b.size()) {
+                    if (j == b.size() || (i < a.size() && a[i] < b[j])) {
+                        ids.push_back(a[i]);
+                        frecuencias.push_back(fa[i]);
+                        posiciones.insert(posiciones.end(), posA, posA + fa[i]);
+                        posA += fa[i++];
+                    } else if (i == a.size() || b[j] < a[i]) {
+                        ids.push_back(b[j]);
+                        frecuencias.push_back(fb[j]);
+                        posiciones.insert(posiciones.end(), posB, posB + fb[j]);
+                        posB += fb[j++];
+                    } else {
+                        const uint16_t frecuencia = static_cast<uint16_t>(
+                            min<uint32_t>(uint32_t(fa[i]) + fb[j], numeric_limits<uint16_t>::max()));
+                        const size_t inicio = posiciones.size();
+                        merge(posA, posA + fa[i], posB, posB + fb[j], back_inserter(posiciones));
+                        posiciones.resize(inicio + frecuencia);
+                        ids.push_back(a[i]);
+                        frecuencias.push_back(frecuencia);
+                        posA += fa[i++];
+                        posB += fb[j++];
+                    }
+                }
+                a.swap(ids);
+                fa.swap(frecuencias);
+                pa.swap(posiciones);
+            }
+        }
+
+        for (auto& par : origen->children) {
+            auto& hijo = destino->children[par.first];
+            if (!hijo) {
+                hijo = move(par.second);
+            } else {
+                fusionarNodos(hijo.get(), move(par.second));
+            }
+        }
+    }
+
+    static void desplazarSubarbol(NodoTrieCompacto* nodo, uint32_t desplazamiento) {
+        for (uint32_t& id : nodo->postings) id += desplazamiento;
+        for (uint32_t& id : nodo->resumen) id += desplazamiento;
+        for (auto& par : nodo->children) {
+            desplazarSubarbol(par.second.get(), desplazamiento);
+        }
+    }
+
+    /**
+     * @return true si el nodo quedó sin palabras en todo su subárbol
+     */
+    static bool podarSubarbol(NodoTrieCompacto* nodo, size_t maxDocumentos, string& camino,
+                              vector<string>& podadas, size_t& postings) {
+        if (nodo->postings.size() > maxDocumentos) {
+            podadas.push_back(camino);
+            postings += nodo->postings.size();
+            vector<uint32_t>().swap(nodo->postings);
+            vector<uint16_t>().swap(nodo->frecuencias);
+            vector<uint32_t>().swap(nodo->posiciones);
+            nodo->esFinDePalabra = false;
+        }
+        for (auto it = nodo->children.begin(); it != nodo->children.end();) {
+            camino.push_back(it->first);
+            const bool vacio = podarSubarbol(it->second.get(), maxDocumentos, camino, podadas, postings);
+            camino.pop_back();
+            it = vacio ? nodo->children.erase(it) : next(it);
+        }
+        return nodo->postings.empty() && nodo->children.empty();
+    }
+
+    /**
+     * @return true si el nodo quedó sin palabras en todo su subárbol
+     */
+    template<typename Predicado>
+    static bool eliminarEnSubarbol(NodoTrieCompacto* nodo, Predicado& borrar, size_t& eliminadas) {
+        nodo->tieneResumen = false;
+        vector<uint32_t>().swap(nodo->resumen);
+
+        auto& postings = nodo->postings;
+        auto& frecuencias = nodo->frecuencias;
+        auto& posiciones = nodo->posiciones;
+        size_t conservadas = 0;
+        size_t lectura = 0;
+        size_t escritura = 0;
+        for (size_t k = 0; k < postings.size(); ++k) {
+            const uint16_t frecuencia = frecuencias[k];
+            if (!borrar(postings[k])) {
+                postings[conservadas] = postings[k];
+                frecuencias[conservadas] = frecuencia;
+                copy(posiciones.begin() + lectura, posiciones.begin() + lectura + frecuencia,
+                     posiciones.begin() + escritura);
+                escritura += frecuencia;
+                ++conservadas;
+            }
+            lectura += frecuencia;
+        }
+        eliminadas += postings.size() - conservadas;
+        postings.resize(conservadas);
+        frecuencias.resize(conservadas);
+        posiciones.resize(escritura);
+        if (postings.empty()) nodo->esFinDePalabra = false;
+
+        for (auto it = nodo->children.begin(); it != nodo->children.end();) {
+            const bool vacio = eliminarEnSubarbol(it->second.get(), borrar, eliminadas);
+            it = vacio ? nodo->children.erase(it) : next(it);
+        }
+        return postings.empty() && nodo->children.empty();
+    }
+
+    static void recolectarListas(const NodoTrieCompacto* nodo, vector<ListaPostings>& listas) {
+        if (nodo->tieneResumen) {
+            listas.push_back(RangoIds(nodo->resumen));
+            return;
+        }
+        if (!nodo->postings.empty()) {
+            listas.push_back(RangoIds(nodo->postings));
+        }
+        for (const auto& par : nodo->children) {
+            recolectarListas(par.second.get(), listas);
+        }
+    }
+
+    /**
+     * @brief Calcula la unión del subárbol; retorna false si excede el límite
+     */
+    static bool calcularResumen(NodoTrieCompacto* nodo, size_t limite, vector<uint32_t>& unionSubarbol) {
+        vector<vector<uint32_t>> unionesHijos;
+        bool dentroDelLimite = true;
+
+        for (auto& par : nodo->children) {
+            vector<uint32_t> unionHijo;
+            if (!calcularResumen(par.second.get(), limite, unionHijo)) {
+                dentroDelLimite = false;
+            } else if (dentroDelLimite) {
+                unionesHijos.push_back(move(unionHijo));
+            }
+        }
+        if (!dentroDelLimite) return false;
+
+        vector<ListaPostings> listas;
+        if (!nodo->postings.empty()) listas.push_back(RangoIds(nodo->postings));
+        for (const auto& u : unionesHijos) listas.push_back(RangoIds(u));
+
+        unionSubarbol = OperacionesPostings::fusionar(listas);
+        if (unionSubarbol.size() > limite) return false;
+
+        if (listas.size() > 1) {
+            nodo->resumen = unionSubarbol;
+            nodo->resumen.shrink_to_fit();
+            nodo->tieneResumen = true;
+        }
+        return true;
+    }
+
+    static size_t memoriaSubarbol(const NodoTrieCompacto* nodo) {
+        size_t bytes = (nodo->postings.capacity() + nodo->posiciones.capacity() + nodo->resumen.capacity()) * sizeof(uint32_t) +
+                       nodo->frecuencias.capacity() * sizeof(uint16_t);
+        for (const auto& par : nodo->children) {
+            bytes += memoriaSubarbol(par.second.get());
+        }
+        return bytes;
+    }
+};
+
+/**
+ * @brief Película tal como se lee del CSV
+ *
+ * Los campos son vistas sobre el archivo mapeado o la arena del lector y solo
+ * viven durante la carga: después se copian a las columnas de CatalogoPeliculas.
+ */
+struct RegistroPelicula {
+    string_view titulo;
+    string_view sinopsis;
+    string_view split;
+    string_view fuente_sinopsis;
+    uint32_t primerTag = 0;     // Offset de sus tags en RegistrosCSV::tags
+    uint32_t cantidadTags = 0;
+};
+
+/**
+ * @brief Registros leídos de un rango del CSV, con los tags de todos en un solo arreglo
+ */
+struct RegistrosCSV {
+    vector<RegistroPelicula> peliculas;
+    vector<string_view> tags;
+
+    Vista<string_view> tagsDe(const RegistroPelicula& registro) const {
+        return Vista<string_view>(tags.data() + registro.primerTag, registro.cantidadTags);
+    }
+};
+
+using IdTag = uint32_t;
+
+/**
+ * @brief Una película del catálogo, como vistas sobre sus columnas
+ *
+ * Las filas del catálogo no se modifican después de agregarse: las puntuaciones
+ * de cada consulta viven en ResultadoBusqueda, no en la película. Es válida
+ * mientras viva el almacenamiento del CatalogoPeliculas que la devolvió (que
+ * comparten todas sus versiones); los nombres de los tags se obtienen con
+ * CatalogoPeliculas::nombreTag.
+ */
+struct Pelicula {
+    string_view titulo;
+    string_view sinopsis;
+    Vista<IdTag> tags;
+    string_view split;
+    string_view fuente_sinopsis;
+};
+
+/**
+ * @brief Catálogo columnar: cada campo de texto es una columna de cadenas contiguas
+ *
+ * La cadena i de una columna ocupa texto[inicio[i], inicio[i + 1]), así que cada
+ * campo de una película cuesta un offset de 4 bytes en lugar de una asignación
+ * propia, y recorrer un campo lee memoria contigua. Los tags se internan: cada
+ * nombre se guarda una vez en un diccionario ordenado (su posición es el IdTag) y
+ * las películas guardan solo IDs. Como TrieCongelado, los arreglos son vistas
+ * sobre vectores propios o sobre la imagen mapeada del índice.
+ *
+ * Las películas y los tags agregados después (agregar) van a un anexo de
+ * bloques que no se mueven, compartido por todas las versiones del catálogo:
+ * copiar un catálogo es O(1) y cada copia ve solo las filas que existían
+ * cuando se hizo, así que un lector puede seguir usando la suya mientras el
+ * escritor agrega a la última.
+ */
+class CatalogoPeliculas {
+private:
+    struct Columna {
+        Vista<char> texto;
+        Vista<uint32_t> inicio; // Offset de cada cadena (+1 centinela)
+
+        string_view operator[](size_t i) const {
+            return string_view(texto.data() + inicio[i], inicio[i + 1] - inicio[i]);
+        }
+
+        size_t size() const {
+            return inicio.empty() ? 0 : inicio.size() - 1;
+        }
+    };
+
+    struct ColumnaPropia {
+        vector<char> texto;
+        vector<uint32_t> inicio{0};
+
+        void agregar(string_view cadena) {
+            if (texto.size() + cadena.size() > numeric_limits<uint32_t>::max()) {
+                throw runtime_error("Columna de texto del catálogo mayor a 4 GB");
+            }
+            texto.insert(texto.end(), cadena.begin(), cadena.end());
+            inicio.push_back(static_cast<uint32_t>(texto.size()));
+        }
+
+        Columna vista() const {
+            return {Vista<char>(texto), Vista<uint32_t>(inicio)};
+        }
+    };
+
+    struct Arreglos {
+        ColumnaPropia titulos, sinopsis, splits, fuentes, nombresTags;
+        vector<uint32_t> inicioTags{0};
+        vector<IdTag> tags;
+    };
+
+    struct FilaAnexa {
+        string titulo, sinopsis, split, fuente;
+        vector<IdTag> tags;
+    };
+
+    struct Anexo {
+        BloquesEstables<FilaAnexa> filas;      // Película size() de la base + i
+        BloquesEstables<string> nombresTags;  // Tag cantidadTags() de la base + i
+    };
+
+    shared_ptr<const Arreglos> propios; // Nulo si las vistas apuntan a una imagen mapeada
+    Columna titulos, sinopsis, splits, fuentes;
+    Columna nombresTags;         // Ordenados: el IdTag de un nombre es su posición
+    Vista<uint32_t> inicioTags;  // Tags de la película i: tags[inicioTags[i], inicioTags[i + 1])
+    Vista<IdTag> tags;
+
+    // Filas y tags del anexo que ve esta versión
+    shared_ptr<Anexo> anexo;
+    uint32_t filasAnexas = 0;
+    uint32_t tagsAnexos = 0;
+    shared_ptr<const vector<IdTag>> tagsAnexosOrdenados; // Por nombre, para buscarTag
+
+public:
+    CatalogoPeliculas() = default;
+
+    /**
+     * @brief Copia los registros de las partes, en orden, a columnas contiguas
+     *
+     * Complejidad: O(T + e log e) donde T = bytes de texto y e = tags distintos
+     */
+    static CatalogoPeliculas construir(const vector<const RegistrosCSV*>& partes) {
+        auto arreglos = make_shared<Arreglos>();
+
+        size_t total = 0;
+        size_t totalTags = 0;
+        unordered_map<string_view, IdTag> diccionario;
+        for (const auto* parte : partes) {
+            total += parte->peliculas.size();
+            totalTags += parte->tags.size();
+            for (string_view tag : parte->tags) {
+                diccionario.try_emplace(tag, 0);
+            }
+        }
+        vector<string_view> nombres;
+        nombres.reserve(diccionario.size());
+        for (const auto& par : diccionario) {
+            nombres.push_back(par.first);
+        }
+        sort(nombres.begin(), nombres.end());
+        for (size_t i = 0; i < nombres.size(); ++i) {
+            diccionario[nombres[i]] = static_cast<IdTag>(i);
+            arreglos->nombresTags.agregar(nombres[i]);
+        }
+
+        for (ColumnaPropia* columna : {&arreglos->titulos, &arreglos->sinopsis, &arreglos->splits, &arreglos->fuentes}) {
+            columna->inicio.reserve(total + 1);
+        }
+        arreglos->inicioTags.reserve(total + 1);
+        arreglos->tags.reserve(totalTags);
+        for (const auto* parte : partes) {
+            for (const auto& registro : parte->peliculas) {
+                arreglos->titulos.agregar(registro.titulo);
+                arreglos->sinopsis.agregar(registro.sinopsis);
+                arreglos->splits.agregar(registro.split);
+                arreglos->fuentes.agregar(registro.fuente_sinopsis);
+                for (string_view tag : parte->tagsDe(registro)) {
+                    arreglos->tags.push_back(diccionario[tag]);
+                }
+                arreglos->inicioTags.push_back(static_cast<uint32_t>(arreglos->tags.size()));
+            }
+        }
+
+        CatalogoPeliculas catalogo;
+        catalogo.titulos = arreglos->titulos.vista();
+        catalogo.sinopsis = arreglos->sinopsis.vista();
+        catalogo.splits = arreglos->splits.vista();
+        catalogo.fuentes = arreglos->fuentes.vista();
+        catalogo.nombresTags = arreglos->nombresTags.vista();
+        catalogo.inicioTags = Vista<uint32_t>(arreglos->inicioTags);
+        catalogo.tags = Vista<IdTag>(arreglos->tags);
+        catalogo.propios = move(arreglos);
+        return catalogo;
+    }
+
+    /**
+     * @brief Agrega una película al final y devuelve su ID; los tags nuevos se internan en el anexo
+     *
+     * Solo debe llamarse sobre la última versión del catálogo: las copias
+     * anteriores comparten el anexo y no ven lo agregado.
+     *
+     * @param nombresTags Tags ya normalizados
+     * Complejidad: O(texto + t × log e) donde t = tags de la película y e = tags distintos
+     */
+    uint32_t agregar(string_view titulo, string_view sinopsis, const vector<string>& nombresTags,
+                     string_view split, string_view fuente) {
+        if (size() >= numeric_limits<uint32_t>::max()) {
+            throw runtime_error("Catálogo lleno");
+        }
+        if (!anexo) {
+            anexo = make_shared<Anexo>();
+        }
+        FilaAnexa fila{string(titulo), string(sinopsis), string(split), string(fuente), {}};
+        for (const auto& nombre : nombresTags) {
+            IdTag tag;
+            if (!buscarTag(nombre, tag)) {
+                tag = static_cast<IdTag>(this->nombresTags.size() + anexo->nombresTags.agregar(nombre));
+                ++tagsAnexos;
+                auto ordenados = make_shared<vector<IdTag>>();
+                if (tagsAnexosOrdenados) *ordenados = *tagsAnexosOrdenados;
+                ordenados->insert(upper_bound(ordenados->begin(), ordenados->end(), tag, [this](IdTag a, IdTag b) {
+                    return nombreTag(a) < nombreTag(b);
+                }), tag);
+                tagsAnexosOrdenados = move(ordenados);
+            }
+            fila.tags.push_back(tag);
+        }
+        anexo->filas.agregar(move(fila));
+        ++filasAnexas;
+        return static_cast<uint32_t>(size() - 1);
+    }
+
+    /**
+     * @brief Escribe las columnas de la base; el anexo no se guarda (la imagen corresponde al CSV)
+     */
+    void escribir(EscritorImagen& escritor) const {
+        for (const Columna* columna : {&titulos, &sinopsis, &splits, &fuentes, &nombresTags}) {
+            escritor.escribir(columna->texto);
+            escritor.escribir(columna->inicio);
+        }
+        escritor.escribir(inicioTags);
+        escritor.escribir(tags);
+    }
+
+    static CatalogoPeliculas leer(LectorImagen& lector) {
+        CatalogoPeliculas catalogo;
+        for (Columna* columna : {&catalogo.titulos, &catalogo.sinopsis, &catalogo.splits, &catalogo.fuentes,
+                                 &catalogo.nombresTags}) {
+            columna->texto = lector.leer<char>();
+            columna->inicio = lector.leer<uint32_t>();
+            if (columna->inicio.empty() || columna->inicio.back() != columna->texto.size()) {
+                throw runtime_error("columna del catálogo incoherente");
+            }
+        }
+        catalogo.inicioTags = lector.leer<uint32_t>();
+        catalogo.tags = lector.leer<IdTag>();
+
+        const size_t n = catalogo.size();
+        const bool coherente = catalogo.sinopsis.size() == n && catalogo.splits.size() == n &&
+                               catalogo.fuentes.size() == n && catalogo.inicioTags.size() == n + 1 &&
+                               catalogo.inicioTags.back() == catalogo.tags.size();
+        if (!coherente) {
+            throw runtime_error("catálogo incoherente");
+        }
+        return catalogo;
+    }
+
+    size_t size() const {
+        return titulos.size() + filasAnexas;
+    }
+
+    Pelicula obtener(uint32_t id) const {
+        if (id < titulos.size()) {
+            return {titulos[id], sinopsis[id], tagsDe(id), splits[id], fuentes[id]};
+        }
+        const FilaAnexa& fila = filaAnexa(id);
+        return {fila.titulo, fila.sinopsis, tagsDe(id), fila.split, fila.fuente};
+    }
+
+    string_view titulo(uint32_t id) const {
+        return id < titulos.size() ? titulos[id] : string_view(filaAnexa(id).titulo);
+    }
+
+    size_t longitudSinopsis(uint32_t id) const {
+        return id < titulos.size() ? sinopsis.inicio[id + 1] - sinopsis.inicio[id] : filaAnexa(id).sinopsis.size();
+    }
+
+    Vista<IdTag> tagsDe(uint32_t id) const {
+        if (id >= titulos.size()) {
+            return Vista<IdTag>(filaAnexa(id).tags);
+        }
+        return Vista<IdTag>(tags.data() + inicioTags[id], inicioTags[id + 1] - inicioTags[id]);
+    }
+
+    size_t cantidadTags() const {
+        return nombresTags.size() + tagsAnexos;
+    }
+
+    string_view nombreTag(IdTag tag) const {
+        return tag < nombresTags.size() ? nombresTags[tag] : string_view(anexo->nombresTags[tag - nombresTags.size()]);
+    }
+
+    /**
+     * @brief Busca el ID de un tag ya normalizado; false si ninguna película lo tiene
+     */
+    bool buscarTag(string_view nombre, IdTag& tag) const {
+        size_t bajo = 0;
+        size_t alto = nombresTags.size();
+        while (bajo < alto) {
+            const size_t medio = (bajo + alto) / 2;
+            if (nombresTags[medio] < nombre) {
+                bajo = medio + 1;
+            } else {
+                alto = medio;
+            }
+        }
+        if (bajo < nombresTags.size() && nombresTags[bajo] == nombre) {
+            tag = static_cast<IdTag>(bajo);
+            return true;
+        }
+        if (tagsAnexos == 0) return false;
+        auto it = lower_bound(tagsAnexosOrdenados->begin(), tagsAnexosOrdenados->end(), nombre,
+                              [this](IdTag a, string_view b) { return nombreTag(a) < b; });
+        if (it == tagsAnexosOrdenados->end() || nombreTag(*it) != nombre) return false;
+        tag = *it;
+        return true;
+    }
+
+    size_t memoria() const {
+        size_t bytes = (inicioTags.size() + tags.size()) * sizeof(uint32_t);
+        for (const Columna* columna : {&titulos, &sinopsis, &splits, &fuentes, &nombresTags}) {
+            bytes += columna->texto.size() + columna->inicio.size() * sizeof(uint32_t);
+        }
+        for (uint32_t i = 0; i < filasAnexas; ++i) {
+            const FilaAnexa& fila = anexo->filas[i];
+            bytes += sizeof(FilaAnexa) + fila.titulo.size() + fila.sinopsis.size() + fila.split.size() +
+                     fila.fuente.size() + fila.tags.size() * sizeof(IdTag);
+        }
+        for (uint32_t i = 0; i < tagsAnexos; ++i) {
+            bytes += anexo->nombresTags[i].size();
+        }
+        return bytes;
+    }
+
+private:
+    const FilaAnexa& filaAnexa(uint32_t id) const {
+        return anexo->filas[id - titulos.size()];
+    }
+};
+
+/**
+ * @brief Clase genérica para índices de búsqueda
+ *
+ * Cada clave guarda una lista de valores (por ejemplo, IDs de película por IdTag).
+ */
+template<typename T, typename KeyType = string>
+class IndiceGenerico {
+private:
+    unordered_map<KeyType, vector<T>> indice;
+    mutable mutex indice_mutex;
+
+public:
+    void vaciar() {
+        lock_guard<mutex> lock(indice_mutex);
+        indice.clear();
+    }
+
+    /**
+     * @brief Agrega al final de cada clave los elementos de otro índice, que queda vacío
+     */
+    void fusionar(IndiceGenerico& otro) {
+        if (this == &otro) return;
+        scoped_lock lock(indice_mutex, otro.indice_mutex);
+        if (indice.empty()) {
+            indice.swap(otro.indice);
+            return;
+        }
+        for (auto& par : otro.indice) {
+            auto& destino = indice[par.first];
+            if (destino.empty()) {
+                destino.swap(par.second);
+            } else {
+                destino.insert(destino.end(), par.second.begin(), par.second.end());
+            }
+        }
+        otro.indice.clear();
+    }
+
+    void agregar(const KeyType& clave, const T& elemento) {
+        lock_guard<mutex> lock(indice_mutex);
+        indice[clave].push_back(elemento);
+    }
+
+    /**
+     * @brief Quita los elementos para los que eliminar(elemento) es true; las claves vacías se borran
+     */
+    template<typename Predicado>
+    void eliminarSi(Predicado&& eliminar) {
+        lock_guard<mutex> lock(indice_mutex);
+        for (auto it = indice.begin(); it != indice.end();) {
+            auto& lista = it->second;
+            lista.erase(remove_if(lista.begin(), lista.end(), eliminar), lista.end());
+            it = lista.empty() ? indice.erase(it) : next(it);
+        }
+    }
+
+    vector<T> buscar(const KeyType& clave) const {
+        lock_guard<mutex> lock(indice_mutex);
+        auto it = indice.find(clave);
+        return (it != indice.end()) ? it->second : vector<T>{};
+    }
+
+    vector<KeyType> obtenerClaves() const {
+        lock_guard<mutex> lock(indice_mutex);
+        vector<KeyType> claves;
+        for (const auto& par : indice) {
+            claves.push_back(par.first);
+        }
+        return claves;
+    }
+};
+
+/**
+ * @brief Índice de tags de solo lectura: un BitmapIds por IdTag
+ *
+ * Los contenedores de todos los tags van uno tras otro y los de cada tag se
+ * ubican por IdTag en O(1). Como TrieCongelado, los arreglos son vistas sobre
+ * vectores propios o sobre la imagen mapeada del índice.
+ */
+class IndiceTagsCongelado {
+private:
+    struct Arreglos {
+        vector<uint32_t> inicioContenedores; // Offset de los contenedores de cada tag (+1 centinela)
+        BitmapIds bitmaps;                   // Contenedores de todos los tags concatenados
+    };
+
+    shared_ptr<const Arreglos> propios;
+    Vista<uint32_t> inicioContenedores;
+    Vista<ContenedorBitmap> contenedores;
+    Vista<uint16_t> valores;
+    Vista<uint64_t> palabras;
+
+public:
+    IndiceTagsCongelado() = default;
+
+    static IndiceTagsCongelado construir(const IndiceGenerico<uint32_t, IdTag>& indice, size_t cantidadTags) {
+        auto arreglos = make_shared<Arreglos>();
+        BitmapIds& todos = arreglos->bitmaps;
+        arreglos->inicioContenedores.reserve(cantidadTags + 1);
+        arreglos->inicioContenedores.push_back(0);
+        for (size_t tag = 0; tag < cantidadTags; ++tag) {
+            vector<uint32_t> lista = indice.buscar(static_cast<IdTag>(tag));
+            sort(lista.begin(), lista.end());
+            const BitmapIds bitmap = BitmapIds::desdeIds(RangoIds(lista));
+
+            for (ContenedorBitmap contenedor : bitmap.contenedores) {
+                contenedor.inicio += static_cast<uint32_t>(contenedor.denso ? todos.palabras.size()
+                                                                            : todos.valores.size());
+                todos.contenedores.push_back(contenedor);
+            }
+            todos.valores.insert(todos.valores.end(), bitmap.valores.begin(), bitmap.valores.end());
+            todos.palabras.insert(todos.palabras.end(), bitmap.palabras.begin(), bitmap.palabras.end());
+            arreglos->inicioContenedores.push_back(static_cast<uint32_t>(todos.contenedores.size()));
+        }
+
+        IndiceTagsCongelado congelado;
+        congelado.inicioContenedores = Vista<uint32_t>(arreglos->inicioContenedores);
+        congelado.contenedores = Vista<ContenedorBitmap>(todos.contenedores);
+        congelado.valores = Vista<uint16_t>(todos.valores);
+        congelado.palabras = Vista<uint64_t>(todos.palabras);
+        congelado.propios = move(arreglos);
+        return congelado;
+    }
+
+    void escribir(EscritorImagen& escritor) const {
+        escritor.escribir(inicioContenedores);
+        escritor.escribir(contenedores);
+        escritor.escribir(valores);
+        escritor.escribir(palabras);
+    }
+
+    /**
+     * @brief Además de los tamaños, comprueba que cada contenedor cae dentro de sus
+     *        arreglos: una lectura fuera de rango no la detectaría la suma de verificación
+     */
+    static IndiceTagsCongelado leer(LectorImagen& lector) {
+        IndiceTagsCongelado congelado;
+        congelado.inicioContenedores = lector.leer<uint32_t>();
+        congelado.contenedores = lector.leer<ContenedorBitmap>();
+        congelado.valores = lector.leer<uint16_t>();
+        congelado.palabras = lector.leer<uint64_t>();
+        bool coherente = !congelado.inicioContenedores.empty() &&
+                         congelado.inicioContenedores.back() == congelado.contenedores.size();
+        for (size_t i = 0; coherente && i < congelado.contenedores.size(); ++i) {
+            const ContenedorBitmap& c = congelado.contenedores[i];
+            coherente = c.denso ? uint64_t(c.inicio) + BitmapIds::PALABRAS_DENSO <= congelado.palabras.size()
+                                : uint64_t(c.inicio) + c.cardinalidad <= congelado.valores.size();
+        }
+        if (!coherente) {
+            throw runtime_error("índice de tags con arreglos incoherentes");
+        }
+        return congelado;
+    }
+
+    /**
+     * @brief Conjunto de películas con el tag
+     */
+    VistaBitmap buscar(IdTag tag) const {
+        VistaBitmap bitmap;
+        if (tag + 1 >= inicioContenedores.size()) return bitmap;
+        bitmap.contenedores = Vista<ContenedorBitmap>(contenedores.data() + inicioContenedores[tag],
+                                                      inicioContenedores[tag + 1] - inicioContenedores[tag]);
+        bitmap.valores = valores.data();
+        bitmap.palabras = palabras.data();
+        return bitmap;
+    }
+
+    size_t cantidadTags() const {
+        return inicioContenedores.empty() ? 0 : inicioContenedores.size() - 1;
+    }
+
+    size_t memoria() const {
+        return inicioContenedores.size() * sizeof(uint32_t) + contenedores.size() * sizeof(ContenedorBitmap) +
+               valores.size() * sizeof(uint16_t) + palabras.size() * sizeof(uint64_t);
+    }
+};
+
+/**
+ * @brief Qué palabras de las sinopsis no se indexan
+ *
+ * Las palabras vacías se descartan al tokenizar (conservando las posiciones de
+ * las demás) y, una vez fusionados los fragmentos, se podan las palabras que
+ * aparecen en más de fraccionMaximaDocumentos de las películas. Los títulos se
+ * indexan completos: son cortos y "The Thing" debe seguir encontrándose.
+ */
+struct VocabularioSinopsis {
+    vector<string> palabrasVacias = palabrasVaciasIngles();
+    double fraccionMaximaDocumentos = 1.0; // 1.0 = sin poda por frecuencia
+
+    static vector<string> palabrasVaciasIngles() {
+        return {"a", "about", "after", "all", "also", "an", "and", "any", "are", "as", "at", "be", "been",
+                "before", "but", "by", "can", "could", "did", "do", "does", "for", "from", "had", "has", "have",
+                "he", "her", "hers", "herself", "him", "himself", "his", "how", "i", "if", "in", "into", "is",
+                "it", "its", "itself", "me", "my", "no", "not", "of", "on", "or", "our", "out", "over", "she",
+                "so", "some", "than", "that", "the", "their", "them", "themselves", "then", "there", "these",
+                "they", "this", "those", "to", "too", "up", "us", "was", "we", "were", "what", "when", "where",
+                "which", "while", "who", "whom", "why", "will", "with", "would", "you", "your"};
+    }
+
+    /**
+     * @brief Cambia si cambia la configuración: una imagen con otra huella se reconstruye
+     */
+    uint64_t huella() const {
+        vector<string> ordenadas(palabrasVacias);
+        sort(ordenadas.begin(), ordenadas.end());
+        string texto = to_string(fraccionMaximaDocumentos);
+        for (const auto& palabra : ordenadas) {
+            texto += ' ';
+            texto += palabra;
+        }
+        return hash<string>{}(texto);
+    }
+};
+
+/**
+ * @brief Palabras que no están en el índice de sinopsis (vacías y podadas), ordenadas
+ *
+ * Las consultas las necesitan para no exigir en las sinopsis una palabra que
+ * nunca se indexó: en una frase se saltan conservando su posición y en una
+ * consulta de varias palabras no restringen el resultado.
+ */
+class PalabrasIgnoradas {
+private:
+    struct Arreglos {
+        vector<char> texto;
+        vector<uint32_t> inicios{0}; // Offset de cada palabra en texto (+1 centinela)
+    };
+
+    shared_ptr<const Arreglos> propios;
+    Vista<char> texto;
+    Vista<uint32_t> inicios;
+
+public:
+    PalabrasIgnoradas() = default;
+
+    static PalabrasIgnoradas construir(vector<string> palabras) {
+        sort(palabras.begin(), palabras.end());
+        palabras.erase(unique(palabras.begin(), palabras.end()), palabras.end());
+        auto arreglos = make_shared<Arreglos>();
+        for (const auto& palabra : palabras) {
+            arreglos->texto.insert(arreglos->texto.end(), palabra.begin(), palabra.end());
+            arreglos->inicios.push_back(static_cast<uint32_t>(arreglos->texto.size()));
+        }
+
+        PalabrasIgnoradas ignoradas;
+        ignoradas.texto = Vista<char>(arreglos->texto);
+        ignoradas.inicios = Vista<uint32_t>(arreglos->inicios);
+        ignoradas.propios = move(arreglos);
+        return ignoradas;
+    }
+
+    void escribir(EscritorImagen& escritor) const {
+        escritor.escribir(texto);
+        escritor.escribir(inicios);
+    }
+
+    static PalabrasIgnoradas leer(LectorImagen& lector) {
+        PalabrasIgnoradas ignoradas;
+        ignoradas.texto = lector.leer<char>();
+        ignoradas.inicios = lector.leer<uint32_t>();
+        if (ignoradas.inicios.empty() || ignoradas.inicios.back() != ignoradas.texto.size()) {
+            throw runtime_error("palabras ignoradas incoherentes");
+        }
+        return ignoradas;
+    }
+
+    size_t size() const {
+        return inicios.empty() ? 0 : inicios.size() - 1;
+    }
+
+    string_view palabra(size_t i) const {
+        return string_view(texto.data() + inicios[i], inicios[i + 1] - inicios[i]);
+    }
+
+    /**
+     * @param palabra Palabra normalizada
+     */
+    bool contiene(string_view palabra) const {
+        size_t inicio = 0;
+        size_t fin = size();
+        while (inicio < fin) {
+            const size_t medio = inicio + (fin - inicio) / 2;
+            if (this->palabra(medio) < palabra) {
+                inicio = medio + 1;
+            } else {
+                fin = medio;
+            }
+        }
+        return inicio < size() && this->palabra(inicio) == palabra;
+    }
+};
+
+/**
+ * @brief Índices privados de un hilo durante la indexación paralela
+ */
+struct FragmentoIndice {
+    TrieCompacto titulos;
+    TrieCompacto sinopsis;
+    IndiceGenerico<uint32_t, IdTag> tags;
+};
+
+/**
+ * @brief Tiempos de arranque medidos por GestorPeliculas
+ */
+struct MetricasArranque {
+    long long cargaMs = 0;
+    long long indexacionMs = 0;
+    long long congelacionMs = 0;
+    size_t hilos = 0;
+    bool desdeImagen = false;      // Arranque desde la imagen binaria, sin leer el CSV
+    size_t aparicionesOmitidas = 0; // Palabras vacías de las sinopsis que no se indexaron
+    size_t terminosPodados = 0;     // Palabras de las sinopsis eliminadas por frecuencia documental
+    size_t postingsPodados = 0;
+};
+
+/**
+ * @brief Sistema de puntuación BM25 por campos para ranking de películas
+ *
+ * puntuación(d) = Σ_campos peso_c × Σ_términos idf(t) × tf·(k1+1) / (tf + k1·(1 − b + b·|d|_c / avg_c))
+ * más un bonus si el título completo coincide con la búsqueda.
+ */
+class SistemaPuntuacion {
+public:
+    static constexpr double K1 = 1.2;
+    static constexpr double B = 0.75;
+    static constexpr double PESO_TITULO = 3.0;
+    static constexpr double PESO_SINOPSIS = 1.0;
+    static constexpr double PESO_TAG = 5.0;
+    static constexpr double BONUS_TITULO_EXACTO = 10.0;
+
+    /**
+     * @brief IDF de BM25 (variante siempre positiva)
+     */
+    static double idf(size_t frecuenciaDocumental, size_t totalDocumentos) {
+        const double df = static_cast<double>(frecuenciaDocumental);
+        return log(1.0 + (static_cast<double>(totalDocumentos) - df + 0.5) / (df + 0.5));
+    }
+
+    /**
+     * @brief Componente de frecuencia saturada y normalizada por longitud
+     */
+    static double saturacion(uint32_t tf, uint32_t longitud, double longitudPromedio) {
+        return saturacion(tf, normalizacionLongitud(longitud, longitudPromedio));
+    }
+
+    /**
+     * @brief Igual que la anterior, con k1·(1 − b + b·|d| / avg) ya calculado
+     */
+    static double saturacion(uint32_t tf, double normalizacion) {
+        return tf * (K1 + 1.0) / (tf + normalizacion);
+    }
+
+    static double normalizacionLongitud(uint32_t longitud, double longitudPromedio) {
+        return K1 * (1.0 - B + B * longitud / longitudPromedio);
+    }
+
+    static uint64_t hashTexto(const string& textoNormalizado) {
+        return hash<string>{}(textoNormalizado);
+    }
+
+    /**
+     * @brief Puntuación estática de una película, independiente de la consulta (orden del autocompletado)
+     *
+     * El CSV no trae votos ni popularidad: se usa qué tan completa está la ficha,
+     * un punto por tag más el logaritmo del largo de la sinopsis.
+     */
+    static float calidadEstatica(size_t cantidadTags, size_t longitudSinopsis) {
+        return static_cast<float>(cantidadTags + log1p(static_cast<double>(longitudSinopsis)));
+    }
+};
+
+/**
+ * @brief Longitudes de un campo (en palabras) de cada documento
+ */
+struct EstadisticasCampo {
+    vector<uint32_t> longitudes;   // Indexado por ID de película
+    vector<float> normalizacion;   // k1·(1 − b + b·|d| / avg) precalculado por documento
+    double longitudPromedio = 1.0;
+    uint32_t longitudMinima = 1;   // Menor longitud no nula (para cotas superiores)
+
+    /**
+     * @param vigentes Bitmap de los documentos que cuentan para el promedio (nullptr = todos)
+     */
+    void calcularPromedio(const vector<uint64_t>* vigentes = nullptr) {
+        double total = 0.0;
+        size_t documentos = 0;
+        uint32_t minima = numeric_limits<uint32_t>::max();
+        for (size_t id = 0; id < longitudes.size(); ++id) {
+            if (vigentes && !(((*vigentes)[id >> 6] >> (id & 63)) & 1)) continue;
+            const uint32_t longitud = longitudes[id];
+            total += longitud;
+            ++documentos;
+            if (longitud > 0) minima = min(minima, longitud);
+        }
+        longitudPromedio = documentos == 0 ? 1.0 : max(1.0, total / documentos);
+        longitudMinima = (minima == numeric_limits<uint32_t>::max()) ? 1 : minima;
+
+        normalizacion.resize(longitudes.size());
+        for (size_t id = 0; id < longitudes.size(); ++id) {
+            normalizacion[id] = static_cast<float>(
+                SistemaPuntuacion::normalizacionLongitud(longitudes[id], longitudPromedio));
+        }
+    }
+
+    /**
+     * @brief Longitud de un documento nuevo; el promedio no cambia hasta el próximo calcularPromedio
+     */
+    void agregar(uint32_t longitud) {
+        longitudes.push_back(longitud);
+        normalizacion.push_back(static_cast<float>(SistemaPuntuacion::normalizacionLongitud(longitud, longitudPromedio)));
+        // Las cotas superiores de EvaluadorTopK suponen que ningún documento es más corto
+        if (longitud > 0) longitudMinima = min(longitudMinima, longitud);
+    }
+};
+
+/**
+ * @brief Estadísticas por documento calculadas durante la indexación
+ *
+ * Junto con la frecuencia documental (tamaño de cada posting list) es todo lo que
+ * BM25 necesita: al consultar no se vuelve a leer el texto de las películas.
+ */
+struct EstadisticasDocumentos {
+    EstadisticasCampo titulo;
+    EstadisticasCampo sinopsis;
+    EstadisticasCampo tags;
+    vector<uint64_t> hashTitulo;   // Hash del título normalizado, para el bonus de coincidencia exacta
+    size_t totalDocumentos = 0;
+
+    void preparar(size_t n) {
+        totalDocumentos = n;
+        titulo.longitudes.assign(n, 0);
+        sinopsis.longitudes.assign(n, 0);
+        tags.longitudes.assign(n, 0);
+        hashTitulo.assign(n, 0);
+    }
+
+    /**
+     * @brief Estadísticas de una película agregada al final del catálogo (ver EstadisticasCampo::agregar)
+     */
+    void agregar(uint32_t palabrasTitulo, uint32_t palabrasSinopsis, uint32_t cantidadTags, uint64_t hash) {
+        titulo.agregar(palabrasTitulo);
+        sinopsis.agregar(palabrasSinopsis);
+        tags.agregar(cantidadTags);
+        hashTitulo.push_back(hash);
+        ++totalDocumentos;
+    }
+
+    /**
+     * @brief Copia las estadísticas de un fragmento cuyos IDs locales empiezan en 'primerId'
+     */
+    void copiarFragmento(const EstadisticasDocumentos& fragmento, size_t primerId) {
+        copy(fragmento.titulo.longitudes.begin(), fragmento.titulo.longitudes.end(),
+             titulo.longitudes.begin() + primerId);
+        copy(fragmento.sinopsis.longitudes.begin(), fragmento.sinopsis.longitudes.end(),
+             sinopsis.longitudes.begin() + primerId);
+        copy(fragmento.tags.longitudes.begin(), fragmento.tags.longitudes.end(),
+             tags.longitudes.begin() + primerId);
+        copy(fragmento.hashTitulo.begin(), fragmento.hashTitulo.end(), hashTitulo.begin() + primerId);
+    }
+
+    /**
+     * @brief Guarda lo que no se puede derivar; promedios y normalizaciones se recalculan al leer
+     */
+    void escribir(EscritorImagen& escritor) const {
+        escritor.escribir(titulo.longitudes);
+        escritor.escribir(sinopsis.longitudes);
+        escritor.escribir(tags.longitudes);
+        escritor.escribir(hashTitulo);
+    }
+
+    static EstadisticasDocumentos leer(LectorImagen& lector, size_t n) {
+        EstadisticasDocumentos leidas;
+        leidas.totalDocumentos = n;
+        auto copiar = [&lector, n](auto& destino) {
+            using Elemento = typename decay_t<decltype(destino)>::value_type;
+            const Vista<Elemento> leido = lector.template leer<Elemento>();
+            if (leido.size() != n) {
+                throw runtime_error("estadísticas de tamaño incorrecto");
+            }
+            destino.assign(leido.begin(), leido.end());
+        };
+        copiar(leidas.titulo.longitudes);
+        copiar(leidas.sinopsis.longitudes);
+        copiar(leidas.tags.longitudes);
+        copiar(leidas.hashTitulo);
+        leidas.titulo.calcularPromedio();
+        leidas.sinopsis.calcularPromedio();
+        leidas.tags.calcularPromedio();
+        return leidas;
+    }
+};
+
+/**
+ * @brief Acumulador denso de puntuaciones por ID, reutilizable entre consultas
+ *
+ * Solo se limpian las posiciones tocadas, por lo que el costo de una consulta es
+ * proporcional a las postings recorridas y no al tamaño del catálogo.
+ */
+class AcumuladorPuntuaciones {
+private:
+    vector<double> puntuaciones;
+    vector<uint32_t> tocados;
+
+public:
+    void preparar(size_t totalDocumentos) {
+        if (puntuaciones.size() < totalDocumentos) {
+            puntuaciones.resize(totalDocumentos, 0.0);
+        }
+    }
+
+    void sumar(uint32_t id, double valor) {
+        if (puntuaciones[id] == 0.0) {
+            tocados.push_back(id);
+        }
+        puntuaciones[id] += valor;
+    }
+
+    bool contiene(uint32_t id) const {
+        return puntuaciones[id] != 0.0;
+    }
+
+    double puntuacion(uint32_t id) const {
+        return puntuaciones[id];
+    }
+
+    const vector<uint32_t>& idsTocados() const {
+        return tocados;
+    }
+
+    /**
+     * @brief Deja el acumulador limpio sin copiar las puntuaciones
+     */
+    void descartar() {
+        for (uint32_t id : tocados) {
+            puntuaciones[id] = 0.0;
+        }
+        tocados.clear();
+    }
+
+    /**
+     * @brief Devuelve los pares (ID, puntuación) acumulados y deja el acumulador limpio
+     */
+    ResultadosBusqueda extraer() {
+        ResultadosBusqueda resultados;
+        resultados.reserve(tocados.size());
+        for (uint32_t id : tocados) {
+            resultados.push_back({id, puntuaciones[id]});
+            puntuaciones[id] = 0.0;
+        }
+        tocados.clear();
+        return resultados;
+    }
+};
+
+/**
+ * @brief Término expandido de una consulta con su cota superior de puntuación
+ */
+struct TerminoConsulta {
+    ListaPostings lista;
+    const EstadisticasCampo* campo;
+    double pesoIdf;                  // peso del campo × idf del término
+    double cota;                     // Máxima contribución posible a un documento
+
+    double contribucion(uint32_t id, uint32_t tf) const {
+        return pesoIdf * SistemaPuntuacion::saturacion(tf, campo->normalizacion[id]);
+    }
+};
+
+/**
+ * @brief Selección top-K con poda por cotas superiores (estilo MaxScore)
+ *
+ * Los términos se procesan de mayor a menor cota (primero los raros, con listas
+ * cortas). Cuando la suma de las cotas de los términos restantes ya no alcanza al
+ * K-ésimo mejor puntaje parcial, ningún documento nuevo puede entrar al top-K:
+ * desde ahí los términos restantes (los frecuentes, con listas largas) solo se
+ * sondean con búsqueda galopante para los candidatos vivos, y se descartan los
+ * candidatos que ya no pueden alcanzar el umbral.
+ */
+class EvaluadorTopK {
+public:
+    /**
+     * @param terminos Términos que generan candidatos
+     * @param refuerzos Términos que solo suman a candidatos existentes (p. ej. tags)
+     * @param hashTitulo Hashes de títulos para el bonus de coincidencia exacta (o nullptr)
+     * @param k Número de resultados a conservar
+     * @param filtro Bitmap plano de los IDs admitidos (o nullptr para admitir todos)
+     * @return Los k mejores (ID, puntuación) ordenados de mayor a menor
+     */
+    static ResultadosBusqueda evaluar(vector<TerminoConsulta> terminos, const vector<TerminoConsulta>& refuerzos,
+                                      const vector<uint64_t>* hashTitulo, uint64_t hashTermino,
+                                      size_t k, size_t totalDocumentos, const vector<uint64_t>* filtro = nullptr) {
+        if (k == 0 || terminos.empty()) return {};
+
+        sort(terminos.begin(), terminos.end(), [](const TerminoConsulta& a, const TerminoConsulta& b) {
+            return a.cota > b.cota;
+        });
+
+        double cotaExtra = hashTitulo ? SistemaPuntuacion::BONUS_TITULO_EXACTO : 0.0;
+        for (const auto& refuerzo : refuerzos) cotaExtra += refuerzo.cota;
+
+        // restante[i] = máxima puntuación que puede sumar un documento con los términos i..n-1
+        vector<double> restante(terminos.size() + 1, cotaExtra);
+        for (size_t i = terminos.size(); i-- > 0;) {
+            restante[i] = restante[i + 1] + terminos[i].cota;
+        }
+
+        thread_local AcumuladorPuntuaciones acumulador;
+        thread_local vector<uint64_t> bitsVivos;
+        acumulador.preparar(totalDocumentos);
+        if (bitsVivos.size() < (totalDocumentos + 63) / 64) {
+            bitsVivos.resize((totalDocumentos + 63) / 64, 0);
+        }
+
+        double umbral = 0.0;
+        double maxPuntuacion = 0.0;
+        size_t trabajoDesdeUmbral = 0;
+        bool soloSondeo = false;
+        vector<uint32_t> vivos;
+
+        for (size_t i = 0; i < terminos.size(); ++i) {
+            const TerminoConsulta& termino = terminos[i];
+
+            if (soloSondeo) {
+                trabajoDesdeUmbral += sondear(termino, vivos, bitsVivos, acumulador);
+                // Re-podar cuesta O(vivos): se amortiza contra el trabajo de sondeo
+                if (trabajoDesdeUmbral >= vivos.size()) {
+                    umbral = max(umbral, kEsimaPuntuacion(vivos, acumulador, k));
+                    podar(vivos, bitsVivos, acumulador, restante[i + 1], umbral);
+                    trabajoDesdeUmbral = 0;
+                }
+                continue;
+            }
+
+            termino.lista.recorrer([&](const uint32_t* ids, const uint16_t* frecuencias, uint32_t cantidad) {
+                for (uint32_t p = 0; p < cantidad; ++p) {
+                    const uint32_t id = ids[p];
+                    if (filtro && !esVivo(*filtro, id)) continue; // Filtrar antes del top-K no altera las cotas
+                    acumulador.sumar(id, termino.contribucion(id, frecuencias ? frecuencias[p] : 1));
+                    maxPuntuacion = max(maxPuntuacion, acumulador.puntuacion(id));
+                }
+            });
+            trabajoDesdeUmbral += termino.lista.df;
+
+            // El umbral nunca supera la mejor puntuación: mientras lo restante la supere,
+            // no tiene sentido calcularlo
+            const vector<uint32_t>& tocados = acumulador.idsTocados();
+            if (restante[i + 1] < maxPuntuacion && tocados.size() >= k && trabajoDesdeUmbral >= tocados.size() / 4) {
+                umbral = kEsimaPuntuacion(tocados, acumulador, k);
+                trabajoDesdeUmbral = 0;
+                if (restante[i + 1] < umbral) {
+                    soloSondeo = true;
+                    vivos = marcarVivos(tocados, bitsVivos, totalDocumentos);
+                    podar(vivos, bitsVivos, acumulador, restante[i + 1], umbral);
+                }
+            }
+        }
+
+        if (!soloSondeo) {
+            vivos = marcarVivos(acumulador.idsTocados(), bitsVivos, totalDocumentos);
+        }
+        for (const auto& refuerzo : refuerzos) {
+            sondear(refuerzo, vivos, bitsVivos, acumulador);
+        }
+        if (hashTitulo) {
+            for (uint32_t id : vivos) {
+                if ((*hashTitulo)[id] == hashTermino) {
+                    acumulador.sumar(id, SistemaPuntuacion::BONUS_TITULO_EXACTO);
+                }
+            }
+        }
+
+        ResultadosBusqueda resultados;
+        resultados.reserve(vivos.size());
+        for (uint32_t id : vivos) {
+            resultados.push_back({id, acumulador.puntuacion(id)});
+            bitsVivos[id >> 6] &= ~(uint64_t(1) << (id & 63));
+        }
+        acumulador.extraer();
+
+        seleccionarMejores(resultados, k);
+        return resultados;
+    }
+
+    /**
+     * @brief Deja en 'resultados' solo los k mejores, ordenados (nth_element + sort)
+     *
+     * Complejidad: O(n + k log k)
+     */
+    static void seleccionarMejores(ResultadosBusqueda& resultados, size_t k) {
+        if (resultados.size() > k) {
+            nth_element(resultados.begin(), resultados.begin() + k, resultados.end(), mejor);
+            resultados.resize(k);
+        }
+        sort(resultados.begin(), resultados.end(), mejor);
+    }
+
+    /**
+     * @brief Los k mejores de los IDs tocados del acumulador, con un heap de tamaño k
+     *
+     * No copia los candidatos: cada uno cuesta una comparación contra el peor del
+     * heap y solo los que entran cuestan O(log k).
+     *
+     * Complejidad: O(n log k) en el peor caso, O(n + k log k) si casi ninguno entra
+     *
+     * @param admitir Predicado sobre el ID; los candidatos que no lo cumplen se ignoran
+     */
+    template<typename Admitir>
+    static ResultadosBusqueda mejoresDelAcumulador(const AcumuladorPuntuaciones& acumulador, size_t k,
+                                                   Admitir&& admitir) {
+        if (k == 0) return {};
+        // Con 'mejor' como orden, el tope del heap es el peor de los conservados
+        priority_queue<ResultadoBusqueda, vector<ResultadoBusqueda>, decltype(&mejor)> heap(&mejor);
+        for (uint32_t id : acumulador.idsTocados()) {
+            if (!admitir(id)) continue;
+            const ResultadoBusqueda candidato{id, acumulador.puntuacion(id)};
+            if (heap.size() < k) {
+                heap.push(candidato);
+            } else if (mejor(candidato, heap.top())) {
+                heap.pop();
+                heap.push(candidato);
+            }
+        }
+
+        ResultadosBusqueda resultados(heap.size());
+        for (size_t i = resultados.size(); i-- > 0;) {
+            resultados[i] = heap.top();
+            heap.pop();
+        }
+        return resultados;
+    }
+
+private:
+    static bool mejor(const ResultadoBusqueda& a, const ResultadoBusqueda& b) {
+        return a.puntuacion != b.puntuacion ? a.puntuacion > b.puntuacion : a.id < b.id;
+    }
+
+    static bool esVivo(const vector<uint64_t>& bits, uint32_t id) {
+        return (bits[id >> 6] >> (id & 63)) & 1;
+    }
+
+    /**
+     * @brief Marca los candidatos en el bitmap y los devuelve ordenados por ID
+     *
+     * Recorrer el bitmap cuesta O(N/64 + candidatos), menos que ordenarlos.
+     */
+    static vector<uint32_t> marcarVivos(const vector<uint32_t>& candidatos, vector<uint64_t>& bits,
+                                        size_t totalDocumentos) {
+        for (uint32_t id : candidatos) {
+            bits[id >> 6] |= uint64_t(1) << (id & 63);
+        }
+        vector<uint32_t> ordenados;
+        ordenados.reserve(candidatos.size());
+        const size_t palabras = (totalDocumentos + 63) / 64;
+        for (size_t w = 0; w < palabras; ++w) {
+            uint64_t palabra = bits[w];
+            while (palabra) {
+                ordenados.push_back(static_cast<uint32_t>(w * 64 + __builtin_ctzll(palabra)));
+                palabra &= palabra - 1;
+            }
+        }
+        return ordenados;
+    }
+
+    static double kEsimaPuntuacion(const vector<uint32_t>& ids, const AcumuladorPuntuaciones& acumulador, size_t k) {
+        if (ids.size() < k) return 0.0;
+        vector<double> puntuaciones;
+        puntuaciones.reserve(ids.size());
+        for (uint32_t id : ids) {
+            puntuaciones.push_back(acumulador.puntuacion(id));
+        }
+        nth_element(puntuaciones.begin(), puntuaciones.begin() + (k - 1), puntuaciones.end(), greater<double>());
+        return puntuaciones[k - 1];
+    }
+
+    /**
+     * @brief Descarta candidatos que ni sumando todas las cotas restantes llegan al umbral
+     */
+    static void podar(vector<uint32_t>& vivos, vector<uint64_t>& bits, const AcumuladorPuntuaciones& acumulador,
+                      double restante, double umbral) {
+        vivos.erase(remove_if(vivos.begin(), vivos.end(), [&](uint32_t id) {
+            if (acumulador.puntuacion(id) + restante < umbral) {
+                bits[id >> 6] &= ~(uint64_t(1) << (id & 63));
+                return true;
+            }
+            return false;
+        }), vivos.end());
+    }
+
+    /**
+     * @brief Suma la contribución del término solo a los candidatos vivos (ordenados)
+     *
+     * Recorre la lista más corta: las postings del término (consultando el bitmap de
+     * vivos) o los vivos (galopando sobre las postings; en una lista comprimida los
+     * saltos de bloque evitan descomprimir los bloques sin candidatos).
+     *
+     * @return Trabajo realizado (elementos visitados)
+     */
+    static size_t sondear(const TerminoConsulta& termino, const vector<uint32_t>& vivos,
+                          const vector<uint64_t>& bits, AcumuladorPuntuaciones& acumulador) {
+        if (termino.lista.df <= vivos.size()) {
+            termino.lista.recorrer([&](const uint32_t* ids, const uint16_t* frecuencias, uint32_t cantidad) {
+                for (uint32_t p = 0; p < cantidad; ++p) {
+                    if (esVivo(bits, ids[p])) {
+                        acumulador.sumar(ids[p], termino.contribucion(ids[p], frecuencias ? frecuencias[p] : 1));
+                    }
+                }
+            });
+            return termino.lista.df;
+        }
+
+        CursorPostings cursor(termino.lista);
+        for (uint32_t id : vivos) {
+            if (!cursor.avanzarHasta(id)) break;
+            if (cursor.id() == id) {
+                acumulador.sumar(id, termino.contribucion(id, cursor.frecuencia()));
+            }
+        }
+        return vivos.size();
+    }
+};
+
+/**
+ * @brief Índice de "películas similares" sobre vectores TF-IDF de las sinopsis
+ *
+ * Los vectores salen de transponer el Trie de sinopsis, así que usan las mismas
+ * palabras que indexarPelicula: cada película conserva sus TERMINOS_POR_VECTOR
+ * palabras de mayor peso (1 + log tf) × idf, normalizadas a norma 1. Los vecinos
+ * se buscan con MinHash-LSH: la firma de una película son BANDAS × FILAS
+ * minhashes de sus palabras y dos películas caen en la misma cubeta de una banda
+ * si coinciden sus FILAS minhashes. Solo los candidatos de sus cubetas se ordenan
+ * por similitud coseno exacta, de modo que una consulta no depende del tamaño
+ * del catálogo.
+ *
+ * Opcionalmente guarda los N vecinos de cada película, calculados al indexar.
+ * Como TrieCongelado, los arreglos son vistas sobre vectores propios o sobre la
+ * imagen mapeada del índice.
+ */
+class IndiceSimilitud {
+public:
+    static constexpr size_t TERMINOS_POR_VECTOR = 32;
+    static constexpr uint32_t BANDAS = 32;
+    static constexpr uint32_t FILAS = 2;
+    // Una cubeta más grande es una coincidencia demasiado común para distinguir vecinos
+    static constexpr uint32_t LIMITE_CUBETA = 2048;
+
+private:
+    struct Arreglos {
+        vector<uint32_t> inicioVectores{0}; // Entradas de cada película (+1 centinela)
+        vector<uint32_t> terminos;          // Ordenados dentro de cada vector
+        vector<float> pesos;
+        vector<uint64_t> claves;            // Clave de cada cubeta, ordenadas
+        vector<uint32_t> inicioCubetas;     // (+1 centinela)
+        vector<uint32_t> idsCubetas;
+        vector<uint32_t> inicioVecinos;     // Vacío si no se precalcularon vecinos
+        vector<uint32_t> vecinos;
+        vector<float> similitudes;
+    };
+
+    shared_ptr<const Arreglos> propios;
+    Vista<uint32_t> inicioVectores;
+    Vista<uint32_t> terminos;
+    Vista<float> pesos;
+    Vista<uint64_t> claves;
+    Vista<uint32_t> inicioCubetas;
+    Vista<uint32_t> idsCubetas;
+    Vista<uint32_t> inicioVecinos;
+    Vista<uint32_t> vecinos;
+    Vista<float> similitudes;
+    uint32_t vecinosPorPelicula = 0;
+
+public:
+    IndiceSimilitud() = default;
+
+    /**
+     * @param sinopsis TrieCongelado o TrieCompacto de las sinopsis
+     * @param vecinosPrecalculados Vecinos a guardar por película (0 = calcularlos al consultar)
+     *
+     * Complejidad: O(P + n × (t × BANDAS × FILAS)) para vectores y cubetas, donde
+     * P = postings de las sinopsis; más una consulta por película si se precalculan
+     * vecinos, repartidas entre los hilos del grupo
+     */
+    template<typename TrieT>
+    static IndiceSimilitud construir(const TrieT& sinopsis, size_t totalDocumentos, size_t vecinosPrecalculados,
+                                     GrupoHilos& grupoHilos) {
+        auto arreglos = make_shared<Arreglos>();
+        construirVectores(sinopsis, totalDocumentos, *arreglos);
+        construirCubetas(*arreglos);
+
+        IndiceSimilitud indice;
+        indice.asignarVistas(*arreglos);
+        if (vecinosPrecalculados > 0) {
+            indice.precalcularVecinos(*arreglos, vecinosPrecalculados, grupoHilos);
+            indice.asignarVistas(*arreglos);
+        }
+        indice.propios = move(arreglos);
+        return indice;
+    }
+
+    void escribir(EscritorImagen& escritor) const {
+        escritor.escribir(inicioVectores);
+        escritor.escribir(terminos);
+        escritor.escribir(pesos);
+        escritor.escribir(claves);
+        escritor.escribir(inicioCubetas);
+        escritor.escribir(idsCubetas);
+        escritor.escribir(inicioVecinos);
+        escritor.escribir(vecinos);
+        escritor.escribir(similitudes);
+        escritor.escribirValor(vecinosPorPelicula);
+    }
+
+    static IndiceSimilitud leer(LectorImagen& lector, size_t totalDocumentos) {
+        IndiceSimilitud indice;
+        indice.inicioVectores = lector.leer<uint32_t>();
+        indice.terminos = lector.leer<uint32_t>();
+        indice.pesos = lector.leer<float>();
+        indice.claves = lector.leer<uint64_t>();
+        indice.inicioCubetas = lector.leer<uint32_t>();
+        indice.idsCubetas = lector.leer<uint32_t>();
+        indice.inicioVecinos = lector.leer<uint32_t>();
+        indice.vecinos = lector.leer<uint32_t>();
+        indice.similitudes = lector.leer<float>();
+        indice.vecinosPorPelicula = lector.leerValor<uint32_t>();
+
+        const bool sinVecinos = indice.inicioVecinos.empty() && indice.vecinos.empty();
+        const bool coherente = indice.inicioVectores.size() == totalDocumentos + 1 &&
+            indice.inicioVectores.back() == indice.terminos.size() &&
+            indice.pesos.size() == indice.terminos.size() &&
+            indice.inicioCubetas.size() == indice.claves.size() + 1 &&
+            indice.inicioCubetas.back() == indice.idsCubetas.size() &&
+            indice.similitudes.size() == indice.vecinos.size() &&
+            (sinVecinos || (indice.inicioVecinos.size() == totalDocumentos + 1 &&
+                            indice.inicioVecinos.back() == indice.vecinos.size()));
+        if (!coherente) {
+            throw runtime_error("índice de similitud con arreglos incoherentes");
+        }
+        return indice;
+    }
+
+    uint32_t vecinosGuardados() const {
+        return vecinosPorPelicula;
+    }
+
+    /**
+     * @brief Películas con vector; las de IDs posteriores no tienen similares
+     */
+    size_t documentos() const {
+        return inicioVectores.empty() ? 0 : inicioVectores.size() - 1;
+    }
+
+    /**
+     * @brief Las k películas más parecidas a 'id' con su similitud coseno, de mayor a menor
+     *
+     * Usa los vecinos precalculados si alcanzan; si no, consulta las cubetas LSH.
+     */
+    ResultadosBusqueda similares(uint32_t id, size_t k) const {
+        if (id + 1 >= inicioVectores.size()) return {};
+        if (k <= vecinosPorPelicula && !inicioVecinos.empty()) {
+            ResultadosBusqueda resultados;
+            for (uint32_t i = inicioVecinos[id]; i < inicioVecinos[id + 1] && resultados.size() < k; ++i) {
+                resultados.push_back({vecinos[i], similitudes[i]});
+            }
+            return resultados;
+        }
+        return consultar(id, k);
+    }
+
+    size_t memoria() const {
+        return (inicioVectores.size() + terminos.size() + inicioCubetas.size() + idsCubetas.size() +
+                inicioVecinos.size() + vecinos.size()) * sizeof(uint32_t) +
+               (pesos.size() + similitudes.size()) * sizeof(float) + claves.size() * sizeof(uint64_t);
+    }
+
+private:
+    void asignarVistas(const Arreglos& arreglos) {
+        inicioVectores = Vista<uint32_t>(arreglos.inicioVectores);
+        terminos = Vista<uint32_t>(arreglos.terminos);
+        pesos = Vista<float>(arreglos.pesos);
+        claves = Vista<uint64_t>(arreglos.claves);
+        inicioCubetas = Vista<uint32_t>(arreglos.inicioCubetas);
+        idsCubetas = Vista<uint32_t>(arreglos.idsCubetas);
+        inicioVecinos = Vista<uint32_t>(arreglos.inicioVecinos);
+        vecinos = Vista<uint32_t>(arreglos.vecinos);
+        similitudes = Vista<float>(arreglos.similitudes);
+    }
+
+    /**
+     * @brief Transpone las postings del Trie (palabra → películas) a un vector por película
+     *
+     * Cada palabra recibe como ID su orden de visita; las que aparecen en una sola
+     * película no acercan a ninguna otra y se omiten.
+     */
+    template<typename TrieT>
+    static void construirVectores(const TrieT& sinopsis, size_t totalDocumentos, Arreglos& arreglos) {
+        struct Entrada {
+            uint32_t termino;
+            float peso;
+        };
+        vector<uint32_t> conteos(totalDocumentos + 1, 0);
+        sinopsis.recorrerTerminos("", [&](string_view, const ListaPostings& lista, uint16_t) {
+            if (lista.df < 2) return;
+            lista.recorrer([&](const uint32_t* ids, const uint16_t*, uint32_t cantidad) {
+                for (uint32_t k = 0; k < cantidad; ++k) ++conteos[ids[k] + 1];
+            }, false);
+        });
+        for (size_t i = 1; i <= totalDocumentos; ++i) conteos[i] += conteos[i - 1];
+
+        vector<Entrada> entradas(conteos[totalDocumentos]);
+        vector<uint32_t> llenado(conteos.begin(), conteos.end() - 1);
+        uint32_t termino = 0;
+        sinopsis.recorrerTerminos("", [&](string_view, const ListaPostings& lista, uint16_t) {
+            ++termino;
+            if (lista.df < 2) return;
+            const double idf = SistemaPuntuacion::idf(lista.df, totalDocumentos);
+            lista.recorrer([&](const uint32_t* ids, const uint16_t* frecuencias, uint32_t cantidad) {
+                for (uint32_t k = 0; k < cantidad; ++k) {
+                    entradas[llenado[ids[k]]++] = {termino, static_cast<float>((1.0 + log(frecuencias[k])) * idf)};
+                }
+            });
+        });
+
+        arreglos.inicioVectores.reserve(totalDocumentos + 1);
+        for (size_t id = 0; id < totalDocumentos; ++id) {
+            auto inicio = entradas.begin() + conteos[id];
+            auto fin = entradas.begin() + conteos[id + 1];
+            if (static_cast<size_t>(fin - inicio) > TERMINOS_POR_VECTOR) {
+                nth_element(inicio, inicio + TERMINOS_POR_VECTOR, fin, [](const Entrada& a, const Entrada& b) {
+                    return a.peso != b.peso ? a.peso > b.peso : a.termino < b.termino;
+                });
+                fin = inicio + TERMINOS_POR_VECTOR;
+            }
+            sort(inicio, fin, [](const Entrada& a, const Entrada& b) { return a.termino < b.termino; });
+
+            double norma = 0.0;
+            for (auto it = inicio; it != fin; ++it) norma += double(it->peso) * it->peso;
+            norma = sqrt(norma);
+            for (auto it = inicio; it != fin; ++it) {
+                arreglos.terminos.push_back(it->termino);
+                arreglos.pesos.push_back(static_cast<float>(it->peso / norma));
+            }
+            arreglos.inicioVectores.push_back(static_cast<uint32_t>(arreglos.terminos.size()));
+        }
+    }
+
+    static void construirCubetas(Arreglos& arreglos) {
+        const size_t n = arreglos.inicioVectores.size() - 1;
+        vector<pair<uint64_t, uint32_t>> pares; // (clave de cubeta, película)
+        pares.reserve(n * BANDAS);
+        array<uint64_t, BANDAS> clavesPelicula;
+        for (size_t id = 0; id < n; ++id) {
+            const uint32_t* inicio = arreglos.terminos.data() + arreglos.inicioVectores[id];
+            const uint32_t* fin = arreglos.terminos.data() + arreglos.inicioVectores[id + 1];
+            if (inicio == fin) continue;
+            clavesDeBandas(inicio, fin, clavesPelicula);
+            for (uint64_t clave : clavesPelicula) pares.emplace_back(clave, static_cast<uint32_t>(id));
+        }
+        sort(pares.begin(), pares.end());
+
+        arreglos.inicioCubetas.clear();
+        for (size_t i = 0; i < pares.size(); ++i) {
+            if (i == 0 || pares[i].first != pares[i - 1].first) {
+                arreglos.claves.push_back(pares[i].first);
+                arreglos.inicioCubetas.push_back(static_cast<uint32_t>(i));
+            }
+            arreglos.idsCubetas.push_back(pares[i].second);
+        }
+        arreglos.inicioCubetas.push_back(static_cast<uint32_t>(pares.size()));
+    }
+
+    void precalcularVecinos(Arreglos& arreglos, size_t cantidad, GrupoHilos& grupoHilos) {
+        const size_t n = arreglos.inicioVectores.size() - 1;
+        vector<ResultadosBusqueda> porPelicula(n);
+        grupoHilos.paraCada(n, [this, cantidad, &porPelicula](size_t id) {
+            porPelicula[id] = consultar(static_cast<uint32_t>(id), cantidad);
+        });
+
+        arreglos.inicioVecinos.assign(1, 0);
+        for (const auto& lista : porPelicula) {
+            for (const auto& vecino : lista) {
+                arreglos.vecinos.push_back(vecino.id);
+                arreglos.similitudes.push_back(static_cast<float>(vecino.puntuacion));
+            }
+            arreglos.inicioVecinos.push_back(static_cast<uint32_t>(arreglos.vecinos.size()));
+        }
+        vecinosPorPelicula = static_cast<uint32_t>(cantidad);
+    }
+
+    ResultadosBusqueda consultar(uint32_t id, size_t k) const {
+        const uint32_t* inicio = terminos.data() + inicioVectores[id];
+        const uint32_t* fin = terminos.data() + inicioVectores[id + 1];
+        if (inicio == fin) return {};
+
+        array<uint64_t, BANDAS> clavesPelicula;
+        clavesDeBandas(inicio, fin, clavesPelicula);
+
+        thread_local AcumuladorPuntuaciones acumulador;
+        acumulador.preparar(inicioVectores.size() - 1);
+        for (uint64_t clave : clavesPelicula) {
+            const uint64_t* it = lower_bound(claves.begin(), claves.end(), clave);
+            if (it == claves.end() || *it != clave) continue;
+            const size_t cubeta = static_cast<size_t>(it - claves.begin());
+            if (inicioCubetas[cubeta + 1] - inicioCubetas[cubeta] > LIMITE_CUBETA) continue;
+            for (uint32_t i = inicioCubetas[cubeta]; i < inicioCubetas[cubeta + 1]; ++i) {
+                const uint32_t candidato = idsCubetas[i];
+                if (candidato == id || acumulador.contiene(candidato)) continue;
+                const double similitud = coseno(id, candidato);
+                if (similitud > 0.0) acumulador.sumar(candidato, similitud);
+            }
+        }
+        ResultadosBusqueda resultados = EvaluadorTopK::mejoresDelAcumulador(acumulador, k, [](uint32_t) {
+            return true;
+        });
+        acumulador.descartar();
+        return resultados;
+    }
+
+    double coseno(uint32_t a, uint32_t b) const {
+        uint32_t i = inicioVectores[a], j = inicioVectores[b];
+        const uint32_t finA = inicioVectores[a + 1], finB = inicioVectores[b + 1];
+        double producto = 0.0;
+        while (i < finA && j < finB) {
+            if (terminos[i] == terminos[j]) {
+                producto += double(pesos[i++]) * pesos[j++];
+            } else if (terminos[i] < terminos[j]) {
+                ++i;
+            } else {
+                ++j;
+            }
+        }
+        return producto;
+    }
+
+    /**
+     * @brief Clave de la cubeta de cada banda: la banda y sus FILAS minhashes mezclados
+     */
+    static void clavesDeBandas(const uint32_t* inicio, const uint32_t* fin, array<uint64_t, BANDAS>& resultado) {
+        for (uint32_t banda = 0; banda < BANDAS; ++banda) {
+            uint64_t clave = mezclar(banda);
+            for (uint32_t fila = 0; fila < FILAS; ++fila) {
+                const uint64_t semilla = mezclar(uint64_t(banda) * FILAS + fila + 0x51ED27);
+                uint64_t minimo = numeric_limits<uint64_t>::max();
+                for (const uint32_t* p = inicio; p != fin; ++p) {
+                    minimo = min(minimo, mezclar(*p ^ semilla));
+                }
+                clave = mezclar(clave ^ minimo);
+            }
+            resultado[banda] = clave;
+        }
+    }
+
+    /**
+     * @brief Mezclador de splitmix64: cada bit de entrada afecta a todos los de salida
+     */
+    static uint64_t mezclar(uint64_t x) {
+        x += 0x9E3779B97F4A7C15ULL;
+        x = (x ^ (x >> 30)) * 0xBF58476D1CE4E5B9ULL;
+        x = (x ^ (x >> 27)) * 0x94D049BB133111EBULL;
+        return x ^ (x >> 31);
+    }
+};
+
+/**
+ * @brief Segmento inmutable del índice: Tries y tags de las películas [primerId, finId)
+ *
+ * Los segmentos de una instantánea cubren rangos de IDs contiguos y crecientes:
+ * concatenar en orden las postings de todos da postings ordenadas, y cada
+ * película se puntúa entera dentro de su segmento. Nunca se modifican; el
+ * compactador fusiona varios adyacentes en uno nuevo (ver PoliticaSegmentos).
+ * Cada segmento usa su propia frecuencia documental, como un shard.
+ */
+struct SegmentoIndice {
+    TrieCongelado titulos;
+    TrieCongelado sinopsis;
+    IndiceTagsCongelado tags;
+    uint32_t primerId = 0;
+    uint32_t finId = 0;
+    size_t documentos = 0; // Películas indexadas: las ya borradas al construirlo no cuentan
+
+    size_t postingsConPrefijo(const string& prefijo) const {
+        return titulos.postingsConPrefijo(prefijo) + sinopsis.postingsConPrefijo(prefijo);
+    }
+
+    size_t memoria() const {
+        return titulos.memoriaPostings() + sinopsis.memoriaPostings() + tags.memoria();
+    }
+
+    void escribir(EscritorImagen& escritor) const {
+        escritor.escribirValor(primerId);
+        escritor.escribirValor(finId);
+        escritor.escribirValor(static_cast<uint64_t>(documentos));
+        titulos.escribir(escritor);
+        sinopsis.escribir(escritor);
+        tags.escribir(escritor);
+    }
+
+    static SegmentoIndice leer(LectorImagen& lector) {
+        SegmentoIndice segmento;
+        segmento.primerId = lector.leerValor<uint32_t>();
+        segmento.finId = lector.leerValor<uint32_t>();
+        segmento.documentos = lector.leerValor<uint64_t>();
+        segmento.titulos = TrieCongelado::leer(lector);
+        segmento.sinopsis = TrieCongelado::leer(lector);
+        segmento.tags = IndiceTagsCongelado::leer(lector);
+        if (segmento.primerId > segmento.finId || segmento.titulos.universo() > segmento.finId ||
+            segmento.sinopsis.universo() > segmento.finId) {
+            throw runtime_error("segmento con IDs fuera de su rango");
+        }
+        return segmento;
+    }
+};
+
+/**
+ * @brief Cuándo se sella el delta y qué segmentos fusiona el compactador
+ *
+ * Niveles escalonados: un segmento es de nivel L si tiene del orden de
+ * peliculasDelta × segmentosPorNivel^L películas, y segmentosPorNivel segmentos
+ * adyacentes del mismo nivel se fusionan en uno del nivel siguiente. Así cada
+ * película se reescribe O(log n) veces y ninguna fusión supera
+ * maxPeliculasSegmento películas.
+ */
+struct PoliticaSegmentos {
+    size_t peliculasDelta = 256;          // Películas del delta que lo sellan como segmento
+    size_t segmentosPorNivel = 4;
+    size_t maxPeliculasSegmento = 1 << 20;
+    double maxFraccionBorradas = 0.25;    // Con más borradas, el segmento se reescribe solo
+    double maxFraccionSinSimilitud = 0.1; // Películas sin vector que disparan reconstruir la similitud
+
+    size_t nivel(size_t documentos) const {
+        size_t nivel = 0;
+        for (size_t tope = max<size_t>(1, peliculasDelta) * segmentosPorNivel; documentos >= tope && nivel < 64;
+             tope *= max<size_t>(2, segmentosPorNivel)) {
+            ++nivel;
+        }
+        return nivel;
+    }
+};
+
+/**
+ * @brief Instantánea inmutable de los índices que se publica a los lectores
+ *
+ * Se construye una sola vez y nunca se modifica, por lo que cualquier número de
+ * hilos puede consultarla en paralelo sin sincronización. Trae su propia
+ * versión del catálogo y de las estadísticas: una consulta nunca mezcla datos
+ * de dos actualizaciones. Los segmentos se comparten entre instantáneas.
+ *
+ * Si peliculasDelta > 0 el último segmento es el delta: las películas agregadas
+ * desde que se selló el anterior, que se vuelve a congelar en cada
+ * actualización. Las borradas o reemplazadas siguen en sus segmentos hasta que
+ * se reescriben y se descartan con 'vigentes'.
+ */
+struct IndicesPublicados {
+    vector<shared_ptr<const SegmentoIndice>> segmentos;
+    size_t peliculasDelta = 0;
+    IndiceSimilitud similitud;
+
+    CatalogoPeliculas catalogo;
+    shared_ptr<const EstadisticasDocumentos> estadisticas;
+    vector<uint64_t> vigentes; // Bit por ID: 0 = borrada o reemplazada (vacío si no hay ninguna)
+    size_t borradas = 0;
+
+    bool vigente(uint32_t id) const {
+        return borradas == 0 || ((vigentes[id >> 6] >> (id & 63)) & 1);
+    }
+
+    /**
+     * @brief Borradas con ID en [desde, hasta)
+     */
+    size_t borradasEntre(uint32_t desde, uint32_t hasta) const {
+        if (borradas == 0) return 0;
+        size_t total = 0;
+        for (uint32_t id = desde; id < hasta; ++id) total += !vigente(id);
+        return total;
+    }
+
+    size_t postingsConPrefijo(const string& prefijo) const {
+        size_t total = 0;
+        for (const auto& segmento : segmentos) total += segmento->postingsConPrefijo(prefijo);
+        return total;
+    }
+
+    size_t memoriaPostings() const {
+        size_t bytes = 0;
+        for (const auto& segmento : segmentos) {
+            bytes += segmento->titulos.memoriaPostings() + segmento->sinopsis.memoriaPostings();
+        }
+        return bytes;
+    }
+};
+
+/**
+ * @brief Recuperación por épocas de las instantáneas retiradas
+ *
+ * Cada hilo lector tiene su propia ranura, en su propia línea de caché: al
+ * entrar copia ahí la época global y al salir la vuelve a cero, sin escribir
+ * en memoria compartida con otros lectores, así que las lecturas escalan con
+ * los núcleos. El escritor no espera a nadie: retirar() avanza la época y
+ * guarda la instantánea vieja junto a la época en que dejó de ser visible, y
+ * recolectar() libera las que ya no puede estar leyendo ninguna ranura activa.
+ * Las ranuras y la época son de todo el proceso: un hilo usa la misma ranura
+ * para cualquier gestor y la libera al terminar.
+ */
+class EpocasLectura {
+private:
+    struct alignas(64) Ranura {
+        atomic<uint64_t> epoca{0}; // 0 = fuera de toda lectura
+        atomic<bool> ocupada{true};
+        Ranura* siguiente = nullptr;
+    };
+
+    struct RanuraHilo {
+        Ranura* ranura = nullptr;
+        size_t profundidad = 0; // Guardias anidadas: solo la primera publica la época
+
+        ~RanuraHilo() {
+            if (ranura) ranura->ocupada.store(false, memory_order_release);
+        }
+    };
+
+    // Nunca se liberan: son tantas como hilos leyeron a la vez
+    static inline atomic<Ranura*> ranuras{nullptr};
+    static inline atomic<uint64_t> epocaGlobal{1};
+
+    mutex retiradas_mutex;
+    vector<pair<uint64_t, shared_ptr<const void>>> retiradas;
+
+    static RanuraHilo& ranuraDelHilo() {
+        thread_local RanuraHilo propia;
+        if (propia.ranura) return propia;
+        for (Ranura* r = ranuras.load(memory_order_acquire); r; r = r->siguiente) {
+            bool ocupada = false;
+            if (!r->ocupada.load(memory_order_relaxed) &&
+                r->ocupada.compare_exchange_strong(ocupada, true, memory_order_acquire)) {
+                propia.ranura = r;
+                return propia;
+            }
+        }
+        auto* nueva = new Ranura();
+        nueva->siguiente = ranuras.load(memory_order_relaxed);
+        while (!ranuras.compare_exchange_weak(nueva->siguiente, nueva, memory_order_release)) {}
+        propia.ranura = nueva;
+        return propia;
+    }
+
+public:
+    class Guardia {
+    private:
+        RanuraHilo* propia;
+
+    public:
+        explicit Guardia(RanuraHilo* propia) : propia(propia) {}
+        Guardia(const Guardia&) = delete;
+        Guardia& operator=(const Guardia&) = delete;
+
+        ~Guardia() {
+            if (--propia->profundidad == 0) propia->ranura->epoca.store(0, memory_order_release);
+        }
+    };
+
+    /**
+     * @brief Marca el comienzo de una lectura, que dura mientras viva la guardia
+     */
+    Guardia entrar() const {
+        RanuraHilo& propia = ranuraDelHilo();
+        if (propia.profundidad++ == 0) {
+            propia.ranura->epoca.store(epocaGlobal.load(memory_order_acquire), memory_order_relaxed);
+            // La época publicada debe ser visible antes de leer el puntero: o el escritor
+            // la ve al recolectar, o este lector ya ve la instantánea nueva
+            atomic_thread_fence(memory_order_seq_cst);
+        }
+        return Guardia(&propia);
+    }
+
+    /**
+     * @brief Entrega una instantánea que ya no está publicada; se libera cuando nadie puede leerla
+     *
+     * Llamar después de publicar la nueva. No espera a las lecturas en curso.
+     */
+    void retirar(shared_ptr<const void> vieja) {
+        const uint64_t ultimaVisible = epocaGlobal.fetch_add(1, memory_order_acq_rel);
+        lock_guard<mutex> lock(retiradas_mutex);
+        retiradas.emplace_back(ultimaVisible, move(vieja));
+    }
+
+    /**
+     * @brief Libera las instantáneas retiradas antes de la lectura activa más antigua
+     *
+     * Complejidad: O(ranuras + retiradas)
+     */
+    void recolectar() {
+        atomic_thread_fence(memory_order_seq_cst);
+        uint64_t minima = numeric_limits<uint64_t>::max();
+        for (Ranura* r = ranuras.load(memory_order_acquire); r; r = r->siguiente) {
+            const uint64_t epoca = r->epoca.load(memory_order_acquire);
+            if (epoca != 0) minima = min(minima, epoca);
+        }
+        vector<shared_ptr<const void>> liberables;
+        {
+            lock_guard<mutex> lock(retiradas_mutex);
+            // Un lector con época mayor que ultimaVisible entró después de retirarla
+            auto visible = [minima](const auto& retirada) { return retirada.first >= minima; };
+            auto corte = stable_partition(retiradas.begin(), retiradas.end(), visible);
+            for (auto it = corte; it != retiradas.end(); ++it) liberables.push_back(move(it->second));
+            retiradas.erase(corte, retiradas.end());
+        }
+    }
+};
+
+/**
+ * @brief Término o frase de una consulta (una sola palabra = término por prefijo)
+ */
+struct ElementoConsulta {
+    vector<string> palabras;
+};
+
+/**
+ * @brief Alternativas unidas por OR; si está negada excluye a los documentos que la cumplen
+ */
+struct ClausulaConsulta {
+    vector<ElementoConsulta> alternativas;
+    bool negada = false;
+};
+
+/**
+ * @brief Consulta booleana analizada: AND implícito entre cláusulas
+ *
+ * Sintaxis: palabras separadas por espacios deben aparecer todas (AND), "A OR B"
+ * acepta cualquiera de las dos, "-palabra" o "NOT palabra" excluye, y el texto
+ * entre comillas es una frase cuyas palabras deben aparecer consecutivas. Los
+ * operadores van en mayúsculas para no confundirse con palabras del texto.
+ * Cada término se busca como prefijo; en una frase solo la última palabra es
+ * prefijo y las demás deben coincidir exactamente.
+ */
+struct ConsultaBooleana {
+    vector<ClausulaConsulta> clausulas;
+
+    static ConsultaBooleana analizar(const string& texto) {
+        ConsultaBooleana consulta;
+        bool negarSiguiente = false;
+        bool unirConOr = false;
+
+        size_t i = 0;
+        while (i < texto.size()) {
+            if (isspace(static_cast<unsigned char>(texto[i]))) {
+                ++i;
+                continue;
+            }
+
+            bool negado = false;
+            if (texto[i] == '-' && i + 1 < texto.size() && !isspace(static_cast<unsigned char>(texto[i + 1]))) {
+                negado = true;
+                ++i;
+            }
+
+            ElementoConsulta elemento;
+            if (texto[i] == '"') {
+                size_t cierre = texto.find('"', i + 1);
+                if (cierre == string::npos) cierre = texto.size();
+                agregarTokens(string_view(texto).substr(i + 1, cierre - i - 1), elemento);
+                i = min(cierre + 1, texto.size());
+            } else {
+                size_t fin = i;
+                while (fin < texto.size() && !isspace(static_cast<unsigned char>(texto[fin]))) ++fin;
+                const string palabra = texto.substr(i, fin - i);
+                i = fin;
+
+                if (!negado && palabra == "OR") {
+                    unirConOr = !consulta.clausulas.empty();
+                    continue;
+                }
+                if (!negado && palabra == "AND") continue;
+                if (!negado && palabra == "NOT") {
+                    negarSiguiente = true;
+                    continue;
+                }
+                // "spider-man" da dos palabras: se buscan como la frase "spider man"
+                agregarTokens(palabra, elemento);
+            }
+            if (elemento.palabras.empty()) continue;
+
+            negado = negado || negarSiguiente;
+            negarSiguiente = false;
+            if (unirConOr && !negado && !consulta.clausulas.back().negada) {
+                consulta.clausulas.back().alternativas.push_back(move(elemento));
+            } else {
+                consulta.clausulas.push_back({{move(elemento)}, negado});
+            }
+            unirConOr = false;
+        }
+        return consulta;
+    }
+
+    /**
+     * @brief Analiza una expresión de tags: "horror AND comedy NOT gore", "drama OR romance"
+     *
+     * Mismos operadores que analizar(), pero cada elemento es un tag completo: las
+     * palabras entre operadores forman un solo tag ("science fiction, cult" son dos
+     * tags), ',' equivale a AND, como en el CSV, y "-tag" empieza un tag excluido.
+     */
+    static ConsultaBooleana analizarTags(const string& texto) {
+        ConsultaBooleana consulta;
+        string tag;
+        bool negado = false;
+        bool unirConOr = false;
+
+        auto cerrarTag = [&]() {
+            if (tag.empty()) return;
+            ElementoConsulta elemento{{tag}};
+            if (unirConOr && !negado && !consulta.clausulas.back().negada) {
+                consulta.clausulas.back().alternativas.push_back(move(elemento));
+            } else {
+                consulta.clausulas.push_back({{move(elemento)}, negado});
+            }
+            tag.clear();
+            negado = false;
+            unirConOr = false;
+        };
+
+        string separado;
+        for (char c : texto) {
+            separado += (c == ',') ? string(" , ") : string(1, c);
+        }
+        istringstream palabras(separado);
+        string palabra;
+        while (palabras >> palabra) {
+            if (palabra == "AND" || palabra == ",") {
+                cerrarTag();
+            } else if (palabra == "OR") {
+                cerrarTag();
+                unirConOr = !consulta.clausulas.empty();
+            } else if (palabra == "NOT") {
+                cerrarTag();
+                negado = true;
+            } else {
+                if (palabra.size() > 1 && palabra[0] == '-') {
+                    cerrarTag();
+                    negado = true;
+                    palabra.erase(0, 1);
+                }
+                tag += (tag.empty() ? "" : " ") + NormalizadorTexto::normalizarTag(palabra);
+            }
+        }
+        cerrarTag();
+        return consulta;
+    }
+
+    /**
+     * @brief Agrega al elemento las palabras de 'texto' tal como las tokeniza la indexación
+     */
+    static void agregarTokens(string_view texto, ElementoConsulta& elemento) {
+        string buffer;
+        NormalizadorTexto::paraCadaToken(texto, buffer, [&elemento](string_view token) {
+            elemento.palabras.emplace_back(token);
+        });
+    }
+
+    /**
+     * @brief true si la consulta es un único prefijo sin operadores (ruta de buscar clásica)
+     */
+    bool esTerminoSimple() const {
+        return clausulas.size() == 1 && !clausulas[0].negada && clausulas[0].alternativas.size() == 1 &&
+               clausulas[0].alternativas[0].palabras.size() == 1;
+    }
+
+    /**
+     * @brief Forma normalizada de la consulta: dos textos con la misma clave dan los mismos resultados
+     */
+    string clave() const {
+        string texto;
+        for (const auto& clausula : clausulas) {
+            texto += clausula.negada ? '-' : '+';
+            for (size_t a = 0; a < clausula.alternativas.size(); ++a) {
+                if (a > 0) texto += '|';
+                for (size_t p = 0; p < clausula.alternativas[a].palabras.size(); ++p) {
+                    if (p > 0) texto += ' ';
+                    texto += clausula.alternativas[a].palabras[p];
+                }
+            }
+            texto += '\n';
+        }
+        return texto;
+    }
+
+    /**
+     * @brief Palabras de las cláusulas no negadas, sin repetir, en orden de aparición
+     */
+    vector<string> palabrasPositivas() const {
+        vector<string> palabras;
+        for (const auto& clausula : clausulas) {
+            if (clausula.negada) continue;
+            for (const auto& elemento : clausula.alternativas) {
+                for (const auto& palabra : elemento.palabras) {
+                    if (find(palabras.begin(), palabras.end(), palabra) == palabras.end()) {
+                        palabras.push_back(palabra);
+                    }
+                }
+            }
+        }
+        return palabras;
+    }
+};
+
+/**
+ * @brief Evalúa una ConsultaBooleana sobre los Tries de títulos y sinopsis
+ *
+ * Solo se materializa la cláusula de menor tamaño estimado; las demás filtran a
+ * esos candidatos intersectando con galope contra cada posting list, por lo que
+ * agregar términos reduce el trabajo en lugar de aumentarlo. Las frases se
+ * verifican con las posiciones de cada palabra, campo por campo.
+ *
+ * Las palabras que no están en el índice de sinopsis (PalabrasIgnoradas) no
+ * restringen la consulta si queda otra cláusula positiva, y dentro de una frase
+ * solo ocupan su posición: "lord of the rings" exige "lord" y "rings" con dos
+ * palabras cualesquiera entre medio.
+ *
+ * @tparam TrieT TrieCongelado o TrieCompacto
+ */
+template<typename TrieT>
+class EvaluadorBooleano {
+public:
+    /**
+     * @brief IDs ordenados de los documentos que cumplen la consulta en título o sinopsis
+     *
+     * Una consulta sin cláusulas positivas no devuelve nada.
+     *
+     * @param precalculadas Si devuelve una lista para una palabra, se usa en lugar
+     *        de unir sus postings (buscarLote las arma una vez para todo un tramo)
+     */
+    static vector<uint32_t> evaluar(const ConsultaBooleana& consulta, const TrieT& titulos,
+                                    const TrieT& sinopsis, const PalabrasIgnoradas& ignoradas, uint32_t universo,
+                                    const function<const vector<uint32_t>*(const string&)>& precalculadas = {}) {
+        struct Conjunto {
+            vector<ListaPostings> listas; // El conjunto es la unión de estas listas
+            size_t estimado = 0;     // Suma de largos: cota superior del tamaño
+            bool negado = false;
+        };
+
+        size_t numFrases = 0;
+        for (const auto& clausula : consulta.clausulas) {
+            for (const auto& elemento : clausula.alternativas) {
+                numFrases += elemento.palabras.size() > 1;
+            }
+        }
+        vector<vector<uint32_t>> frases;
+        frases.reserve(numFrases); // Los rangos apuntan a estos vectores: no deben reubicarse
+
+        // "the" casi no filtra y ya no está en las sinopsis: exigirlo dejaría solo los títulos que lo tienen
+        auto esIgnorable = [&ignoradas](const ClausulaConsulta& clausula) {
+            if (clausula.negada) return false;
+            for (const auto& elemento : clausula.alternativas) {
+                if (elemento.palabras.size() != 1 || !ignoradas.contiene(elemento.palabras[0])) return false;
+            }
+            return true;
+        };
+        const bool omitirIgnorables = any_of(consulta.clausulas.begin(), consulta.clausulas.end(),
+                                             [&](const ClausulaConsulta& c) { return !c.negada && !esIgnorable(c); });
+
+        vector<Conjunto> positivos, negativos;
+        for (const auto& clausula : consulta.clausulas) {
+            if (omitirIgnorables && esIgnorable(clausula)) continue;
+            Conjunto conjunto;
+            conjunto.negado = clausula.negada;
+            for (const auto& elemento : clausula.alternativas) {
+                const vector<uint32_t>* unidas = (precalculadas && elemento.palabras.size() == 1)
+                                                     ? precalculadas(elemento.palabras[0]) : nullptr;
+                if (unidas) {
+                    conjunto.listas.push_back(RangoIds(*unidas));
+                    conjunto.estimado += unidas->size();
+                } else if (elemento.palabras.size() == 1) {
+                    auto agregar = [&conjunto](const ListaPosicional& lista) {
+                        conjunto.listas.push_back(lista.postings);
+                        conjunto.estimado += lista.postings.df;
+                    };
+                    titulos.recorrerListas(elemento.palabras[0], agregar);
+                    sinopsis.recorrerListas(elemento.palabras[0], agregar);
+                } else {
+                    vector<uint32_t> enTitulos = evaluarFrase(elemento.palabras, titulos, universo);
+                    vector<uint32_t> enSinopsis = evaluarFrase(elemento.palabras, sinopsis, ignoradas, universo);
+                    frases.push_back(OperacionesPostings::fusionar({RangoIds(enTitulos), RangoIds(enSinopsis)}));
+                    conjunto.listas.push_back(RangoIds(frases.back()));
+                    conjunto.estimado += frases.back().size();
+                }
+            }
+            (conjunto.negado ? negativos : positivos).push_back(move(conjunto));
+        }
+        if (positivos.empty()) return {};
+
+        sort(positivos.begin(), positivos.end(), [](const Conjunto& a, const Conjunto& b) {
+            return a.estimado < b.estimado;
+        });
+
+        vector<uint32_t> candidatos = OperacionesPostings::fusionar(positivos[0].listas, universo);
+        for (size_t i = 1; i < positivos.size() && !candidatos.empty(); ++i) {
+            candidatos = filtrar(candidatos, positivos[i].listas, true, universo);
+        }
+        for (size_t i = 0; i < negativos.size() && !candidatos.empty(); ++i) {
+            candidatos = filtrar(candidatos, negativos[i].listas, false, universo);
+        }
+        return candidatos;
+    }
+
+private:
+    /**
+     * @brief Candidatos presentes (o ausentes, si !conservarPresentes) en alguna de las listas
+     */
+    static vector<uint32_t> filtrar(const vector<uint32_t>& candidatos, const vector<ListaPostings>& listas,
+                                    bool conservarPresentes, uint32_t universo) {
+        thread_local IndiceCandidatos indice;
+        indice.preparar(candidatos, universo);
+        vector<char> presente(candidatos.size(), 0);
+        for (const auto& lista : listas) {
+            indice.intersectar(lista, [&presente](size_t i, uint16_t) { presente[i] = 1; });
+        }
+        indice.liberar();
+
+        vector<uint32_t> resultado;
+        for (size_t i = 0; i < candidatos.size(); ++i) {
+            if (static_cast<bool>(presente[i]) == conservarPresentes) {
+                resultado.push_back(candidatos[i]);
+            }
+        }
+        return resultado;
+    }
+
+    /**
+     * @brief Documentos del campo donde las palabras aparecen en posiciones consecutivas
+     */
+    static vector<uint32_t> evaluarFrase(const vector<string>& palabras, const TrieT& campo, uint32_t universo) {
+        vector<uint32_t> desplazamientos(palabras.size());
+        for (size_t i = 0; i < palabras.size(); ++i) desplazamientos[i] = static_cast<uint32_t>(i);
+        return evaluarFrase(palabras, desplazamientos, true, campo, universo);
+    }
+
+    /**
+     * @brief Como la anterior, saltando las palabras que el campo no indexó
+     */
+    static vector<uint32_t> evaluarFrase(const vector<string>& palabras, const TrieT& campo,
+                                         const PalabrasIgnoradas& ignoradas, uint32_t universo) {
+        vector<string> indexadas;
+        vector<uint32_t> desplazamientos;
+        for (size_t i = 0; i < palabras.size(); ++i) {
+            if (!ignoradas.contiene(palabras[i])) {
+                indexadas.push_back(palabras[i]);
+                desplazamientos.push_back(static_cast<uint32_t>(i));
+            }
+        }
+        if (indexadas.empty()) return {};
+        // Si se saltó la última palabra, la nueva última ya no es un prefijo sino una palabra completa
+        const bool ultimaEsPrefijo = desplazamientos.back() + 1 == palabras.size();
+        return evaluarFrase(indexadas, desplazamientos, ultimaEsPrefijo, campo, universo);
+    }
+
+    /**
+     * @brief Documentos del campo donde cada palabra i aparece desplazamientos[i] posiciones después de la primera
+     *
+     * Los candidatos salen de intersectar las palabras exactas empezando por la
+     * más rara; con sus posiciones se calcula dónde debería estar la última palabra.
+     * Esa última palabra es un prefijo (si ultimaEsPrefijo) y puede expandirse a
+     * muchas listas, que se recorren una sola vez cada una con un cursor monótono.
+     */
+    static vector<uint32_t> evaluarFrase(const vector<string>& palabras, const vector<uint32_t>& desplazamientos,
+                                         bool ultimaEsPrefijo, const TrieT& campo, uint32_t universo) {
+        const size_t n = palabras.size();
+        auto recorrerUltima = [&](auto&& visitar) {
+            ListaPosicional lista;
+            if (ultimaEsPrefijo) {
+                campo.recorrerListas(palabras.back(), visitar);
+            } else if (campo.obtenerLista(palabras.back(), lista)) {
+                visitar(lista);
+            }
+        };
+        if (n == 1) {
+            vector<ListaPostings> listas;
+            recorrerUltima([&listas](const ListaPosicional& lista) { listas.push_back(lista.postings); });
+            return OperacionesPostings::fusionar(listas, universo);
+        }
+
+        vector<ListaPosicional> exactas(n - 1);
+        for (size_t i = 0; i + 1 < n; ++i) {
+            if (!campo.obtenerLista(palabras[i], exactas[i])) return {};
+        }
+
+        size_t masRara = 0;
+        for (size_t i = 1; i < exactas.size(); ++i) {
+            if (exactas[i].postings.df < exactas[masRara].postings.df) masRara = i;
+        }
+        vector<uint32_t> candidatos = exactas[masRara].postings.aIds();
+        for (size_t i = 0; i < exactas.size() && !candidatos.empty(); ++i) {
+            if (i != masRara) {
+                candidatos = filtrar(candidatos, {exactas[i].postings}, true, universo);
+            }
+        }
+        if (candidatos.empty()) return {};
+
+        // Posiciones donde debería estar la última palabra, por candidato (formato CSR)
+        vector<CursorPosicional> cursores(exactas.begin(), exactas.end());
+        vector<RangoIds> posiciones(n - 1);
+        vector<uint32_t> conInicio;
+        vector<uint32_t> esperadas;
+        vector<uint32_t> inicioEsperadas;
+        for (uint32_t id : candidatos) {
+            for (size_t i = 0; i + 1 < n; ++i) {
+                cursores[i].avanzarA(id, posiciones[i]);
+            }
+            const size_t antes = esperadas.size();
+            for (const uint32_t* p = posiciones[0].inicio; p != posiciones[0].fin; ++p) {
+                bool consecutivas = true;
+                for (size_t i = 1; i + 1 < n && consecutivas; ++i) {
+                    consecutivas = binary_search(posiciones[i].inicio, posiciones[i].fin,
+                                                 *p + desplazamientos[i] - desplazamientos[0]);
+                }
+                if (consecutivas) esperadas.push_back(*p + desplazamientos[n - 1] - desplazamientos[0]);
+            }
+            if (esperadas.size() > antes) {
+                conInicio.push_back(id);
+                inicioEsperadas.push_back(static_cast<uint32_t>(antes));
+            }
+        }
+        inicioEsperadas.push_back(static_cast<uint32_t>(esperadas.size()));
+        if (conInicio.empty()) return {};
+
+        // Cada palabra con el prefijo final confirma a los candidatos que la tienen en una posición esperada
+        thread_local IndiceCandidatos indice;
+        indice.preparar(conInicio, universo);
+        vector<char> confirmado(conInicio.size(), 0);
+        recorrerUltima([&](const ListaPosicional& lista) {
+            CursorPosicional cursor(lista);
+            indice.intersectar(lista.postings, [&](size_t i, uint16_t) {
+                if (confirmado[i]) return;
+                RangoIds encontradas;
+                cursor.avanzarA(conInicio[i], encontradas);
+                const RangoIds buscadas(esperadas.data() + inicioEsperadas[i], esperadas.data() + inicioEsperadas[i + 1]);
+                OperacionesPostings::intersectar(encontradas, buscadas, [&](size_t, size_t) { confirmado[i] = 1; });
+            });
+        });
+        indice.liberar();
+
+        vector<uint32_t> resultado;
+        for (size_t i = 0; i < conInicio.size(); ++i) {
+            if (confirmado[i]) resultado.push_back(conInicio[i]);
+        }
+        return resultado;
+    }
+};
+
+/**
+ * @brief Evalúa una expresión de tags (ConsultaBooleana::analizarTags) con BitmapIds
+ *
+ * Cada cláusula es la unión de los bitmaps de sus tags; las positivas se
+ * intersectan de menor a mayor cardinalidad y las negadas se restan. Una
+ * expresión sin cláusulas positivas parte del catálogo completo.
+ */
+class EvaluadorTags {
+public:
+    /**
+     * @param bitmapDe Devuelve la VistaBitmap de un tag normalizado (vacía si no existe);
+     *        las vistas deben seguir válidas hasta el final de la evaluación
+     */
+    template<typename BitmapDe>
+    static BitmapIds evaluar(const ConsultaBooleana& consulta, uint32_t universo, BitmapDe&& bitmapDe) {
+        vector<BitmapIds> positivos, negativos;
+        for (const auto& clausula : consulta.clausulas) {
+            BitmapIds conjunto;
+            for (const auto& elemento : clausula.alternativas) {
+                conjunto = BitmapIds::unir(conjunto.vista(), bitmapDe(elemento.palabras[0]));
+            }
+            (clausula.negada ? negativos : positivos).push_back(move(conjunto));
+        }
+
+        BitmapIds resultado;
+        if (positivos.empty()) {
+            resultado = BitmapIds::completo(universo);
+        } else {
+            vector<size_t> cardinalidades;
+            for (const auto& conjunto : positivos) cardinalidades.push_back(conjunto.vista().cardinalidad());
+            vector<size_t> orden(positivos.size());
+            for (size_t i = 0; i < orden.size(); ++i) orden[i] = i;
+            sort(orden.begin(), orden.end(), [&](size_t a, size_t b) { return cardinalidades[a] < cardinalidades[b]; });
+
+            resultado = move(positivos[orden[0]]);
+            for (size_t i = 1; i < orden.size() && !resultado.contenedores.empty(); ++i) {
+                resultado = BitmapIds::interseccion(resultado.vista(), positivos[orden[i]].vista());
+            }
+        }
+        for (const auto& negado : negativos) {
+            if (resultado.contenedores.empty()) break;
+            resultado = BitmapIds::diferencia(resultado.vista(), negado.vista());
+        }
+        return resultado;
+    }
+};
+
+/**
+ * @brief Archivo de solo lectura proyectado en memoria (mmap o MapViewOfFile)
+ *
+ * El contenido queda accesible como un único string_view sin copiarlo al heap;
+ * las páginas las carga el sistema operativo a medida que se leen.
+ */
+class ArchivoMapeado {
+private:
+    const char* datos = nullptr;
+    size_t tamano = 0;
+#ifdef _WIN32
+    HANDLE archivo = INVALID_HANDLE_VALUE;
+    HANDLE mapeo = nullptr;
+#endif
+
+public:
+    /**
+     * @param secuencial Si es true se anuncia una lectura de principio a fin (CSV);
+     *        si no, accesos dispersos que deben quedar residentes (imagen del índice)
+     */
+    explicit ArchivoMapeado(const string& ruta, bool secuencial = true) {
+#ifdef _WIN32
+        archivo = CreateFileA(ruta.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING,
+                              secuencial ? FILE_FLAG_SEQUENTIAL_SCAN : FILE_FLAG_RANDOM_ACCESS, nullptr);
+        if (archivo == INVALID_HANDLE_VALUE) {
+            throw runtime_error("No se puede abrir el archivo: " + ruta);
+        }
+        LARGE_INTEGER bytes;
+        GetFileSizeEx(archivo, &bytes);
+        tamano = static_cast<size_t>(bytes.QuadPart);
+        if (tamano > 0) {
+            mapeo = CreateFileMappingA(archivo, nullptr, PAGE_READONLY, 0, 0, nullptr);
+            const void* vista = mapeo ? MapViewOfFile(mapeo, FILE_MAP_READ, 0, 0, 0) : nullptr;
+            if (!vista) {
+                cerrar();
+                throw runtime_error("No se puede mapear el archivo: " + ruta);
+            }
+            datos = static_cast<const char*>(vista);
+        }
+#else
+        const int descriptor = open(ruta.c_str(), O_RDONLY);
+        if (descriptor < 0) {
+            throw runtime_error("No se puede abrir el archivo: " + ruta);
+        }
+        struct stat info;
+        if (fstat(descriptor, &info) != 0) {
+            close(descriptor);
+            throw runtime_error("No se puede leer el tamaño de: " + ruta);
+        }
+        tamano = static_cast<size_t>(info.st_size);
+        if (tamano > 0) {
+            void* vista = mmap(nullptr, tamano, PROT_READ, MAP_PRIVATE, descriptor, 0);
+            if (vista == MAP_FAILED) {
+                close(descriptor);
+                throw runtime_error("No se puede mapear el archivo: " + ruta);
+            }
+            madvise(vista, tamano, secuencial ? MADV_SEQUENTIAL : MADV_WILLNEED);
+            datos = static_cast<const char*>(vista);
+        }
+        close(descriptor); // El mapeo sigue válido sin el descriptor
+#endif
+    }
+
+    ~ArchivoMapeado() {
+        cerrar();
+    }
+
+    ArchivoMapeado(const ArchivoMapeado&) = delete;
+    ArchivoMapeado& operator=(const ArchivoMapeado&) = delete;
+
+    string_view contenido() const {
+        return string_view(datos, tamano);
+    }
+
+private:
+    void cerrar() {
+#ifdef _WIN32
+        if (datos) UnmapViewOfFile(datos);
+        if (mapeo) CloseHandle(mapeo);
+        if (archivo != INVALID_HANDLE_VALUE) CloseHandle(archivo);
+        mapeo = nullptr;
+        archivo = INVALID_HANDLE_VALUE;
+#else
+        if (datos) munmap(const_cast<char*>(datos), tamano);
+#endif
+        datos = nullptr;
+    }
+};
+
+/**
+ * @brief Arena de texto: bloques grandes que nunca se mueven ni se liberan por separado
+ *
+ * Guarda los campos que no pueden ser vistas directas al archivo (comillas
+ * escapadas, tags con mayúsculas). Los string_view que devuelve son válidos
+ * mientras viva la arena.
+ */
+class ArenaTexto {
+private:
+    static constexpr size_t TAMANO_BLOQUE = 64 * 1024;
+
+    vector<unique_ptr<char[]>> bloques;
+    size_t usado = TAMANO_BLOQUE; // Bytes ocupados del último bloque
+
+public:
+    char* reservar(size_t bytes) {
+        if (bytes > TAMANO_BLOQUE / 4) {
+            // Bloque propio, insertado antes del actual para no desperdiciar su espacio libre
+            auto bloque = make_unique<char[]>(bytes);
+            char* inicio = bloque.get();
+            bloques.insert(bloques.empty() ? bloques.end() : bloques.end() - 1, move(bloque));
+            return inicio;
+        }
+        if (usado + bytes > TAMANO_BLOQUE) {
+            bloques.push_back(make_unique<char[]>(TAMANO_BLOQUE));
+            usado = 0;
+        }
+        char* inicio = bloques.back().get() + usado;
+        usado += bytes;
+        return inicio;
+    }
+
+    string_view guardar(string_view texto) {
+        char* destino = reservar(texto.size());
+        copy(texto.begin(), texto.end(), destino);
+        return string_view(destino, texto.size());
+    }
+};
+
+/**
+ * @brief Lector de CSV separado por ';' sobre un buffer en memoria, sin copias por campo
+ *
+ * Los campos son string_view sobre el buffer; solo se copian a la arena los que
+ * cambian al normalizarse. Admite campos entre comillas (con "" como comilla
+ * literal, ';' y saltos de línea adentro) y finales de línea LF o CRLF.
+ */
+class LectorCSV {
+public:
+    static constexpr size_t CAMPOS_POR_REGISTRO = 5; // titulo;sinopsis;tags;split;fuente
+
+    /**
+     * @brief Primer byte igual a a, b o c en [p, fin), o fin
+     *
+     * Con SSE2 compara 16 bytes por instrucción y usa la máscara de coincidencias
+     * para saltar directo al primero; el resto se recorre byte a byte.
+     */
+    static const char* buscar(const char* p, const char* fin, char a, char b, char c) {
+#if defined(__SSE2__) || defined(_M_X64)
+        const __m128i va = _mm_set1_epi8(a);
+        const __m128i vb = _mm_set1_epi8(b);
+        const __m128i vc = _mm_set1_epi8(c);
+        while (fin - p >= 16) {
+            const __m128i bloque = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p));
+            const __m128i iguales = _mm_or_si128(_mm_or_si128(_mm_cmpeq_epi8(bloque, va), _mm_cmpeq_epi8(bloque, vb)),
+                                                 _mm_cmpeq_epi8(bloque, vc));
+            const int mascara = _mm_movemask_epi8(iguales);
+            if (mascara != 0) {
+                return p + __builtin_ctz(static_cast<unsigned>(mascara));
+            }
+            p += 16;
+        }
+#endif
+        for (; p < fin; ++p) {
+            if (*p == a || *p == b || *p == c) return p;
+        }
+        return fin;
+    }
+
+    /**
+     * @brief Lee todas las películas del buffer, saltando la cabecera y las líneas vacías
+     */
+    static RegistrosCSV leer(string_view texto, ArenaTexto& arena) {
+        bool alineado;
+        return leerRango(inicioDatos(texto), texto.data() + texto.size(), arena, alineado);
+    }
+
+    /**
+     * @brief Primer byte después del BOM y de la cabecera
+     */
+    static const char* inicioDatos(string_view texto) {
+        const char* p = texto.data();
+        if (texto.substr(0, 3) == "\xEF\xBB\xBF") p += 3; // BOM de UTF-8
+        ArenaTexto descartada;
+        array<string_view, CAMPOS_POR_REGISTRO> campos;
+        leerRegistro(p, texto.data() + texto.size(), campos, descartada);
+        return p;
+    }
+
+    /**
+     * @brief Divide [inicio, fin) en 'partes' rangos que empiezan en un inicio de registro
+     *
+     * Un salto de línea solo separa registros si está fuera de comillas. Una tarea
+     * del grupo de hilos cuenta las comillas de cada rango crudo; con la paridad acumulada se sabe si el
+     * inicio de cada rango cae dentro de un campo entre comillas, y desde ahí se
+     * avanza hasta el primer salto de línea real. Las comillas escapadas ("") no
+     * cambian la paridad.
+     *
+     * @return partes + 1 límites; el rango k es [limites[k], limites[k + 1])
+     */
+    static vector<const char*> dividir(const char* inicio, const char* fin, size_t partes, GrupoHilos& grupoHilos) {
+        const size_t bytes = static_cast<size_t>(fin - inicio);
+        vector<const char*> crudos(partes + 1);
+        for (size_t k = 0; k <= partes; ++k) {
+            crudos[k] = inicio + k * bytes / partes;
+        }
+
+        vector<future<size_t>> comillas; // El último rango no hace falta
+        for (size_t k = 0; k + 1 < partes; ++k) {
+            comillas.push_back(grupoHilos.enviar([&crudos, k]() {
+                return contar(crudos[k], crudos[k + 1], '"');
+            }));
+        }
+
+        vector<const char*> limites(partes + 1);
+        limites[0] = inicio;
+        limites[partes] = fin;
+        bool dentroDeComillas = false;
+        for (size_t k = 1; k < partes; ++k) {
+            dentroDeComillas ^= (grupoHilos.esperar(comillas[k - 1]) & 1) != 0;
+            bool dentro = dentroDeComillas;
+            const char* p = crudos[k];
+            while (p < fin) {
+                const char* q = buscar(p, fin, '"', '\n', '\n');
+                if (q == fin) {
+                    p = fin;
+                } else {
+                    p = q + 1;
+                    if (*q == '"') {
+                        dentro = !dentro;
+                        continue;
+                    }
+                    if (dentro) continue;
+                }
+                break;
+            }
+            limites[k] = max(p, limites[k - 1]);
+        }
+        return limites;
+    }
+
+    /**
+     * @brief Lee los registros de [inicio, fin), que debe empezar en un inicio de registro
+     *
+     * @param alineado Queda en false si el último registro no terminó en un salto de
+     *        línea antes de 'fin' (por ejemplo, si 'fin' cayó dentro de comillas).
+     *        Entonces el siguiente rango no empieza donde lo haría una lectura secuencial.
+     */
+    static RegistrosCSV leerRango(const char* inicio, const char* fin, ArenaTexto& arena, bool& alineado) {
+        const char* p = inicio;
+        array<string_view, CAMPOS_POR_REGISTRO> campos;
+        bool comillaAbierta = false;
+
+        RegistrosCSV registros;
+        while (p < fin) {
+            if (leerRegistro(p, fin, campos, arena, &comillaAbierta) == 1 && campos[0].empty()) {
+                continue; // Línea vacía
+            }
+            RegistroPelicula pelicula;
+            pelicula.titulo = recortar(campos[0]);
+            pelicula.sinopsis = recortar(campos[1]);
+            pelicula.primerTag = static_cast<uint32_t>(registros.tags.size());
+            leerTags(campos[2], arena, registros.tags);
+            pelicula.cantidadTags = static_cast<uint32_t>(registros.tags.size()) - pelicula.primerTag;
+            pelicula.split = campos[3];
+            pelicula.fuente_sinopsis = campos[4];
+            registros.peliculas.push_back(pelicula);
+        }
+        alineado = !comillaAbierta && (p == inicio || p[-1] == '\n');
+        return registros;
+    }
+
+    /**
+     * @brief Cantidad de bytes iguales a 'c' en [p, fin)
+     */
+    static size_t contar(const char* p, const char* fin, char c) {
+        size_t total = 0;
+#if defined(__SSE2__) || defined(_M_X64)
+        const __m128i vc = _mm_set1_epi8(c);
+        while (fin - p >= 16) {
+            const __m128i bloque = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p));
+            total += static_cast<size_t>(__builtin_popcount(
+                static_cast<unsigned>(_mm_movemask_epi8(_mm_cmpeq_epi8(bloque, vc)))));
+            p += 16;
+        }
+#endif
+        for (; p < fin; ++p) {
+            total += (*p == c);
+        }
+        return total;
+    }
+
+    static string_view recortar(string_view texto) {
+        size_t inicio = 0;
+        size_t fin = texto.size();
+        while (inicio < fin && isspace(static_cast<unsigned char>(texto[inicio]))) ++inicio;
+        while (fin > inicio && isspace(static_cast<unsigned char>(texto[fin - 1]))) --fin;
+        return texto.substr(inicio, fin - inicio);
+    }
+
+private:
+    /**
+     * @brief Lee un registro completo y deja 'p' al inicio del siguiente
+     *
+     * Los campos que faltan quedan vacíos y los sobrantes se descartan.
+     * @param comillaAbierta Si no es nulo, queda en true si un campo entre comillas
+     *        llegó a 'fin' sin cerrarse
+     * @return Número de campos encontrados en el registro
+     */
+    static size_t leerRegistro(const char*& p, const char* fin, array<string_view, CAMPOS_POR_REGISTRO>& campos,
+                               ArenaTexto& arena, bool* comillaAbierta = nullptr) {
+        campos.fill(string_view());
+        size_t cantidad = 0;
+        bool finRegistro = false;
+        while (!finRegistro) {
+            string_view campo = leerCampo(p, fin, arena, finRegistro, comillaAbierta);
+            if (cantidad < CAMPOS_POR_REGISTRO) campos[cantidad] = campo;
+            ++cantidad;
+        }
+        return cantidad;
+    }
+
+    static string_view leerCampo(const char*& p, const char* fin, ArenaTexto& arena, bool& finRegistro,
+                                 bool* comillaAbierta) {
+        string_view campo;
+        if (p < fin && *p == '"') {
+            const char* inicio = ++p;
+            bool conEscapes = false;
+            const char* cierre = buscar(p, fin, '"', '"', '"');
+            while (fin - cierre > 1 && cierre[1] == '"') {
+                conEscapes = true;
+                cierre = buscar(cierre + 2, fin, '"', '"', '"');
+            }
+            campo = string_view(inicio, static_cast<size_t>(cierre - inicio));
+            if (conEscapes) campo = quitarEscapes(campo, arena);
+            if (cierre == fin && comillaAbierta) *comillaAbierta = true;
+            // Sin comilla de cierre el campo llega hasta el final; el texto tras ella se ignora
+            p = buscar(cierre == fin ? fin : cierre + 1, fin, ';', '\n', '\r');
+        } else {
+            const char* delimitador = buscar(p, fin, ';', '\n', '\r');
+            campo = string_view(p, static_cast<size_t>(delimitador - p));
+            p = delimitador;
+        }
+
+        if (p == fin) {
+            finRegistro = true;
+        } else if (*p == ';') {
+            ++p;
+        } else {
+            if (*p == '\r' && p + 1 < fin && p[1] == '\n') ++p;
+            ++p;
+            finRegistro = true;
+        }
+        return campo;
+    }
+
+    static string_view quitarEscapes(string_view campo, ArenaTexto& arena) {
+        char* destino = arena.reservar(campo.size());
+        size_t largo = 0;
+        for (size_t i = 0; i < campo.size(); ++i) {
+            destino[largo++] = campo[i];
+            if (campo[i] == '"' && i + 1 < campo.size() && campo[i + 1] == '"') ++i;
+        }
+        return string_view(destino, largo);
+    }
+
+    /**
+     * @brief Separa los tags por ',', los normaliza (recortados, en minúsculas y sin
+     *        acentos; ver NormalizadorTexto::normalizarTag) y los agrega a 'tags'
+     *
+     * Un tag que ya está normalizado se guarda como vista al buffer; solo los
+     * demás se copian a la arena.
+     */
+    static void leerTags(string_view campo, ArenaTexto& arena, vector<string_view>& tags) {
+        if (campo.empty()) return;
+        const char* p = campo.data();
+        const char* fin = p + campo.size();
+        while (true) {
+            const char* coma = buscar(p, fin, ',', ',', ',');
+            string_view tag = recortar(string_view(p, static_cast<size_t>(coma - p)));
+            if (!tag.empty()) {
+                if (!NormalizadorTexto::esTagNormalizado(tag)) {
+                    thread_local string normalizado;
+                    NormalizadorTexto::normalizarTag(tag, normalizado);
+                    char* destino = arena.reservar(normalizado.size());
+                    memcpy(destino, normalizado.data(), normalizado.size());
+                    tag = string_view(destino, normalizado.size());
+                }
+                tags.push_back(tag);
+            }
+            if (coma == fin) break;
+            p = coma + 1;
+        }
+    }
+};
+
+/**
+ * @brief Rango del CSV que un hilo analiza e indexa durante la carga
+ *
+ * Las películas se numeran desde 0 dentro del fragmento; primerId es el ID global
+ * de la primera, conocido cuando terminan de analizarse los rangos anteriores.
+ */
+struct FragmentoCarga {
+    RegistrosCSV registros;
+    ArenaTexto arena;
+    EstadisticasDocumentos estadisticas;
+    FragmentoIndice indices;
+    size_t primerId = 0;
+    size_t aparicionesOmitidas = 0; // Palabras vacías de las sinopsis que no se indexaron
+    bool alineado = true;
+};
+
+/**
+ * @brief Caché concurrente de resultados de búsqueda con admisión TinyLFU
+ *
+ * Está dividida en FRAGMENTOS independientes, cada uno con su lock, su lista
+ * LRU y su parte del límite de memoria, así que las consultas que caen en
+ * fragmentos distintos no compiten. Un bosquejo count-min cuenta cuántas veces
+ * se pidió cada clave, aciertos y fallos. Cuando una entrada nueva no entra sin
+ * desalojar, solo se admite si se pidió más veces que la víctima LRU: una
+ * consulta que aparece una sola vez no desplaza a las frecuentes. Los contadores
+ * se reducen a la mitad periódicamente para que la popularidad vieja se olvide.
+ *
+ * Cada entrada guarda la generación del índice con la que se calculó; una
+ * entrada de otra generación cuenta como fallo y se descarta.
+ */
+class CacheResultados {
+public:
+    static constexpr size_t BYTES_DEFECTO = 16 * 1024 * 1024;
+    static constexpr size_t FRAGMENTOS = 16;
+
+    struct Metricas {
+        size_t aciertos = 0;
+        size_t fallos = 0;
+        size_t admitidas = 0;
+        size_t rechazadas = 0;     // No superaron en frecuencia a la víctima LRU
+        size_t desalojadas = 0;
+        size_t invalidadas = 0;    // De una generación anterior del índice
+        size_t entradas = 0;
+        size_t bytes = 0;
+    };
+
+private:
+    /**
+     * @brief Bosquejo count-min de 4 filas con contadores de 8 bits que se envejecen
+     */
+    class BosquejoFrecuencias {
+    private:
+        static constexpr size_t FILAS = 4;
+        vector<uint8_t> contadores;
+        size_t mascara = 0;
+        size_t incrementos = 0;
+
+        size_t posicion(uint64_t hash, size_t fila) const {
+            const uint64_t mezcla = (hash + fila * 0x9E3779B97F4A7C15ULL) * 0xBF58476D1CE4E5B9ULL;
+            return fila * (mascara + 1) + ((mezcla >> 32) & mascara);
+        }
+
+    public:
+        void preparar(size_t ancho) {
+            size_t potencia = 64;
+            while (potencia < ancho) potencia *= 2;
+            mascara = potencia - 1;
+            contadores.assign(FILAS * potencia, 0);
+            incrementos = 0;
+        }
+
+        void registrar(uint64_t hash) {
+            for (size_t f = 0; f < FILAS; ++f) {
+                uint8_t& contador = contadores[posicion(hash, f)];
+                if (contador < numeric_limits<uint8_t>::max()) ++contador;
+            }
+            // Envejecimiento: tras 10 × ancho registros, todos los contadores a la mitad
+            if (++incrementos >= 10 * (mascara + 1)) {
+                for (uint8_t& contador : contadores) contador >>= 1;
+                incrementos /= 2;
+            }
+        }
+
+        uint32_t estimar(uint64_t hash) const {
+            uint32_t minimo = numeric_limits<uint8_t>::max();
+            for (size_t f = 0; f < FILAS; ++f) {
+                minimo = min<uint32_t>(minimo, contadores[posicion(hash, f)]);
+            }
+            return minimo;
+        }
+    };
+
+    struct Entrada {
+        string clave;
+        uint64_t hash = 0;
+        uint64_t generacion = 0;
+        ResultadosBusqueda resultados;
+        size_t bytes = 0;
+    };
+
+    struct Fragmento {
+        mutex fragmento_mutex;
+        list<Entrada> lru; // Al frente la usada más recientemente
+        unordered_map<string_view, list<Entrada>::iterator> entradas; // Claves: vistas sobre Entrada::clave
+        BosquejoFrecuencias frecuencias;
+        size_t bytes = 0;
+    };
+
+    array<Fragmento, FRAGMENTOS> fragmentos;
+    size_t capacidadFragmento = 0;
+    mutable atomic<size_t> aciertos{0}, fallos{0}, admitidas{0}, rechazadas{0}, desalojadas{0}, invalidadas{0};
+
+public:
+    /**
+     * @param capacidadBytes Límite aproximado de memoria (claves, resultados y nodos); 0 desactiva la caché
+     */
+    explicit CacheResultados(size_t capacidadBytes = BYTES_DEFECTO) {
+        configurar(capacidadBytes);
+    }
+
+    /**
+     * @brief Vacía la caché y cambia su límite de memoria; no debe haber consultas en curso
+     */
+    void configurar(size_t capacidadBytes) {
+        capacidadFragmento = capacidadBytes / FRAGMENTOS;
+        for (auto& fragmento : fragmentos) {
+            fragmento.lru.clear();
+            fragmento.entradas.clear();
+            fragmento.bytes = 0;
+            // Un contador por cada ~256 bytes de capacidad: varias veces las entradas que caben
+            fragmento.frecuencias.preparar(capacidadFragmento / 256);
+        }
+    }
+
+    bool activa() const {
+        return capacidadFragmento > 0;
+    }
+
+    /**
+     * @brief Copia en 'resultados' la entrada de la clave si es de esta generación
+     */
+    bool buscar(const string& clave, uint64_t generacion, ResultadosBusqueda& resultados) {
+        if (!activa()) return false;
+        const uint64_t hashClave = hash<string>{}(clave);
+        Fragmento& fragmento = fragmentos[hashClave % FRAGMENTOS];
+        lock_guard<mutex> lock(fragmento.fragmento_mutex);
+        fragmento.frecuencias.registrar(hashClave);
+
+        auto it = fragmento.entradas.find(clave);
+        if (it == fragmento.entradas.end()) {
+            fallos.fetch_add(1, memory_order_relaxed);
+            return false;
+        }
+        if (it->second->generacion != generacion) {
+            eliminar(fragmento, it->second);
+            invalidadas.fetch_add(1, memory_order_relaxed);
+            fallos.fetch_add(1, memory_order_relaxed);
+            return false;
+        }
+        fragmento.lru.splice(fragmento.lru.begin(), fragmento.lru, it->second);
+        resultados = it->second->resultados;
+        aciertos.fetch_add(1, memory_order_relaxed);
+        return true;
+    }
+
+    /**
+     * @brief Guarda los resultados de la clave si TinyLFU los admite
+     */
+    void guardar(const string& clave, uint64_t generacion, const ResultadosBusqueda& resultados) {
+        if (!activa()) return;
+        const size_t bytes = sizeof(Entrada) + 2 * clave.size() + resultados.size() * sizeof(ResultadoBusqueda) + 64;
+        // Una entrada que ocupa más de 1/8 del fragmento desalojaría demasiadas
+        if (bytes > capacidadFragmento / 8) {
+            rechazadas.fetch_add(1, memory_order_relaxed);
+            return;
+        }
+        const uint64_t hashClave = hash<string>{}(clave);
+        Fragmento& fragmento = fragmentos[hashClave % FRAGMENTOS];
+        lock_guard<mutex> lock(fragmento.fragmento_mutex);
+
+        auto existente = fragmento.entradas.find(clave);
+        if (existente != fragmento.entradas.end()) {
+            eliminar(fragmento, existente->second);
+        }
+        if (fragmento.bytes + bytes > capacidadFragmento) {
+            const uint32_t frecuencia = fragmento.frecuencias.estimar(hashClave);
+            if (frecuencia <= fragmento.frecuencias.estimar(fragmento.lru.back().hash)) {
+                rechazadas.fetch_add(1, memory_order_relaxed);
+                return;
+            }
+            while (fragmento.bytes + bytes > capacidadFragmento) {
+                eliminar(fragmento, prev(fragmento.lru.end()));
+                desalojadas.fetch_add(1, memory_order_relaxed);
+            }
+        }
+
+        fragmento.lru.push_front({clave, hashClave, generacion, resultados, bytes});
+        fragmento.entradas.emplace(fragmento.lru.front().clave, fragmento.lru.begin());
+        fragmento.bytes += bytes;
+        admitidas.fetch_add(1, memory_order_relaxed);
+    }
+
+    Metricas metricas() {
+        Metricas m;
+        m.aciertos = aciertos.load(memory_order_relaxed);
+        m.fallos = fallos.load(memory_order_relaxed);
+        m.admitidas = admitidas.load(memory_order_relaxed);
+        m.rechazadas = rechazadas.load(memory_order_relaxed);
+        m.desalojadas = desalojadas.load(memory_order_relaxed);
+        m.invalidadas = invalidadas.load(memory_order_relaxed);
+        for (auto& fragmento : fragmentos) {
+            lock_guard<mutex> lock(fragmento.fragmento_mutex);
+            m.entradas += fragmento.entradas.size();
+            m.bytes += fragmento.bytes;
+        }
+        return m;
+    }
+
+private:
+    static void eliminar(Fragmento& fragmento, list<Entrada>::iterator entrada) {
+        fragmento.bytes -= entrada->bytes;
+        fragmento.entradas.erase(entrada->clave);
+        fragmento.lru.erase(entrada);
+    }
+};
+
+/**
+ * @brief Resultados de GestorPeliculas::buscarLote en un solo arreglo
+ *
+ * Los de la consulta i ocupan [inicio[i], inicio[i + 1]) de 'resultados'.
+ * Reutilizar el mismo objeto en lotes sucesivos reutiliza también su memoria.
+ */
+struct ResultadosLote {
+    vector<ResultadoBusqueda> resultados;
+    vector<size_t> inicio{0};
+
+    size_t size() const {
+        return inicio.size() - 1;
+    }
+
+    Vista<ResultadoBusqueda> operator[](size_t i) const {
+        return Vista<ResultadoBusqueda>(resultados.data() + inicio[i], inicio[i + 1] - inicio[i]);
+    }
+};
+
+/**
+ * @brief Película a agregar o reemplazar en el catálogo (ver GestorPeliculas::agregarPelicula)
+ */
+struct DatosPelicula {
+    string titulo;
+    string sinopsis;
+    vector<string> tags; // Se normalizan como los del CSV
+    string split;
+    string fuente_sinopsis;
+};
+
+/**
+ * @brief Clase principal para gestión de películas
+ */
+class GestorPeliculas {
+private:
+    // Indexación, fan-out de las consultas y vecinos precalculados; se destruye el último
+    mutable GrupoHilos grupoHilos;
+
+    // CSV mapeado: solo se conserva durante la carga, el catálogo copia su texto
+    unique_ptr<ArchivoMapeado> archivo;
+    // Imagen del índice: si se arrancó desde ella, catálogo e índices apuntan a su contenido
+    unique_ptr<ArchivoMapeado> imagen;
+
+    CatalogoPeliculas catalogo;
+    TrieCompacto indiceTitulos;
+    TrieCompacto indiceSinopsis;
+    IndiceGenerico<uint32_t, IdTag> indiceTags;
+    // Solo con Tries mutables; con índices congelados vive en la instantánea publicada
+    IndiceSimilitud similitudMutable;
+    size_t vecinosPrecalculados = 0;
+
+    VocabularioSinopsis vocabulario;
+    PalabrasIgnoradas palabrasVacias; // Normalizadas: se buscan por string_view al indexar
+    // Palabras vacías y podadas: las consultas no las exigen en las sinopsis
+    PalabrasIgnoradas palabrasIgnoradas;
+
+    // Los lectores cargan este puntero sin locks, dentro de una guardia de 'epocas';
+    // 'publicada' es su dueña y una instantánea reemplazada se libera cuando
+    // terminan las lecturas que podían verla
+    atomic<const IndicesPublicados*> publicados{nullptr};
+    unique_ptr<const IndicesPublicados> publicada;
+    mutable EpocasLectura epocas;
+    mutex publicacion_mutex;
+
+    // Actualizaciones incrementales (solo con índices congelados): las películas
+    // agregadas desde que se selló el último segmento se indexan en estos índices
+    // pequeños, que se congelan como delta de cada instantánea
+    mutex actualizacion_mutex;
+    TrieCompacto deltaTitulos;
+    TrieCompacto deltaSinopsis;
+    IndiceGenerico<uint32_t, IdTag> deltaTags;
+    PoliticaSegmentos politica;
+    // El compactador corre en su propio hilo: como tarea del grupo ocuparía un hilo
+    // de las consultas durante toda una fusión
+    thread hiloCompactador;
+    atomic<bool> compactacionEnCurso{false};
+    bool fusionTotalPedida = false; // compactarAhora con un compactador en curso; protegido por actualizacion_mutex
+
+    // Sube con cada instantánea publicada; las entradas de la caché de otra generación se descartan
+    atomic<uint64_t> generacion{0};
+    mutable CacheResultados cache;
+
+    MetricasArranque metricas;
+    EstadisticasDocumentos estadisticas;
+
+    // Por debajo de este tamaño un rango más no compensa el hilo
+    static constexpr size_t BYTES_MINIMOS_POR_FRAGMENTO = 64 * 1024;
+    // Por debajo de estas postings puntuar los dos campos en el mismo hilo es más
+    // rápido que despertar a otro (del orden de 10 μs)
+    static constexpr size_t POSTINGS_MINIMAS_PARALELO = 16 * 1024;
+    // buscarLote lee cada tramo de consultas distintas en una sola instantánea: una
+    // guardia más larga solo demora liberar las instantáneas que se retiran mientras tanto
+    static constexpr size_t CONSULTAS_POR_TRAMO = 4096;
+
+public:
+    // Nodos que puede visitar la parte difusa de una búsqueda (ver buscarDifusa)
+    static constexpr size_t PRESUPUESTO_NODOS_DIFUSO = 20000;
+
+    /**
+     * @param mantenerTrieMutable Si es true se conservan los Tries mutables (para
+     *        inserciones incrementales) en lugar de congelarlos en arreglos planos
+     * @param numHilos Hilos del grupo de indexación y consultas (0 = hardware_concurrency())
+     * @param usarImagen Si es true se arranca desde la imagen binaria del índice
+     *        (<csv>.idx) cuando corresponde al CSV, y se escribe una nueva si no
+     * @param vecinosPrecalculados Películas similares a guardar por película al
+     *        indexar (0 = buscarlas en el índice LSH en cada consulta)
+     * @param vocabulario Palabras vacías y poda por frecuencia del índice de sinopsis
+     */
+    GestorPeliculas(const string& nombreArchivo, bool mantenerTrieMutable = false, size_t numHilos = 0,
+                    bool usarImagen = true, size_t vecinosPrecalculados = 0,
+                    VocabularioSinopsis vocabulario = VocabularioSinopsis())
+        : grupoHilos(numHilos), vecinosPrecalculados(vecinosPrecalculados), vocabulario(move(vocabulario)) {
+        vector<string> vacias;
+        for (const auto& palabra : this->vocabulario.palabrasVacias) {
+            vacias.push_back(NormalizadorTexto::normalizar(palabra));
+        }
+        palabrasVacias = PalabrasIgnoradas::construir(move(vacias));
+        auto inicio = chrono::high_resolution_clock::now();
+
+        const string rutaCsv = localizarArchivo(nombreArchivo);
+        const string rutaImagen = rutaCsv + ".idx";
+        // La imagen solo guarda los índices congelados
+        usarImagen = usarImagen && !mantenerTrieMutable;
+        if (usarImagen && cargarImagen(rutaCsv, rutaImagen)) {
+            auto fin = chrono::high_resolution_clock::now();
+            metricas.desdeImagen = true;
+            metricas.cargaMs = chrono::duration_cast<chrono::milliseconds>(fin - inicio).count();
+            cout << "Base de datos cargada desde la imagen del índice: " << catalogo.size()
+                 << " películas en " << metricas.cargaMs << " ms" << endl;
+            return;
+        }
+
+        cout << "Cargando e indexando películas..." << endl;
+        chrono::high_resolution_clock::time_point finCarga;
+        cargarEIndexar(rutaCsv, grupoHilos.size(), finCarga);
+        auto finIndexacion = chrono::high_resolution_clock::now();
+
+        if (!mantenerTrieMutable) {
+            congelarIndices();
+        } else {
+            similitudMutable = IndiceSimilitud::construir(indiceSinopsis, catalogo.size(), vecinosPrecalculados,
+                                                          grupoHilos);
+        }
+
+        auto fin = chrono::high_resolution_clock::now();
+        metricas.cargaMs = chrono::duration_cast<chrono::milliseconds>(finCarga - inicio).count();
+        metricas.indexacionMs = chrono::duration_cast<chrono::milliseconds>(finIndexacion - finCarga).count();
+        metricas.congelacionMs = chrono::duration_cast<chrono::milliseconds>(fin - finIndexacion).count();
+        auto duracion = chrono::duration_cast<chrono::milliseconds>(fin - inicio);
+
+        cout << "Base de datos cargada: " << catalogo.size() << " películas en "
+             << duracion.count() << " ms" << endl;
+
+        if (usarImagen) {
+            guardarImagen(rutaCsv, rutaImagen);
+        }
+        archivo.reset();
+    }
+
+    ~GestorPeliculas() {
+        esperarCompactacion();
+    }
+
+    /**
+     * @brief Busca por prefijo en títulos y sinopsis y ordena por relevancia (BM25)
+     *
+     * Cada palabra del subárbol del prefijo aporta idf × tf saturada a los documentos
+     * de su posting list, así que el costo depende del tamaño de las postings y no
+     * de la longitud de las sinopsis. Las puntuaciones se calculan en el vector de
+     * resultados de la consulta, por lo que varias búsquedas pueden ejecutarse en
+     * paralelo sobre el mismo catálogo.
+     *
+     * @param filtroTags Expresión de tags que deben cumplir los resultados (ver buscarPorTags)
+     */
+    ResultadosBusqueda buscarPorTituloOSinopsis(const string& busqueda, const string& filtroTags = "") const {
+        auto inicio = chrono::high_resolution_clock::now();
+        const auto guardia = epocas.entrar();
+
+        const ConsultaBooleana consulta = ConsultaBooleana::analizar(busqueda);
+        const uint64_t generacionCache = generacion.load(memory_order_acquire);
+        const string clave = claveCache('t', consulta, filtroTags, 0, 0);
+        ResultadosBusqueda resultados;
+        if (!cache.buscar(clave, generacionCache, resultados)) {
+            resultados = puntuarTituloOSinopsis(consulta, filtroTags);
+            cache.guardar(clave, generacionCache, resultados);
+        }
+
+        auto fin = chrono::high_resolution_clock::now();
+        auto duracion = chrono::duration_cast<chrono::microseconds>(fin - inicio);
+
+        cout << "Búsqueda completada en " << duracion.count() << " μs" << endl;
+        return resultados;
+    }
+
+    /**
+     * @brief Página [offset, offset + k) del ranking BM25 de un prefijo
+     *
+     * Solo ordena los offset + k mejores y poda con cotas superiores por término
+     * (ver EvaluadorTopK), por lo que un prefijo amplio como "a" no necesita puntuar
+     * ni ordenar todos sus candidatos. Con filtroTags los documentos que no lo
+     * cumplen se descartan antes de seleccionar la página.
+     */
+    ResultadosBusqueda buscar(const string& busqueda, size_t k, size_t offset = 0,
+                              const string& filtroTags = "") const {
+        auto inicio = chrono::high_resolution_clock::now();
+        const auto guardia = epocas.entrar();
+
+        const ConsultaBooleana consulta = ConsultaBooleana::analizar(busqueda);
+        const uint64_t generacionCache = generacion.load(memory_order_acquire);
+        const string clave = claveCache('b', consulta, filtroTags, k, offset);
+        ResultadosBusqueda resultados;
+        if (!cache.buscar(clave, generacionCache, resultados)) {
+            const IndicesPublicados* indices = publicados.load(memory_order_acquire);
+            const size_t limite = min(k, numeric_limits<size_t>::max() - offset) + offset;
+            vector<uint64_t> bits;
+            const vector<uint64_t>* filtro = prepararFiltro(filtroTags, indices, bits);
+            resultados = evaluarConsulta(consulta, indices, limite, filtro);
+            resultados.erase(resultados.begin(), resultados.begin() + min(offset, resultados.size()));
+            cache.guardar(clave, generacionCache, resultados);
+        }
+
+        auto fin = chrono::high_resolution_clock::now();
+        auto duracion = chrono::duration_cast<chrono::microseconds>(fin - inicio);
+
+        cout << "Búsqueda completada en " << duracion.count() << " μs" << endl;
+        return resultados;
+    }
+
+    /**
+     * @brief Top-k de muchas consultas a la vez, repartidas entre los hilos del grupo
+     *
+     * Pensada para trabajos por lotes, donde la métrica es el rendimiento en
+     * consultas por segundo y no la latencia de cada una. No mide ni imprime nada
+     * por consulta; cada texto distinto se analiza una sola vez y los textos que
+     * quedan iguales al normalizarlos ("Batman" y "batman ") se evalúan una sola
+     * vez; el filtro de tags se prepara una vez por tramo. Los resultados se
+     * escriben en los arreglos de 'destino', que conservan su capacidad.
+     *
+     * Las consultas distintas se evalúan por tramos de CONSULTAS_POR_TRAMO, cada
+     * uno sobre la instantánea publicada al empezarlo: en un lote largo, los
+     * tramos posteriores a una actualización ya la ven. Dentro de un tramo cada
+     * palabra distinta se expande una sola vez por segmento (compartirTerminos):
+     * "batman" y "batman begins" arman sus TerminoConsulta con las mismas listas
+     * de "batman", y su unión de postings se descomprime una sola vez.
+     *
+     * @param filtroTags Expresión de tags que deben cumplir todos los resultados
+     */
+    void buscarLote(const vector<string>& consultas, size_t k, ResultadosLote& destino,
+                    const string& filtroTags = "") const {
+        // Textos distintos, analizados en paralelo
+        vector<uint32_t> textoDe(consultas.size());
+        vector<const string*> textos;
+        {
+            unordered_map<string_view, uint32_t> porTexto;
+            porTexto.reserve(consultas.size());
+            for (size_t i = 0; i < consultas.size(); ++i) {
+                auto [it, nuevo] = porTexto.try_emplace(consultas[i], static_cast<uint32_t>(textos.size()));
+                if (nuevo) textos.push_back(&consultas[i]);
+                textoDe[i] = it->second;
+            }
+        }
+        vector<ConsultaBooleana> analizadas(textos.size());
+        vector<string> claves(textos.size());
+        grupoHilos.paraCada(textos.size(), [&](size_t t) {
+            analizadas[t] = ConsultaBooleana::analizar(*textos[t]);
+            claves[t] = analizadas[t].clave();
+        });
+
+        // Consultas distintas tras normalizar
+        vector<uint32_t> unicaDe(textos.size());
+        vector<uint32_t> unicas;
+        {
+            unordered_map<string_view, uint32_t> porClave;
+            porClave.reserve(textos.size());
+            for (size_t t = 0; t < textos.size(); ++t) {
+                auto [it, nueva] = porClave.try_emplace(claves[t], static_cast<uint32_t>(unicas.size()));
+                if (nueva) unicas.push_back(static_cast<uint32_t>(t));
+                unicaDe[t] = it->second;
+            }
+        }
+
+        vector<ResultadosBusqueda> mejores(unicas.size());
+        for (size_t tramo = 0; tramo < unicas.size(); tramo += CONSULTAS_POR_TRAMO) {
+            const size_t fin = min(unicas.size(), tramo + CONSULTAS_POR_TRAMO);
+            const auto guardia = epocas.entrar();
+            const IndicesPublicados* indices = publicados.load(memory_order_acquire);
+            vector<uint64_t> bits;
+            const vector<uint64_t>* filtro = prepararFiltro(filtroTags, indices, bits);
+            const TerminosCompartidos compartidos = compartirTerminos(analizadas, unicas, tramo, fin, indices);
+            grupoHilos.paraCada(fin - tramo, [&](size_t i) {
+                mejores[tramo + i] = evaluarConsulta(analizadas[unicas[tramo + i]], indices, k, filtro, &compartidos);
+            });
+        }
+
+        destino.inicio.resize(consultas.size() + 1);
+        destino.inicio[0] = 0;
+        for (size_t i = 0; i < consultas.size(); ++i) {
+            destino.inicio[i + 1] = destino.inicio[i] + mejores[unicaDe[textoDe[i]]].size();
+        }
+        destino.resultados.resize(destino.inicio.back());
+        for (size_t i = 0; i < consultas.size(); ++i) {
+            const ResultadosBusqueda& propios = mejores[unicaDe[textoDe[i]]];
+            copy(propios.begin(), propios.end(), destino.resultados.begin() + destino.inicio[i]);
+        }
+    }
+
+    /**
+     * @brief Como buscar, pero tolera errores de tipeo en las búsquedas de una palabra
+     *
+     * Primero van las películas que coinciden con el prefijo tal cual, ordenadas por
+     * BM25; si no llenan la página siguen las que solo coinciden a distancia de
+     * edición 1, después las de distancia 2, cada grupo ordenado por su BM25 (ver
+     * TrieCongelado::recorrerDifusos). Así "batmna" o "amelie" encuentran resultados
+     * sin que el usuario tenga que reintentar, y una búsqueda bien escrita no cambia.
+     *
+     * @param maxDistancia Distancia de edición máxima; se reduce en palabras cortas
+     *        (ver distanciaAdmitida)
+     * @param presupuestoNodos Nodos de los Tries que puede visitar la parte difusa;
+     *        acota la latencia de las palabras cortas o con muchos vecinos
+     *
+     * Las consultas con operadores o varias palabras se resuelven como en buscar.
+     */
+    ResultadosBusqueda buscarDifusa(const string& busqueda, size_t k, uint32_t maxDistancia = 2, size_t offset = 0,
+                                    const string& filtroTags = "",
+                                    size_t presupuestoNodos = PRESUPUESTO_NODOS_DIFUSO) const {
+        const ConsultaBooleana consulta = ConsultaBooleana::analizar(busqueda);
+        if (!consulta.esTerminoSimple()) {
+            return buscar(busqueda, k, offset, filtroTags);
+        }
+        auto inicio = chrono::high_resolution_clock::now();
+        const auto guardia = epocas.entrar();
+
+        const uint64_t generacionCache = generacion.load(memory_order_acquire);
+        const string clave = claveCache('d', consulta, filtroTags, k, offset,
+                                        to_string(maxDistancia) + ':' + to_string(presupuestoNodos));
+        ResultadosBusqueda resultados;
+        if (!cache.buscar(clave, generacionCache, resultados)) {
+            resultados = puntuarDifusa(consulta.clausulas[0].alternativas[0].palabras[0], k, maxDistancia, offset,
+                                       filtroTags, presupuestoNodos);
+            cache.guardar(clave, generacionCache, resultados);
+        }
+
+        auto fin = chrono::high_resolution_clock::now();
+        auto duracion = chrono::duration_cast<chrono::microseconds>(fin - inicio);
+
+        cout << "Búsqueda completada en " << duracion.count() << " μs" << endl;
+        return resultados;
+    }
+
+    // FUNCIÓN CORREGIDA PARA BÚSQUEDA POR TAG
+    ResultadosBusqueda buscarPorTag(const string& tag) const {
+        auto inicio = chrono::high_resolution_clock::now();
+
+        // Normalizar el tag de búsqueda (minúsculas y sin espacios)
+        string tagNormalizado = normalizarTag(tag);
+
+        cout << "Buscando tag: '" << tagNormalizado << "'" << endl;
+
+        // Buscar en el índice usando el tag normalizado
+        const auto guardia = epocas.entrar();
+        const IndicesPublicados* indices = publicados.load(memory_order_acquire);
+        const vector<uint32_t> encontradas = idsConTag(tagNormalizado, indices);
+
+        ResultadosBusqueda resultados;
+        resultados.reserve(encontradas.size());
+        for (uint32_t id : encontradas) {
+            if (!indices || indices->vigente(id)) {
+                resultados.push_back({id, 0.0});
+            }
+        }
+
+        auto fin = chrono::high_resolution_clock::now();
+        auto duracion = chrono::duration_cast<chrono::microseconds>(fin - inicio);
+
+        cout << "Búsqueda por tag completada en " << duracion.count() << " μs" << endl;
+        cout << "Resultados encontrados: " << resultados.size() << endl;
+
+        return resultados;
+    }
+
+    /**
+     * @brief Películas cuyos tags cumplen una expresión booleana, en orden de catálogo
+     *
+     * "horror AND comedy NOT gore", "horror, comedy -gore" o "drama OR romance";
+     * las palabras entre operadores forman un tag ("science fiction"). Se evalúa con
+     * operaciones de bitmaps, así que combinar tags populares no recorre sus listas.
+     */
+    ResultadosBusqueda buscarPorTags(const string& expresion) const {
+        auto inicio = chrono::high_resolution_clock::now();
+
+        const auto guardia = epocas.entrar();
+        const IndicesPublicados* indices = publicados.load(memory_order_acquire);
+        const vector<uint32_t> encontradas = conjuntoDeTags(expresion, indices).vista().aIds();
+
+        ResultadosBusqueda resultados;
+        resultados.reserve(encontradas.size());
+        for (uint32_t id : encontradas) {
+            if (!indices || indices->vigente(id)) {
+                resultados.push_back({id, 0.0});
+            }
+        }
+
+        auto fin = chrono::high_resolution_clock::now();
+        auto duracion = chrono::duration_cast<chrono::microseconds>(fin - inicio);
+
+        cout << "Búsqueda por tags completada en " << duracion.count() << " μs" << endl;
+        cout << "Resultados encontrados: " << resultados.size() << endl;
+
+        return resultados;
+    }
+
+    /**
+     * @brief Recomienda películas que comparten tags con las que le gustaron al usuario
+     *
+     * Cada tag de las películas con like pesa (veces que aparece entre ellas) × idf,
+     * así que un tag raro compartido vale más que "drama". Los candidatos salen de
+     * recorrer los conjuntos de esos tags, sin mirar el resto del catálogo.
+     *
+     * @param gustadas IDs de las películas con like (se excluyen del resultado)
+     * @return Las k mejores, ordenadas de mayor a menor puntuación
+     *
+     * Complejidad: O(L × t + P + c log k) donde L = películas con like, t = tags por
+     * película, P = suma de los tamaños de sus tags y c = candidatos tocados
+     */
+    ResultadosBusqueda recomendar(const vector<uint32_t>& gustadas, size_t k) const {
+        const auto guardia = epocas.entrar();
+        const IndicesPublicados* indices = publicados.load(memory_order_acquire);
+        const CatalogoPeliculas& catalogo = catalogoDe(indices);
+        const EstadisticasDocumentos& estadisticas = estadisticasDe(indices);
+
+        vector<pair<IdTag, uint32_t>> apariciones; // (tag, veces entre las gustadas)
+        for (uint32_t id : gustadas) {
+            if (id >= catalogo.size()) continue;
+            for (IdTag tag : catalogo.tagsDe(id)) {
+                apariciones.emplace_back(tag, 1);
+            }
+        }
+        sort(apariciones.begin(), apariciones.end());
+        size_t distintos = 0;
+        for (size_t i = 0; i < apariciones.size(); ++i) {
+            if (distintos > 0 && apariciones[distintos - 1].first == apariciones[i].first) {
+                apariciones[distintos - 1].second++;
+            } else {
+                apariciones[distintos++] = apariciones[i];
+            }
+        }
+        apariciones.resize(distintos);
+
+        thread_local AcumuladorPuntuaciones acumulador;
+        acumulador.preparar(catalogo.size());
+        for (const auto& [tag, veces] : apariciones) {
+            if (indices) {
+                size_t cardinalidad = 0;
+                for (const auto& segmento : indices->segmentos) cardinalidad += segmento->tags.buscar(tag).cardinalidad();
+                const double peso = veces * SistemaPuntuacion::idf(cardinalidad, estadisticas.totalDocumentos);
+                for (const auto& segmento : indices->segmentos) {
+                    segmento->tags.buscar(tag).recorrer([&](uint32_t id) { acumulador.sumar(id, peso); });
+                }
+            } else {
+                const vector<uint32_t> ids = idsConTag(string(catalogo.nombreTag(tag)), nullptr);
+                const double peso = veces * SistemaPuntuacion::idf(ids.size(), estadisticas.totalDocumentos);
+                for (uint32_t id : ids) acumulador.sumar(id, peso);
+            }
+        }
+
+        vector<uint32_t> excluidas(gustadas);
+        sort(excluidas.begin(), excluidas.end());
+        ResultadosBusqueda resultados = EvaluadorTopK::mejoresDelAcumulador(acumulador, k, [&](uint32_t id) {
+            return !binary_search(excluidas.begin(), excluidas.end(), id) && (!indices || indices->vigente(id));
+        });
+        acumulador.descartar();
+        return resultados;
+    }
+
+    /**
+     * @brief Las k películas con la sinopsis más parecida a la de 'id' (ver IndiceSimilitud)
+     *
+     * Complejidad: O(k) con vecinos precalculados; si no, O(BANDAS × (log C + c × t))
+     * donde C = cubetas, c = candidatos por cubeta y t = palabras por vector
+     */
+    ResultadosBusqueda buscarSimilares(uint32_t id, size_t k) const {
+        const auto guardia = epocas.entrar();
+        const IndicesPublicados* indices = publicados.load(memory_order_acquire);
+        if (!indices) return similitudMutable.similares(id, k);
+        if (id >= indices->catalogo.size() || !indices->vigente(id)) return {};
+
+        // Las borradas siguen en el índice de similitud hasta la próxima fusión
+        for (size_t pedidas = k;; pedidas *= 2) {
+            ResultadosBusqueda resultados = indices->similitud.similares(id, pedidas);
+            const size_t encontradas = resultados.size();
+            resultados.erase(remove_if(resultados.begin(), resultados.end(), [indices](const ResultadoBusqueda& r) {
+                return !indices->vigente(r.id);
+            }), resultados.end());
+            if (resultados.size() >= k || encontradas < pedidas) {
+                resultados.resize(min(k, resultados.size()));
+                return resultados;
+            }
+        }
+    }
+
+    /**
+     * @brief Las n películas de mayor calidad estática cuyo título completa lo tipeado
+     *
+     * La última palabra de 'texto' es un prefijo y las anteriores son palabras
+     * completas del título, en cualquier orden ("lord ri" → "The Lord of the
+     * Rings"). La puntuación de cada resultado es su
+     * SistemaPuntuacion::calidadEstatica, no su relevancia.
+     *
+     * Complejidad: con una sola palabra, O(m + n) por segmento gracias a las
+     * mejores precalculadas de los Tries de títulos (TrieCongelado::mejoresConPrefijo);
+     * con varias, O(d × L) donde d = películas con la palabra completa más rara y
+     * L = largo de sus títulos
+     */
+    ResultadosBusqueda autocompletar(const string& texto, size_t n) const {
+        vector<string> palabras;
+        string buffer;
+        NormalizadorTexto::paraCadaToken(texto, buffer, [&palabras](string_view palabra) {
+            palabras.emplace_back(palabra);
+        });
+        if (palabras.empty() || n == 0) return {};
+
+        const auto guardia = epocas.entrar();
+        const IndicesPublicados* indices = publicados.load(memory_order_acquire);
+        const CatalogoPeliculas& catalogoActual = catalogoDe(indices);
+        auto calidad = [&catalogoActual](uint32_t id) {
+            return SistemaPuntuacion::calidadEstatica(catalogoActual.tagsDe(id).size(),
+                                                     catalogoActual.longitudSinopsis(id));
+        };
+        auto vigente = [indices](uint32_t id) { return !indices || indices->vigente(id); };
+
+        vector<pair<float, uint32_t>> candidatos;
+        if (palabras.size() == 1) {
+            if (!indices) {
+                for (uint32_t id : indiceTitulos.buscarPorPrefijo(palabras[0])) candidatos.emplace_back(calidad(id), id);
+            } else {
+                // Cada segmento aporta sus n mejores: las n mejores del total están entre ellas
+                for (const auto& segmento : indices->segmentos) {
+                    for (uint32_t id : segmento->titulos.mejoresConPrefijo(palabras[0], n, calidad, vigente)) {
+                        candidatos.emplace_back(calidad(id), id);
+                    }
+                }
+            }
+        } else if (!indices) {
+            completarTitulos(indiceTitulos, palabras, catalogoActual, vigente, calidad, candidatos);
+        } else {
+            for (const auto& segmento : indices->segmentos) {
+                completarTitulos(segmento->titulos, palabras, catalogoActual, vigente, calidad, candidatos);
+            }
+        }
+
+        ResultadosBusqueda resultados;
+        for (uint32_t id : TrieCongelado::mejoresPorCalidad(candidatos, n)) {
+            resultados.push_back({id, calidad(id)});
+        }
+        return resultados;
+    }
+
+    /**
+     * @brief Versión actual del catálogo; la copia es O(1) y no cambia con las actualizaciones posteriores
+     */
+    CatalogoPeliculas getCatalogo() const {
+        const auto guardia = epocas.entrar();
+        return catalogoDe(publicados.load(memory_order_acquire));
+    }
+
+    /**
+     * @brief La película es válida mientras viva el gestor, aunque después se borre o reemplace
+     */
+    Pelicula obtenerPelicula(uint32_t id) const {
+        const auto guardia = epocas.entrar();
+        return catalogoDe(publicados.load(memory_order_acquire)).obtener(id);
+    }
+
+    /**
+     * @brief false si la película fue borrada o reemplazada
+     */
+    bool peliculaVigente(uint32_t id) const {
+        const auto guardia = epocas.entrar();
+        const IndicesPublicados* indices = publicados.load(memory_order_acquire);
+        return id < catalogoDe(indices).size() && (!indices || indices->vigente(id));
+    }
+
+    /**
+     * @brief Agrega una película sin reconstruir los índices y devuelve su ID
+     *
+     * Se indexa en el delta, que se congela y publica en una instantánea nueva:
+     * las consultas siguientes ya la encuentran y las que están en curso no se
+     * bloquean. Con politica.peliculasDelta películas el delta se sella como un
+     * segmento más y el compactador decide en segundo plano si fusiona segmentos
+     * (ver configurarSegmentos). Solo con índices congelados; los cambios no se
+     * guardan en el CSV ni en la imagen.
+     *
+     * Complejidad: O(texto + delta + n / 64) más la copia de las estadísticas BM25 (O(n))
+     */
+    uint32_t agregarPelicula(const DatosPelicula& datos) {
+        return actualizar(nullptr, &datos);
+    }
+
+    /**
+     * @brief Reemplaza una película: la anterior se borra y la nueva recibe otro ID, que se devuelve
+     *
+     * Las consultas ven las dos operaciones juntas, nunca ambas versiones ni ninguna.
+     */
+    uint32_t reemplazarPelicula(uint32_t id, const DatosPelicula& datos) {
+        return actualizar(&id, &datos);
+    }
+
+    /**
+     * @brief Borra una película; sus IDs no se reutilizan
+     *
+     * Queda marcada como borrada (las consultas la descartan) hasta que el
+     * compactador reescribe su segmento.
+     */
+    void eliminarPelicula(uint32_t id) {
+        actualizar(&id, nullptr);
+    }
+
+    void configurarSegmentos(const PoliticaSegmentos& nueva) {
+        lock_guard<mutex> lock(actualizacion_mutex);
+        politica = nueva;
+    }
+
+    /**
+     * @brief Sella el delta, fusiona todos los segmentos en uno y reconstruye la similitud
+     *
+     * Ignora la política (incluido maxPeliculasSegmento) y espera a que termine.
+     */
+    void compactarAhora() {
+        esperarCompactacion();
+        {
+            lock_guard<mutex> lock(actualizacion_mutex);
+            sellarDelta();
+            if (publicada) iniciarCompactacion(true);
+        }
+        esperarCompactacion();
+    }
+
+    /**
+     * @brief Espera a que termine la compactación en segundo plano, si hay una en curso
+     */
+    void esperarCompactacion() {
+        thread hilo;
+        {
+            lock_guard<mutex> lock(actualizacion_mutex);
+            hilo = move(hiloCompactador);
+        }
+        if (hilo.joinable()) hilo.join();
+    }
+
+    /**
+     * @brief Cantidad de segmentos publicados, contando el delta
+     */
+    size_t cantidadSegmentos() const {
+        const auto guardia = epocas.entrar();
+        const IndicesPublicados* indices = publicados.load(memory_order_acquire);
+        return indices ? indices->segmentos.size() : 0;
+    }
+
+    const MetricasArranque& obtenerMetricasArranque() const {
+        return metricas;
+    }
+
+    /**
+     * @brief Cambia el límite de memoria de la caché de resultados (0 la desactiva) y la vacía
+     *
+     * Debe llamarse antes de empezar a consultar.
+     */
+    void configurarCache(size_t capacidadBytes) {
+        cache.configurar(capacidadBytes);
+    }
+
+    CacheResultados::Metricas obtenerMetricasCache() const {
+        return cache.metricas();
+    }
+
+    size_t memoriaPostingsSinopsis() const {
+        const auto guardia = epocas.entrar();
+        const IndicesPublicados* indices = publicados.load(memory_order_acquire);
+        if (!indices) return indiceSinopsis.memoriaPostings();
+        size_t bytes = 0;
+        for (const auto& segmento : indices->segmentos) bytes += segmento->sinopsis.memoriaPostings();
+        return bytes;
+    }
+
+    string obtenerEstadisticas() const {
+        const auto guardia = epocas.entrar();
+        const IndicesPublicados* indices = publicados.load(memory_order_acquire);
+        const CatalogoPeliculas& catalogo = catalogoDe(indices);
+
+        stringstream ss;
+        ss << "\n=== ESTADÍSTICAS DE LA BASE DE DATOS ===\n";
+        const size_t vigentes = catalogo.size() - (indices ? indices->borradas : 0);
+        ss << "Total de películas: " << vigentes << "\n";
+
+        ss << "Tags únicos: " << catalogo.cantidadTags() << "\n";
+
+        double longitudPromedio = 0.0;
+        for (uint32_t id = 0; id < catalogo.size(); ++id) {
+            if (!indices || indices->vigente(id)) longitudPromedio += catalogo.longitudSinopsis(id);
+        }
+        if (vigentes > 0) {
+            longitudPromedio /= vigentes;
+        }
+        ss << "Longitud promedio de sinopsis: " << fixed << setprecision(2) << longitudPromedio << " caracteres\n";
+        ss << "Memoria del catálogo: " << catalogo.memoria() / 1024 << " KB\n";
+
+        size_t memoriaIndices = indices ? indices->memoriaPostings()
+                                        : indiceTitulos.memoriaPostings() + indiceSinopsis.memoriaPostings();
+        ss << "Memoria de postings (títulos + sinopsis): " << memoriaIndices / 1024 << " KB\n";
+        if (indices) {
+            ss << "Segmentos: " << indices->segmentos.size() << " (películas:";
+            for (const auto& segmento : indices->segmentos) ss << " " << segmento->documentos;
+            ss << "; " << indices->peliculasDelta << " en el delta), " << indices->borradas
+               << " borradas o reemplazadas\n";
+        }
+        ss << "Palabras que no se indexan en las sinopsis: " << palabrasIgnoradas.size();
+        if (!metricas.desdeImagen) {
+            ss << " (" << metricas.aparicionesOmitidas << " apariciones vacías omitidas, " << metricas.terminosPodados
+               << " palabras podadas con " << metricas.postingsPodados << " postings)";
+        }
+        ss << "\n";
+        if (indices) {
+            size_t memoriaTags = 0;
+            for (const auto& segmento : indices->segmentos) memoriaTags += segmento->tags.memoria();
+            ss << "Memoria del índice de tags (bitmaps): " << memoriaTags / 1024 << " KB\n";
+        }
+        const IndiceSimilitud& similitud = indices ? indices->similitud : similitudMutable;
+        ss << "Memoria del índice de similitud: " << similitud.memoria() / 1024 << " KB";
+        if (similitud.vecinosGuardados() > 0) {
+            ss << " (" << similitud.vecinosGuardados() << " vecinos precalculados por película)";
+        }
+        ss << "\n";
+
+        const CacheResultados::Metricas mc = cache.metricas();
+        const size_t consultas = mc.aciertos + mc.fallos;
+        ss << "Caché de resultados: " << mc.aciertos << " aciertos, " << mc.fallos << " fallos";
+        if (consultas > 0) {
+            ss << " (" << setprecision(1) << 100.0 * mc.aciertos / consultas << "% de aciertos)";
+        }
+        ss << ", " << mc.entradas << " entradas, " << mc.bytes / 1024 << " KB; " << mc.rechazadas
+           << " rechazadas por TinyLFU, " << mc.desalojadas << " desalojadas\n";
+
+        ss << "=====================================\n";
+        return ss.str();
+    }
+
+private:
+    string localizarArchivo(const string& nombreArchivo) const {
         vector<string> ubicacionesPosibles = {
             nombreArchivo,
             "./" + nombreArchivo,
             "../" + nombreArchivo,
             "data/" + nombreArchivo
         };
-
-        string archivoEncontrado;
-        for (const auto& ubicacion : ubicacionesPosibles) {
-            if (filesystem::exists(ubicacion)) {
-                archivoEncontrado = ubicacion;
-                break;
+
+        string archivoEncontrado;
+        for (const auto& ubicacion : ubicacionesPosibles) {
+            if (filesystem::exists(ubicacion)) {
+                archivoEncontrado = ubicacion;
+                break;
+            }
+        }
+
+        if (archivoEncontrado.empty()) {
+            throw runtime_error("No se pudo encontrar el archivo: " + nombreArchivo);
+        }
+
+        return archivoEncontrado;
+    }
+
+    // FUNCIÓN PARA NORMALIZAR TAGS
+    string normalizarTag(const string& tag) const {
+        return NormalizadorTexto::normalizarTag(limpiarTexto(tag));
+    }
+
+    vector<string> splitString(const string& str, char delimiter) {
+        vector<string> tokens;
+        stringstream ss(str);
+        string token;
+
+        while (getline(ss, token, delimiter)) {
+            token = limpiarTexto(token);
+            if (!token.empty()) {
+                tokens.push_back(token);
+            }
+        }
+
+        return tokens;
+    }
+
+    string limpiarTexto(const string& texto) const {
+        string resultado = texto;
+
+        // Eliminar espacios al inicio y final
+        resultado.erase(resultado.begin(), find_if(resultado.begin(), resultado.end(), [](unsigned char ch) {
+            return !isspace(ch);
+        }));
+        resultado.erase(find_if(resultado.rbegin(), resultado.rend(), [](unsigned char ch) {
+            return !isspace(ch);
+        }).base(), resultado.end());
+
+        return resultado;
+    }
+
+    /**
+     * @brief Carga el CSV mapeado y lo indexa en paralelo, solapando ambas fases
+     *
+     * Fase 1: el archivo se divide en rangos de bytes alineados a inicios de
+     * registro (LectorCSV::dividir). Cada tarea del grupo de hilos analiza su rango
+     * y lo indexa de inmediato con IDs locales en un FragmentoCarga privado,
+     * mientras las demás siguen analizando. Al terminar, con los conteos de todos
+     * los rangos, cada fragmento desplaza sus IDs al rango global.
+     * Fase 2: las películas se concatenan en el orden del archivo, se indexan los
+     * tags y los fragmentos se combinan por parejas en un árbol (0+1, 2+3, ... y
+     * luego 0+2, ...), con las fusiones de cada nivel en paralelo. Como los rangos
+     * son consecutivos, las postings se concatenan en orden.
+     *
+     * Si algún rango no quedó alineado (comillas sin cerrar que confunden la
+     * paridad), se descarta el trabajo y se repite la carga en un solo rango.
+     *
+     * Complejidad: O(n × m / p) para la fase 1 y O(nodos × log p) para la fusión
+     */
+    void cargarEIndexar(const string& nombreArchivo, size_t numHilos,
+                        chrono::high_resolution_clock::time_point& finCarga) {
+        if (!archivo) {
+            archivo = make_unique<ArchivoMapeado>(localizarArchivo(nombreArchivo));
+        }
+        const string_view texto = archivo->contenido();
+        const char* datos = LectorCSV::inicioDatos(texto);
+        const char* fin = texto.data() + texto.size();
+
+        // Como mucho un rango por hilo del grupo: ninguna tarea de carga espera en cola
+        numHilos = max<size_t>(1, min({numHilos, grupoHilos.size(),
+                                       static_cast<size_t>(fin - datos) / BYTES_MINIMOS_POR_FRAGMENTO}));
+        metricas.hilos = numHilos;
+
+        const vector<const char*> limites = LectorCSV::dividir(datos, fin, numHilos, grupoHilos);
+        vector<unique_ptr<FragmentoCarga>> fragmentos;
+        vector<promise<size_t>> conteos(numHilos);
+        vector<future<size_t>> conteosListos;
+        for (size_t i = 0; i < numHilos; ++i) {
+            fragmentos.push_back(make_unique<FragmentoCarga>());
+            conteosListos.push_back(conteos[i].get_future());
+        }
+
+        vector<future<void>> indexados;
+        for (size_t i = 0; i < numHilos; ++i) {
+            indexados.push_back(grupoHilos.enviar([this, i, &limites, &fragmentos, &conteos]() {
+                FragmentoCarga& fragmento = *fragmentos[i];
+                fragmento.registros = LectorCSV::leerRango(limites[i], limites[i + 1], fragmento.arena,
+                                                           fragmento.alineado);
+                conteos[i].set_value(fragmento.registros.peliculas.size());
+
+                fragmento.estadisticas.preparar(fragmento.registros.peliculas.size());
+                for (size_t j = 0; j < fragmento.registros.peliculas.size(); ++j) {
+                    indexarPelicula(fragmento.registros.peliculas[j], static_cast<uint32_t>(j), fragmento);
+                }
+            }));
+        }
+
+        size_t total = 0;
+        for (size_t i = 0; i < numHilos; ++i) {
+            fragmentos[i]->primerId = total;
+            total += conteosListos[i].get();
+        }
+        finCarga = chrono::high_resolution_clock::now();
+        for (auto& indexado : indexados) {
+            grupoHilos.esperar(indexado);
+        }
+
+        // El último rango termina en el fin del archivo, como una lectura secuencial
+        for (size_t i = 0; i + 1 < numHilos; ++i) {
+            if (!fragmentos[i]->alineado) {
+                cout << "Rangos del CSV desalineados; se carga en un solo hilo" << endl;
+                return cargarEIndexar(nombreArchivo, 1, finCarga);
+            }
+        }
+
+        vector<const RegistrosCSV*> partes;
+        estadisticas.preparar(total);
+        for (auto& fragmento : fragmentos) {
+            estadisticas.copiarFragmento(fragmento->estadisticas, fragmento->primerId);
+            partes.push_back(&fragmento->registros);
+            metricas.aparicionesOmitidas += fragmento->aparicionesOmitidas;
+        }
+        catalogo = CatalogoPeliculas::construir(partes);
+        for (auto& fragmento : fragmentos) {
+            // El texto ya está en el catálogo: los registros y la arena del fragmento sobran
+            fragmento->registros = RegistrosCSV();
+            fragmento->arena = ArenaTexto();
+        }
+
+        // Los IDs de tag se asignan al construir el catálogo, con todos los nombres a la vista
+        grupoHilos.paraCada(numHilos, [this, &fragmentos, numHilos, total](size_t i) {
+            FragmentoCarga& fragmento = *fragmentos[i];
+            fragmento.indices.titulos.desplazarIds(static_cast<uint32_t>(fragmento.primerId));
+            fragmento.indices.sinopsis.desplazarIds(static_cast<uint32_t>(fragmento.primerId));
+            const size_t finFragmento = (i + 1 < numHilos) ? fragmentos[i + 1]->primerId : total;
+            for (size_t id = fragmento.primerId; id < finFragmento; ++id) {
+                for (IdTag tag : catalogo.tagsDe(static_cast<uint32_t>(id))) {
+                    fragmento.indices.tags.agregar(tag, static_cast<uint32_t>(id));
+                }
+            }
+        });
+
+        for (size_t paso = 1; paso < numHilos; paso *= 2) {
+            // Tres fusiones independientes (títulos, sinopsis, tags) por cada pareja del nivel
+            const size_t parejas = (numHilos - paso + 2 * paso - 1) / (2 * paso);
+            grupoHilos.paraCada(3 * parejas, [&fragmentos, paso](size_t k) {
+                const size_t i = (k / 3) * 2 * paso;
+                FragmentoIndice& destino = fragmentos[i]->indices;
+                FragmentoIndice& origen = fragmentos[i + paso]->indices;
+                switch (k % 3) {
+                    case 0: destino.titulos.fusionar(origen.titulos); break;
+                    case 1: destino.sinopsis.fusionar(origen.sinopsis); break;
+                    default: destino.tags.fusionar(origen.tags); break;
+                }
+            });
+        }
+
+        indiceTitulos.fusionar(fragmentos[0]->indices.titulos);
+        indiceSinopsis.fusionar(fragmentos[0]->indices.sinopsis);
+        indiceTags.fusionar(fragmentos[0]->indices.tags);
+
+        estadisticas.titulo.calcularPromedio();
+        estadisticas.sinopsis.calcularPromedio();
+        estadisticas.tags.calcularPromedio();
+
+        // Las longitudes de BM25 siguen contando las palabras omitidas y podadas
+        vector<string> ignoradas;
+        for (size_t i = 0; i < palabrasVacias.size(); ++i) ignoradas.emplace_back(palabrasVacias.palabra(i));
+        if (vocabulario.fraccionMaximaDocumentos < 1.0) {
+            const size_t maxDocumentos = static_cast<size_t>(vocabulario.fraccionMaximaDocumentos * total);
+            const size_t antes = ignoradas.size();
+            metricas.postingsPodados = indiceSinopsis.podar(maxDocumentos, ignoradas);
+            metricas.terminosPodados = ignoradas.size() - antes;
+        }
+        palabrasIgnoradas = PalabrasIgnoradas::construir(move(ignoradas));
+
+        auto resumenTitulos = grupoHilos.enviar([this]() { indiceTitulos.finalizar(); });
+        indiceSinopsis.finalizar();
+        grupoHilos.esperar(resumenTitulos);
+    }
+
+    /**
+     * @brief Arranca desde la imagen del índice si es válida y corresponde al CSV actual
+     *
+     * El catálogo, los tries y los índices de tags y de similitud quedan como vistas sobre la
+     * imagen mapeada; solo se copian las longitudes de BM25 (O(n)). Si la imagen
+     * no existe, es de otra versión, está corrupta o es más vieja que el CSV,
+     * devuelve false.
+     */
+    bool cargarImagen(const string& rutaCsv, const string& rutaImagen) {
+        if (!filesystem::exists(rutaImagen)) return false;
+        try {
+            auto mapeada = make_unique<ArchivoMapeado>(rutaImagen, false);
+            const string_view contenido = mapeada->contenido();
+            FormatoImagen::Cabecera cabecera;
+            if (contenido.size() < sizeof(cabecera)) {
+                throw runtime_error("imagen truncada");
+            }
+            memcpy(&cabecera, contenido.data(), sizeof(cabecera));
+            if (memcmp(cabecera.magia, FormatoImagen::MAGIA, sizeof(cabecera.magia)) != 0) {
+                throw runtime_error("no es una imagen del índice");
+            }
+            if (cabecera.version != FormatoImagen::VERSION || cabecera.marcaOrden != FormatoImagen::MARCA_ORDEN ||
+                cabecera.huellaHash != huellaHash()) {
+                throw runtime_error("versión o plataforma distinta");
+            }
+            if (!csvCoincide(rutaCsv, cabecera)) {
+                cout << "La imagen del índice es anterior al CSV; se reconstruye" << endl;
+                return false;
+            }
+
+            const string_view datos = contenido.substr(sizeof(cabecera));
+            if (datos.size() != cabecera.tamanoDatos ||
+                FormatoImagen::sumaVerificacion(datos.data(), datos.size()) != cabecera.sumaDatos) {
+                throw runtime_error("suma de verificación incorrecta");
+            }
+
+            LectorImagen lector(datos);
+            CatalogoPeliculas leido = CatalogoPeliculas::leer(lector);
+            EstadisticasDocumentos estadisticasLeidas = EstadisticasDocumentos::leer(lector, leido.size());
+            auto instantanea = make_unique<IndicesPublicados>();
+            const uint64_t cantidadSegmentos = lector.leerValor<uint64_t>();
+            uint32_t siguienteId = 0;
+            for (uint64_t i = 0; i < cantidadSegmentos; ++i) {
+                auto segmento = make_shared<SegmentoIndice>(SegmentoIndice::leer(lector));
+                if (segmento->primerId != siguienteId || segmento->tags.cantidadTags() != leido.cantidadTags()) {
+                    throw runtime_error("segmentos incoherentes");
+                }
+                siguienteId = segmento->finId;
+                instantanea->segmentos.push_back(move(segmento));
+            }
+            if (siguienteId != leido.size()) {
+                throw runtime_error("los segmentos no cubren el catálogo");
+            }
+            instantanea->similitud = IndiceSimilitud::leer(lector, leido.size());
+            if (instantanea->similitud.vecinosGuardados() != vecinosPrecalculados) {
+                cout << "La imagen del índice tiene otros vecinos precalculados; se reconstruye" << endl;
+                return false;
+            }
+            const uint64_t huellaVocabulario = lector.leerValor<uint64_t>();
+            PalabrasIgnoradas ignoradasLeidas = PalabrasIgnoradas::leer(lector);
+            if (huellaVocabulario != vocabulario.huella()) {
+                cout << "La imagen del índice usa otras palabras vacías o poda; se reconstruye" << endl;
+                return false;
+            }
+            if (!lector.terminado()) {
+                throw runtime_error("secciones incoherentes");
+            }
+
+            imagen = move(mapeada);
+            archivo.reset();
+            catalogo = move(leido);
+            palabrasIgnoradas = move(ignoradasLeidas);
+            instantanea->catalogo = catalogo;
+            instantanea->estadisticas = make_shared<const EstadisticasDocumentos>(move(estadisticasLeidas));
+            publicar(move(instantanea));
+            return true;
+        } catch (const exception& e) {
+            cout << "Imagen del índice inválida (" << e.what() << "); se reconstruye desde el CSV" << endl;
+            return false;
+        }
+    }
+
+    /**
+     * @brief true si el CSV es el mismo con el que se escribió la imagen
+     *
+     * Igual tamaño y fecha basta; si solo cambió la fecha (una copia o un touch)
+     * se compara la suma de verificación del contenido. El CSV mapeado queda en
+     * 'archivo' por si hay que reconstruir.
+     */
+    bool csvCoincide(const string& rutaCsv, const FormatoImagen::Cabecera& cabecera) {
+        if (filesystem::file_size(rutaCsv) != cabecera.tamanoCsv) return false;
+        if (fechaModificacion(rutaCsv) == cabecera.fechaCsv) return true;
+        if (!archivo) {
+            archivo = make_unique<ArchivoMapeado>(rutaCsv);
+        }
+        const string_view texto = archivo->contenido();
+        return FormatoImagen::sumaVerificacion(texto.data(), texto.size()) == cabecera.sumaCsv;
+    }
+
+    /**
+     * @brief Escribe la imagen del catálogo y de los índices publicados junto al CSV
+     *
+     * Se escribe en un temporal que después reemplaza a la imagen anterior, así
+     * otro proceso que arranque en ese momento nunca ve una imagen a medias. Un
+     * error aquí solo se informa: el catálogo ya cargado sigue siendo válido.
+     */
+    void guardarImagen(const string& rutaCsv, const string& rutaImagen) const {
+        auto inicio = chrono::high_resolution_clock::now();
+        const IndicesPublicados* indices = publicados.load(memory_order_acquire);
+        const string temporal = rutaImagen + ".tmp";
+        try {
+            FormatoImagen::Cabecera cabecera{};
+            memcpy(cabecera.magia, FormatoImagen::MAGIA, sizeof(cabecera.magia));
+            cabecera.version = FormatoImagen::VERSION;
+            cabecera.marcaOrden = FormatoImagen::MARCA_ORDEN;
+            cabecera.huellaHash = huellaHash();
+            const string_view texto = archivo->contenido();
+            cabecera.tamanoCsv = texto.size();
+            cabecera.fechaCsv = fechaModificacion(rutaCsv);
+            cabecera.sumaCsv = FormatoImagen::sumaVerificacion(texto.data(), texto.size());
+
+            EscritorImagen escritor(temporal);
+            indices->catalogo.escribir(escritor);
+            indices->estadisticas->escribir(escritor);
+            escritor.escribirValor(static_cast<uint64_t>(indices->segmentos.size()));
+            for (const auto& segmento : indices->segmentos) {
+                segmento->escribir(escritor);
+            }
+            indices->similitud.escribir(escritor);
+            escritor.escribirValor(vocabulario.huella());
+            palabrasIgnoradas.escribir(escritor);
+            escritor.cerrar(cabecera);
+        } catch (const exception& e) {
+            error_code ignorado;
+            filesystem::remove(temporal, ignorado);
+            cout << "No se pudo guardar la imagen del índice: " << e.what() << endl;
+            return;
+        }
+
+        error_code error;
+        filesystem::rename(temporal, rutaImagen, error);
+        if (error) {
+            cout << "No se pudo guardar la imagen del índice: " << error.message() << endl;
+            return;
+        }
+        auto duracion = chrono::duration_cast<chrono::milliseconds>(chrono::high_resolution_clock::now() - inicio);
+        cout << "Imagen del índice guardada en " << duracion.count() << " ms" << endl;
+    }
+
+    static int64_t fechaModificacion(const string& ruta) {
+        return static_cast<int64_t>(filesystem::last_write_time(ruta).time_since_epoch().count());
+    }
+
+    /**
+     * @brief Cambia si cambia la función de hash de los títulos guardados en la imagen
+     */
+    static uint64_t huellaHash() {
+        return SistemaPuntuacion::hashTexto("imagen del indice de peliculas");
+    }
+
+    /**
+     * @brief Congela los índices mutables y los publica como instantánea inmutable
+     *
+     * A partir de aquí las consultas leen la instantánea con una carga atómica y
+     * no toman trie_mutex ni indice_mutex. Las estadísticas pasan a la instantánea.
+     */
+    void congelarIndices() {
+        auto segmento = make_shared<SegmentoIndice>();
+        auto titulos = grupoHilos.enviar([this]() { return indiceTitulos.congelar(false, calidadDe(catalogo)); });
+        segmento->sinopsis = indiceSinopsis.congelar(true);
+        segmento->tags = IndiceTagsCongelado::construir(indiceTags, catalogo.cantidadTags());
+        segmento->titulos = grupoHilos.esperar(titulos);
+        segmento->finId = static_cast<uint32_t>(catalogo.size());
+        segmento->documentos = catalogo.size();
+
+        auto instantanea = make_unique<IndicesPublicados>();
+        instantanea->similitud = IndiceSimilitud::construir(segmento->sinopsis, catalogo.size(),
+                                                            vecinosPrecalculados, grupoHilos);
+        instantanea->segmentos.push_back(move(segmento));
+        instantanea->catalogo = catalogo;
+        instantanea->estadisticas = make_shared<const EstadisticasDocumentos>(move(estadisticas));
+        publicar(move(instantanea));
+
+        indiceTitulos.vaciar();
+        indiceSinopsis.vaciar();
+        indiceTags.vaciar();
+    }
+
+    /**
+     * @brief Publica una instantánea y retira la anterior, que se libera cuando ya nadie puede leerla
+     *
+     * No espera a las lecturas en curso: cada publicación libera las instantáneas
+     * retiradas cuyas lecturas ya terminaron (ver EpocasLectura).
+     */
+    void publicar(unique_ptr<const IndicesPublicados> instantanea) {
+        lock_guard<mutex> lock(publicacion_mutex);
+        publicados.store(instantanea.get(), memory_order_release);
+        // Después de publicar: quien lea la generación nueva ya ve los índices nuevos
+        generacion.fetch_add(1, memory_order_release);
+        atomic_thread_fence(memory_order_seq_cst);
+        unique_ptr<const IndicesPublicados> vieja = move(publicada);
+        publicada = move(instantanea);
+        if (vieja) epocas.retirar(move(vieja));
+        epocas.recolectar();
+    }
+
+    /**
+     * @brief Catálogo con el que se indexó la instantánea ('catalogo' es del escritor y puede estar creciendo)
+     */
+    const CatalogoPeliculas& catalogoDe(const IndicesPublicados* indices) const {
+        return indices ? indices->catalogo : catalogo;
+    }
+
+    const EstadisticasDocumentos& estadisticasDe(const IndicesPublicados* indices) const {
+        return indices ? *indices->estadisticas : estadisticas;
+    }
+
+    /**
+     * @brief Candidatos de autocompletar con varias palabras: se parte de la palabra completa más rara
+     *        del Trie de títulos y se verifica cada título
+     */
+    template<typename TrieT, typename Vigente, typename Calidad>
+    static void completarTitulos(const TrieT& titulos, const vector<string>& palabras,
+                                 const CatalogoPeliculas& catalogo, Vigente&& vigente, Calidad&& calidad,
+                                 vector<pair<float, uint32_t>>& candidatos) {
+        ListaPosicional masRara;
+        for (size_t i = 0; i + 1 < palabras.size(); ++i) {
+            ListaPosicional lista;
+            if (!titulos.obtenerLista(palabras[i], lista)) return;
+            if (i == 0 || lista.postings.df < masRara.postings.df) masRara = lista;
+        }
+        string buffer;
+        masRara.postings.recorrer([&](const uint32_t* ids, const uint16_t*, uint32_t cantidad) {
+            for (uint32_t k = 0; k < cantidad; ++k) {
+                if (vigente(ids[k]) && completaTitulo(catalogo.titulo(ids[k]), palabras, buffer)) {
+                    candidatos.emplace_back(calidad(ids[k]), ids[k]);
+                }
+            }
+        }, false);
+    }
+
+    /**
+     * @brief true si el título tiene todas las palabras menos la última, y una que empieza con la última
+     */
+    static bool completaTitulo(string_view titulo, const vector<string>& palabras, string& buffer) {
+        vector<char> presente(palabras.size(), 0);
+        const string& prefijo = palabras.back();
+        NormalizadorTexto::paraCadaToken(titulo, buffer, [&](string_view token) {
+            for (size_t i = 0; i + 1 < palabras.size(); ++i) {
+                if (token == palabras[i]) presente[i] = 1;
+            }
+            if (token.compare(0, prefijo.size(), prefijo) == 0) presente.back() = 1;
+        });
+        return find(presente.begin(), presente.end(), 0) == presente.end();
+    }
+
+    /**
+     * @brief SistemaPuntuacion::calidadEstatica por ID; el catálogo debe vivir mientras se use
+     */
+    static function<float(uint32_t)> calidadDe(const CatalogoPeliculas& catalogo) {
+        return [&catalogo](uint32_t id) {
+            return SistemaPuntuacion::calidadEstatica(catalogo.tagsDe(id).size(), catalogo.longitudSinopsis(id));
+        };
+    }
+
+    /**
+     * @brief Borra 'id' (si no es nulo), agrega 'datos' (si no es nulo) y publica ambos cambios juntos
+     *
+     * @return ID de la película agregada (o 'id' si solo se borró)
+     */
+    uint32_t actualizar(const uint32_t* id, const DatosPelicula* datos) {
+        lock_guard<mutex> lock(actualizacion_mutex);
+        const IndicesPublicados* actual = publicada.get();
+        if (!actual) {
+            throw runtime_error("Las actualizaciones requieren índices congelados");
+        }
+        if (id && (*id >= actual->catalogo.size() || !actual->vigente(*id))) {
+            throw runtime_error("No existe la película " + to_string(*id));
+        }
+
+        auto instantanea = make_unique<IndicesPublicados>(*actual);
+        uint32_t resultado = id ? *id : 0;
+        if (datos) {
+            const uint32_t primerIdDelta = static_cast<uint32_t>(catalogo.size() - actual->peliculasDelta);
+            auto estadisticasNuevas = make_shared<EstadisticasDocumentos>(*actual->estadisticas);
+            resultado = indexarEnDelta(*datos, *estadisticasNuevas);
+            instantanea->estadisticas = move(estadisticasNuevas);
+            instantanea->catalogo = catalogo;
+            auto delta = congelarDelta(primerIdDelta, actual->peliculasDelta + 1);
+            if (actual->peliculasDelta > 0) {
+                instantanea->segmentos.back() = move(delta);
+            } else {
+                instantanea->segmentos.push_back(move(delta));
+            }
+            instantanea->peliculasDelta = actual->peliculasDelta + 1;
+            // Sellado: el delta congelado queda como un segmento más y el próximo empieza vacío
+            if (instantanea->peliculasDelta >= politica.peliculasDelta) {
+                instantanea->peliculasDelta = 0;
+                vaciarDelta();
+            }
+        }
+        vector<uint64_t>& vigentes = instantanea->vigentes;
+        if (id || !vigentes.empty()) {
+            const size_t n = instantanea->catalogo.size();
+            if (vigentes.empty()) vigentes.assign((actual->catalogo.size() + 63) / 64, ~0ULL);
+            vigentes.resize((n + 63) / 64, ~0ULL);
+            // Los bits después del último ID quedan en 1: la película que reciba ese ID será vigente
+            if (datos) vigentes[resultado >> 6] |= 1ULL << (resultado & 63);
+            if (id) {
+                vigentes[*id >> 6] &= ~(1ULL << (*id & 63));
+                ++instantanea->borradas;
+            }
+        }
+        publicar(move(instantanea));
+
+        iniciarCompactacion(false);
+        return resultado;
+    }
+
+    /**
+     * @brief Agrega la película al catálogo del escritor y la indexa en los índices del delta
+     *
+     * Se tokeniza como en indexarPelicula; en las sinopsis se omiten todas las
+     * palabras ignoradas (vacías y podadas), como en la carga del CSV.
+     */
+    uint32_t indexarEnDelta(const DatosPelicula& datos, EstadisticasDocumentos& estadisticasNuevas) {
+        vector<string> tags;
+        for (const auto& tag : datos.tags) {
+            string normalizado = NormalizadorTexto::normalizarTag(tag);
+            if (!normalizado.empty()) tags.push_back(move(normalizado));
+        }
+        sort(tags.begin(), tags.end());
+        tags.erase(unique(tags.begin(), tags.end()), tags.end());
+
+        const uint32_t id = catalogo.agregar(datos.titulo, datos.sinopsis, tags, datos.split, datos.fuente_sinopsis);
+        uint32_t palabrasTitulo = 0;
+        uint32_t palabrasSinopsis = 0;
+        string buffer;
+        NormalizadorTexto::paraCadaToken(datos.titulo, buffer, [&](string_view palabra) {
+            deltaTitulos.insertar(palabra, id, palabrasTitulo++);
+        });
+        NormalizadorTexto::paraCadaToken(datos.sinopsis, buffer, [&](string_view palabra) {
+            if (!palabrasIgnoradas.contiene(palabra)) {
+                deltaSinopsis.insertar(palabra, id, palabrasSinopsis);
+            }
+            ++palabrasSinopsis;
+        });
+        for (IdTag tag : catalogo.tagsDe(id)) {
+            deltaTags.agregar(tag, id);
+        }
+        estadisticasNuevas.agregar(palabrasTitulo, palabrasSinopsis, static_cast<uint32_t>(tags.size()),
+                                   SistemaPuntuacion::hashTexto(NormalizadorTexto::normalizar(datos.titulo)));
+        return id;
+    }
+
+    /**
+     * @brief Segmento con lo indexado en el delta: las películas [primerId, catalogo.size())
+     */
+    shared_ptr<const SegmentoIndice> congelarDelta(uint32_t primerId, size_t documentos) const {
+        auto delta = make_shared<SegmentoIndice>();
+        delta->titulos = deltaTitulos.congelar(false, calidadDe(catalogo));
+        delta->sinopsis = deltaSinopsis.congelar(true);
+        delta->tags = IndiceTagsCongelado::construir(deltaTags, catalogo.cantidadTags());
+        delta->primerId = primerId;
+        delta->finId = static_cast<uint32_t>(catalogo.size());
+        delta->documentos = documentos;
+        return delta;
+    }
+
+    void vaciarDelta() {
+        deltaTitulos.vaciar();
+        deltaSinopsis.vaciar();
+        deltaTags.vaciar();
+    }
+
+    /**
+     * @brief Publica el delta como segmento sellado (requiere actualizacion_mutex)
+     */
+    void sellarDelta() {
+        if (!publicada || publicada->peliculasDelta == 0) return;
+        auto instantanea = make_unique<IndicesPublicados>(*publicada);
+        instantanea->peliculasDelta = 0;
+        vaciarDelta();
+        publicar(move(instantanea));
+    }
+
+    /**
+     * @brief Segmentos sellados [desde, hasta) a fusionar según la política; vacío si no hay nada que hacer
+     *
+     * Primero se reescribe un segmento con demasiadas borradas; si no, los
+     * segmentosPorNivel segmentos adyacentes del mismo nivel más recientes.
+     * Con 'todo', todos los sellados en uno.
+     */
+    pair<size_t, size_t> elegirFusion(const IndicesPublicados& indices, bool todo) const {
+        const size_t sellados = indices.segmentos.size() - (indices.peliculasDelta > 0);
+        auto borradasPendientes = [&indices](const SegmentoIndice& segmento) {
+            // Las que ya estaban borradas al construir el segmento no están en él
+            const size_t quitadas = segmento.finId - segmento.primerId - segmento.documentos;
+            return indices.borradasEntre(segmento.primerId, segmento.finId) - quitadas;
+        };
+        if (todo) {
+            if (sellados > 1 || (sellados == 1 && borradasPendientes(*indices.segmentos[0]) > 0)) return {0, sellados};
+            return {0, 0};
+        }
+
+        for (size_t i = 0; i < sellados; ++i) {
+            const SegmentoIndice& segmento = *indices.segmentos[i];
+            const size_t pendientes = borradasPendientes(segmento);
+            if (pendientes > 0 && pendientes >= politica.maxFraccionBorradas * max<size_t>(1, segmento.documentos)) {
+                return {i, i + 1};
+            }
+        }
+
+        const size_t porNivel = max<size_t>(2, politica.segmentosPorNivel);
+        size_t fin = sellados;
+        while (fin >= porNivel) {
+            const size_t nivel = politica.nivel(indices.segmentos[fin - 1]->documentos);
+            size_t inicio = fin - 1;
+            while (inicio > 0 && politica.nivel(indices.segmentos[inicio - 1]->documentos) == nivel) --inicio;
+            if (fin - inicio >= porNivel) {
+                size_t documentos = 0;
+                for (size_t i = fin - porNivel; i < fin; ++i) documentos += indices.segmentos[i]->documentos;
+                if (documentos <= politica.maxPeliculasSegmento) return {fin - porNivel, fin};
+            }
+            fin = inicio;
+        }
+        return {0, 0};
+    }
+
+    /**
+     * @brief true si demasiadas películas vigentes quedaron fuera del índice de similitud
+     */
+    bool similitudDesactualizada(const IndicesPublicados& indices) const {
+        const size_t sellados = indices.segmentos.size() - (indices.peliculasDelta > 0);
+        if (sellados == 0) return false;
+        const size_t corte = indices.segmentos[sellados - 1]->finId;
+        const size_t sinVector = corte - min(corte, indices.similitud.documentos());
+        return sinVector > politica.maxFraccionSinSimilitud * max<size_t>(1, corte);
+    }
+
+    /**
+     * @brief Lanza el compactador en su hilo si no hay otro en curso y hay algo que hacer
+     *
+     * Requiere actualizacion_mutex.
+     */
+    void iniciarCompactacion(bool todo) {
+        if (compactacionEnCurso) {
+            // El compactador en curso lo ve en su próxima vuelta, antes de poder terminar
+            fusionTotalPedida = fusionTotalPedida || todo;
+            return;
+        }
+        const pair<size_t, size_t> rango = elegirFusion(*publicada, todo);
+        if (rango.first == rango.second && !todo && !similitudDesactualizada(*publicada)) return;
+        // Un hilo anterior ya terminado, o a punto de terminar: no vuelve a tomar el mutex
+        if (hiloCompactador.joinable()) hiloCompactador.join();
+        compactacionEnCurso = true;
+        hiloCompactador = thread([this, todo]() { compactar(todo); });
+    }
+
+    /**
+     * @brief Fusiona segmentos mientras la política lo pida, reconstruyendo la similitud si hace falta
+     *
+     * El trabajo pesado (descongelar, fusionar y congelar) se hace sobre una copia
+     * de la instantánea, sin el mutex: las actualizaciones siguen mientras tanto.
+     * Solo este hilo reemplaza segmentos sellados, así que al publicar los
+     * segmentos fusionados siguen en las mismas posiciones.
+     */
+    void compactar(bool todo) {
+        while (true) {
+            unique_ptr<IndicesPublicados> base;
+            pair<size_t, size_t> rango;
+            bool reconstruirSimilitud;
+            {
+                lock_guard<mutex> lock(actualizacion_mutex);
+                todo = todo || fusionTotalPedida;
+                fusionTotalPedida = false;
+                rango = elegirFusion(*publicada, todo);
+                reconstruirSimilitud = todo || similitudDesactualizada(*publicada);
+                if (rango.first == rango.second && !reconstruirSimilitud) {
+                    compactacionEnCurso = false;
+                    return;
+                }
+                base = make_unique<IndicesPublicados>(*publicada);
+            }
+            todo = false;
+
+            vector<shared_ptr<const SegmentoIndice>> sellados(
+                base->segmentos.begin(), base->segmentos.end() - (base->peliculasDelta > 0));
+            shared_ptr<const SegmentoIndice> fusionado;
+            if (rango.first != rango.second) {
+                fusionado = fusionarSegmentos(*base, rango.first, rango.second);
+                sellados.erase(sellados.begin() + rango.first + 1, sellados.begin() + rango.second);
+                sellados[rango.first] = fusionado;
+            }
+            IndiceSimilitud similitud;
+            if (reconstruirSimilitud) {
+                similitud = construirSimilitud(*base, sellados);
+            }
+
+            lock_guard<mutex> lock(actualizacion_mutex);
+            auto instantanea = make_unique<IndicesPublicados>(*publicada);
+            if (fusionado) {
+                auto& segmentos = instantanea->segmentos;
+                segmentos.erase(segmentos.begin() + rango.first + 1, segmentos.begin() + rango.second);
+                segmentos[rango.first] = fusionado;
+
+                // Los promedios de longitud de BM25 pasan a contar las agregadas y no las borradas
+                auto estadisticasNuevas = make_shared<EstadisticasDocumentos>(*publicada->estadisticas);
+                const vector<uint64_t>* vigentes = instantanea->borradas > 0 ? &instantanea->vigentes : nullptr;
+                estadisticasNuevas->titulo.calcularPromedio(vigentes);
+                estadisticasNuevas->sinopsis.calcularPromedio(vigentes);
+                estadisticasNuevas->tags.calcularPromedio(vigentes);
+                instantanea->estadisticas = move(estadisticasNuevas);
+            }
+            if (reconstruirSimilitud) {
+                instantanea->similitud = move(similitud);
+            }
+            publicar(move(instantanea));
+        }
+    }
+
+    /**
+     * @brief Un segmento con las películas vigentes de los segmentos [desde, hasta)
+     *
+     * Complejidad: O(postings + posiciones + nodos) de esos segmentos
+     */
+    shared_ptr<const SegmentoIndice> fusionarSegmentos(const IndicesPublicados& base, size_t desde,
+                                                       size_t hasta) {
+        auto borrada = [&base](uint32_t id) { return !base.vigente(id); };
+        auto reconstruir = [&](TrieCongelado SegmentoIndice::*campo, bool comprimir,
+                               const function<float(uint32_t)>& calidad) {
+            TrieCompacto trie;
+            for (size_t i = desde; i < hasta; ++i) {
+                // IDs crecientes de un segmento al siguiente: fusionar concatena las postings
+                TrieCompacto parte((base.segmentos[i].get()->*campo).descongelar());
+                trie.fusionar(parte);
+            }
+            trie.eliminarIds(borrada);
+            trie.finalizar();
+            return trie.congelar(comprimir, calidad);
+        };
+
+        auto segmento = make_shared<SegmentoIndice>();
+        segmento->primerId = base.segmentos[desde]->primerId;
+        segmento->finId = base.segmentos[hasta - 1]->finId;
+        auto titulos = grupoHilos.enviar([&]() {
+            return reconstruir(&SegmentoIndice::titulos, false, calidadDe(base.catalogo));
+        });
+        segmento->sinopsis = reconstruir(&SegmentoIndice::sinopsis, true, nullptr);
+        IndiceGenerico<uint32_t, IdTag> tags;
+        for (uint32_t id = segmento->primerId; id < segmento->finId; ++id) {
+            if (borrada(id)) continue;
+            ++segmento->documentos;
+            for (IdTag tag : base.catalogo.tagsDe(id)) tags.agregar(tag, id);
+        }
+        segmento->tags = IndiceTagsCongelado::construir(tags, base.catalogo.cantidadTags());
+        segmento->titulos = grupoHilos.esperar(titulos);
+        return segmento;
+    }
+
+    /**
+     * @brief Índice de similitud de todas las películas vigentes de los segmentos sellados
+     *
+     * Los vectores TF-IDF necesitan la frecuencia documental global: se arma un
+     * Trie de sinopsis con todos los segmentos. Complejidad: O(postings de las sinopsis)
+     */
+    IndiceSimilitud construirSimilitud(const IndicesPublicados& base,
+                                       const vector<shared_ptr<const SegmentoIndice>>& sellados) {
+        if (sellados.empty()) return IndiceSimilitud();
+        const size_t corte = sellados.back()->finId;
+        if (sellados.size() == 1) {
+            return IndiceSimilitud::construir(sellados[0]->sinopsis, corte, vecinosPrecalculados, grupoHilos);
+        }
+        TrieCompacto sinopsis;
+        for (const auto& segmento : sellados) {
+            TrieCompacto parte(segmento->sinopsis.descongelar());
+            sinopsis.fusionar(parte);
+        }
+        sinopsis.eliminarIds([&base](uint32_t id) { return !base.vigente(id); });
+        return IndiceSimilitud::construir(sinopsis.congelar(), corte, vecinosPrecalculados, grupoHilos);
+    }
+
+    /**
+     * @brief Términos BM25 de las palabras con un prefijo, por segmento (uno solo con los Tries mutables)
+     */
+    struct TerminosPrefijo {
+        vector<vector<TerminoConsulta>> titulos;
+        vector<vector<TerminoConsulta>> sinopsis;
+    };
+
+    /**
+     * @brief Palabras de un tramo de buscarLote, resueltas una vez para todas sus consultas
+     */
+    struct TerminosCompartidos {
+        struct Palabra {
+            TerminosPrefijo terminos;               // Sin sinopsis si es ignorada y solo la usan consultas booleanas
+            vector<vector<uint32_t>> coincidencias; // Por segmento, unión de sus listas; vacío si la usa una sola consulta
+        };
+        unordered_map<string, uint32_t> posicion;
+        vector<Palabra> palabras;
+
+        const Palabra* buscar(const string& palabra) const {
+            auto it = posicion.find(palabra);
+            return it == posicion.end() ? nullptr : &palabras[it->second];
+        }
+    };
+
+    /**
+     * @brief Documentos que cumplen una consulta con operadores o varias palabras, con su BM25
+     *
+     * Primero se resuelve el conjunto booleano (EvaluadorBooleano) y después cada
+     * palabra positiva suma su BM25 solo en esos documentos, intersectando con
+     * galope, así que el costo no crece con el tamaño de las postings de cada prefijo.
+     *
+     * @param compartidos Expansiones ya resueltas por buscarLote (nullptr = expandir aquí)
+     */
+    ResultadosBusqueda buscarBooleana(const ConsultaBooleana& consulta, const IndicesPublicados* indices,
+                                      const TerminosCompartidos* compartidos = nullptr) const {
+        const CatalogoPeliculas& catalogo = catalogoDe(indices);
+        const EstadisticasDocumentos& estadisticas = estadisticasDe(indices);
+        const uint32_t universo = static_cast<uint32_t>(catalogo.size());
+        auto precalculadasDe = [compartidos](size_t s) -> function<const vector<uint32_t>*(const string&)> {
+            if (!compartidos) return {};
+            return [compartidos, s](const string& palabra) -> const vector<uint32_t>* {
+                const TerminosCompartidos::Palabra* compartida = compartidos->buscar(palabra);
+                return compartida && !compartida->coincidencias.empty() ? &compartida->coincidencias[s] : nullptr;
+            };
+        };
+        vector<uint32_t> coincidencias;
+        if (indices) {
+            // Los segmentos cubren rangos de IDs crecientes: basta concatenar sus resultados
+            for (size_t s = 0; s < indices->segmentos.size(); ++s) {
+                const SegmentoIndice& segmento = *indices->segmentos[s];
+                const vector<uint32_t> enSegmento = EvaluadorBooleano<TrieCongelado>::evaluar(
+                    consulta, segmento.titulos, segmento.sinopsis, palabrasIgnoradas, universo, precalculadasDe(s));
+                coincidencias.insert(coincidencias.end(), enSegmento.begin(), enSegmento.end());
+            }
+        } else {
+            coincidencias = EvaluadorBooleano<TrieCompacto>::evaluar(consulta, indiceTitulos, indiceSinopsis,
+                                                                     palabrasIgnoradas, universo, precalculadasDe(0));
+        }
+
+        vector<double> puntuaciones(coincidencias.size(), 0.0);
+        const vector<string> palabras = consulta.palabrasPositivas();
+        for (const auto& palabra : palabras) {
+            // Una palabra ignorada no está en las sinopsis: como prefijo solo sumaría "theater" a "the"
+            const bool enSinopsis = !palabrasIgnoradas.contiene(palabra);
+            TerminosPrefijo propia;
+            const TerminosPrefijo& expansion = compartidos ? compartidos->buscar(palabra)->terminos
+                                                           : (propia = expandirPrefijo(palabra, indices, enSinopsis));
+            puntuarCoincidencias(expansion.titulos, coincidencias, puntuaciones, indices);
+            if (enSinopsis) puntuarCoincidencias(expansion.sinopsis, coincidencias, puntuaciones, indices);
+
+            const vector<uint32_t> conTag = idsConTag(palabra, indices);
+            if (conTag.empty()) continue;
+            const double idfTag = SistemaPuntuacion::PESO_TAG *
+                                  SistemaPuntuacion::idf(conTag.size(), estadisticas.totalDocumentos);
+            for (uint32_t id : conTag) {
+                auto it = lower_bound(coincidencias.begin(), coincidencias.end(), id);
+                if (it != coincidencias.end() && *it == id) {
+                    puntuaciones[it - coincidencias.begin()] +=
+                        idfTag * SistemaPuntuacion::saturacion(1, estadisticas.tags.normalizacion[id]);
+                }
+            }
+        }
+
+        string tituloBuscado;
+        for (const auto& palabra : palabras) {
+            tituloBuscado += (tituloBuscado.empty() ? "" : " ") + palabra;
+        }
+        const uint64_t hashBuscado = SistemaPuntuacion::hashTexto(tituloBuscado);
+
+        ResultadosBusqueda resultados;
+        resultados.reserve(coincidencias.size());
+        for (size_t i = 0; i < coincidencias.size(); ++i) {
+            const uint32_t id = coincidencias[i];
+            if (estadisticas.hashTitulo[id] == hashBuscado) {
+                puntuaciones[i] += SistemaPuntuacion::BONUS_TITULO_EXACTO;
+            }
+            resultados.push_back({id, puntuaciones[i]});
+        }
+        return resultados;
+    }
+
+    /**
+     * @brief IDs ordenados de las películas con el tag, de los segmentos de la instantánea o del índice mutable
+     */
+    vector<uint32_t> idsConTag(const string& nombre, const IndicesPublicados* indices) const {
+        IdTag tag;
+        if (!catalogoDe(indices).buscarTag(nombre, tag)) return {};
+        if (indices) {
+            vector<uint32_t> ids;
+            for (const auto& segmento : indices->segmentos) {
+                const vector<uint32_t> enSegmento = segmento->tags.buscar(tag).aIds();
+                ids.insert(ids.end(), enSegmento.begin(), enSegmento.end());
+            }
+            return ids;
+        }
+        vector<uint32_t> ids = indiceTags.buscar(tag);
+        sort(ids.begin(), ids.end());
+        return ids;
+    }
+
+    /**
+     * @brief Evalúa una expresión de tags sobre los bitmaps de la instantánea
+     *
+     * Con varios segmentos se unen los bitmaps de cada uno; con el índice mutable
+     * los bitmaps de los tags de la expresión se construyen al consultar.
+     */
+    BitmapIds conjuntoDeTags(const string& expresion, const IndicesPublicados* indices) const {
+        const ConsultaBooleana consulta = ConsultaBooleana::analizarTags(expresion);
+        size_t numTags = 0;
+        for (const auto& clausula : consulta.clausulas) numTags += clausula.alternativas.size();
+        vector<BitmapIds> construidos;
+        // Las vistas apuntan a estos bitmaps: no deben reubicarse
+        construidos.reserve(numTags * (indices ? indices->segmentos.size() : 1));
+
+        const CatalogoPeliculas& catalogo = catalogoDe(indices);
+        return EvaluadorTags::evaluar(consulta, static_cast<uint32_t>(catalogo.size()), [&](const string& nombre) {
+            IdTag tag;
+            if (!catalogo.buscarTag(nombre, tag)) return VistaBitmap();
+            if (indices) {
+                VistaBitmap conjunto = indices->segmentos.front()->tags.buscar(tag);
+                for (size_t i = 1; i < indices->segmentos.size(); ++i) {
+                    const VistaBitmap otro = indices->segmentos[i]->tags.buscar(tag);
+                    if (otro.cardinalidad() == 0) continue;
+                    // Cada unión queda en `construidos`; las intermedias se descartan al terminar la consulta
+                    construidos.push_back(BitmapIds::unir(conjunto, otro));
+                    conjunto = construidos.back().vista();
+                }
+                return conjunto;
+            }
+            const vector<uint32_t> ids = idsConTag(nombre, nullptr);
+            construidos.push_back(BitmapIds::desdeIds(RangoIds(ids)));
+            return construidos.back().vista();
+        });
+    }
+
+    /**
+     * @param df Frecuencia documental global de la palabra (ver frecuenciaGlobal), no la de 'lista'
+     */
+    static TerminoConsulta terminoBM25(const ListaPostings& lista, uint16_t maxFrecuencia,
+                                       const EstadisticasCampo& campo, double peso, size_t df, size_t total) {
+        const double pesoIdf = peso * SistemaPuntuacion::idf(df, total);
+        const double cota = pesoIdf * SistemaPuntuacion::saturacion(
+            maxFrecuencia, campo.longitudMinima, campo.longitudPromedio);
+        return {lista, &campo, pesoIdf, cota};
+    }
+
+    /**
+     * @brief Películas con la palabra en el campo, sumando todos los segmentos de la instantánea
+     *
+     * El idf usa el total de documentos del catálogo, así que la frecuencia
+     * documental también debe ser la de todo el catálogo: con la de un solo
+     * segmento, una palabra del delta parecería rarísima y cada película recién
+     * agregada subiría al tope. Como el total, cuenta las borradas hasta que se
+     * compacta su segmento. Con un solo segmento (o sin instantánea) es 'df'.
+     */
+    static size_t frecuenciaGlobal(const IndicesPublicados* indices, TrieCongelado SegmentoIndice::*campo,
+                                   string_view palabra, size_t df) {
+        if (!indices || indices->segmentos.size() == 1) return df;
+        size_t total = 0;
+        for (const auto& segmento : indices->segmentos) total += ((*segmento).*campo).frecuenciaDocumental(palabra);
+        return total;
+    }
+
+    /**
+     * @brief Expande el prefijo en títulos y sinopsis de cada segmento, con el idf global de cada palabra
+     *
+     * @param conSinopsis Si es false, 'sinopsis' queda con listas vacías
+     */
+    TerminosPrefijo expandirPrefijo(const string& prefijo, const IndicesPublicados* indices,
+                                    bool conSinopsis = true) const {
+        const EstadisticasDocumentos& estadisticas = estadisticasDe(indices);
+        const size_t total = estadisticas.totalDocumentos;
+        auto recolector = [indices, total](vector<TerminoConsulta>& terminos, TrieCongelado SegmentoIndice::*campo,
+                                           const EstadisticasCampo& estadisticasCampo, double peso) {
+            return [&terminos, indices, campo, &estadisticasCampo, peso, total](
+                       string_view palabra, const ListaPostings& lista, uint16_t maxFrecuencia) {
+                terminos.push_back(terminoBM25(lista, maxFrecuencia, estadisticasCampo, peso,
+                                               frecuenciaGlobal(indices, campo, palabra, lista.df), total));
+            };
+        };
+
+        TerminosPrefijo expansion;
+        const size_t segmentos = indices ? indices->segmentos.size() : 1;
+        expansion.titulos.resize(segmentos);
+        expansion.sinopsis.resize(segmentos);
+        for (size_t s = 0; s < segmentos; ++s) {
+            auto titulos = recolector(expansion.titulos[s], &SegmentoIndice::titulos, estadisticas.titulo,
+                                      SistemaPuntuacion::PESO_TITULO);
+            auto sinopsis = recolector(expansion.sinopsis[s], &SegmentoIndice::sinopsis, estadisticas.sinopsis,
+                                       SistemaPuntuacion::PESO_SINOPSIS);
+            if (indices) {
+                indices->segmentos[s]->titulos.recorrerTerminos(prefijo, titulos);
+                if (conSinopsis) indices->segmentos[s]->sinopsis.recorrerTerminos(prefijo, sinopsis);
+            } else {
+                indiceTitulos.recorrerTerminos(prefijo, titulos);
+                if (conSinopsis) indiceSinopsis.recorrerTerminos(prefijo, sinopsis);
+            }
+        }
+        return expansion;
+    }
+
+    /**
+     * @brief Expande una vez por segmento cada palabra distinta de las consultas [desde, hasta) de un lote
+     *
+     * Las palabras que dos o más consultas usan como término de EvaluadorBooleano
+     * también se unen una sola vez: es la unión de postings (y la descompresión)
+     * que cada consulta haría por su cuenta.
+     *
+     * Complejidad: O(palabras distintas × segmentos) recorridos de prefijo, más
+     * una unión por segmento de cada palabra compartida
+     */
+    TerminosCompartidos compartirTerminos(const vector<ConsultaBooleana>& analizadas, const vector<uint32_t>& unicas,
+                                          size_t desde, size_t hasta, const IndicesPublicados* indices) const {
+        TerminosCompartidos compartidos;
+        vector<const string*> palabras;
+        vector<uint32_t> usosBooleanos;
+        vector<char> conSinopsis;
+        auto registrar = [&](const string& palabra, bool terminoSimple, bool comoElemento) {
+            auto [it, nueva] = compartidos.posicion.try_emplace(palabra, static_cast<uint32_t>(palabras.size()));
+            if (nueva) {
+                palabras.push_back(&it->first);
+                usosBooleanos.push_back(0);
+                conSinopsis.push_back(0);
+            }
+            // Como en buscarBooleana: una palabra ignorada no puntúa en sinopsis y
+            // EvaluadorBooleano suele omitirla, así que no vale la pena unirla
+            const bool ignorada = palabrasIgnoradas.contiene(palabra);
+            usosBooleanos[it->second] += comoElemento && !ignorada;
+            conSinopsis[it->second] |= terminoSimple || !ignorada;
+        };
+        for (size_t u = desde; u < hasta; ++u) {
+            const ConsultaBooleana& consulta = analizadas[unicas[u]];
+            if (consulta.esTerminoSimple()) {
+                registrar(consulta.clausulas[0].alternativas[0].palabras[0], true, false);
+                continue;
+            }
+            for (const auto& clausula : consulta.clausulas) {
+                for (const auto& elemento : clausula.alternativas) {
+                    for (const auto& palabra : elemento.palabras) {
+                        // Las negadas no se puntúan, pero su conjunto se une igual
+                        registrar(palabra, false, elemento.palabras.size() == 1);
+                    }
+                }
             }
         }
 
-        if (archivoEncontrado.empty()) {
-            throw runtime_error("No se pudo encontrar el archivo: " + nombreArchivo);
+        const uint32_t universo = static_cast<uint32_t>(catalogoDe(indices).size());
+        compartidos.palabras.resize(palabras.size());
+        grupoHilos.paraCada(palabras.size(), [&](size_t p) {
+            TerminosCompartidos::Palabra& palabra = compartidos.palabras[p];
+            palabra.terminos = expandirPrefijo(*palabras[p], indices, conSinopsis[p]);
+            if (usosBooleanos[p] < 2) return;
+            for (size_t s = 0; s < palabra.terminos.titulos.size(); ++s) {
+                vector<ListaPostings> listas;
+                for (const auto& termino : palabra.terminos.titulos[s]) listas.push_back(termino.lista);
+                for (const auto& termino : palabra.terminos.sinopsis[s]) listas.push_back(termino.lista);
+                palabra.coincidencias.push_back(OperacionesPostings::fusionar(listas, universo));
+            }
+        });
+        return compartidos;
+    }
+
+    /**
+     * @brief Todos los resultados de buscarPorTituloOSinopsis, ordenados, sin pasar por la caché
+     */
+    ResultadosBusqueda puntuarTituloOSinopsis(const ConsultaBooleana& consulta, const string& filtroTags) const {
+        const IndicesPublicados* indices = publicados.load(memory_order_acquire);
+        const EstadisticasDocumentos& estadisticas = estadisticasDe(indices);
+        vector<uint64_t> bits;
+        const vector<uint64_t>* filtro = prepararFiltro(filtroTags, indices, bits);
+        if (!consulta.esTerminoSimple()) {
+            ResultadosBusqueda resultados = buscarBooleana(consulta, indices);
+            if (filtro) aplicarFiltro(resultados, *filtro);
+            EvaluadorTopK::seleccionarMejores(resultados, resultados.size());
+            return resultados;
+        }
+        const string& termino = consulta.clausulas[0].alternativas[0].palabras[0];
+        const TerminosPrefijo expansion = expandirPrefijo(termino, indices);
+
+        auto puntuarTitulos = [this, indices, &expansion]() { return puntuarCampo(expansion.titulos, indices); };
+        auto puntuarSinopsis = [this, indices, &expansion]() { return puntuarCampo(expansion.sinopsis, indices); };
+
+        // Con pocas postings los dos campos se puntúan aquí mismo; si no, la sinopsis va a otro hilo
+        const bool enParalelo = grupoHilos.size() > 1 &&
+            (!indices || indices->postingsConPrefijo(termino) >= POSTINGS_MINIMAS_PARALELO);
+        ResultadosBusqueda parcialTitulos;
+        ResultadosBusqueda parcialSinopsis;
+        if (enParalelo) {
+            future<ResultadosBusqueda> futureSinopsis = grupoHilos.enviar(puntuarSinopsis);
+            parcialTitulos = puntuarTitulos();
+            parcialSinopsis = grupoHilos.esperar(futureSinopsis);
+        } else {
+            parcialTitulos = puntuarTitulos();
+            parcialSinopsis = puntuarSinopsis();
         }
 
-        ifstream archivo(archivoEncontrado);
-        if (!archivo.is_open()) {
-            throw runtime_error("No se puede abrir el archivo: " + archivoEncontrado);
+        thread_local AcumuladorPuntuaciones acumulador;
+        acumulador.preparar(catalogoDe(indices).size());
+        for (const auto& r : parcialTitulos) acumulador.sumar(r.id, r.puntuacion);
+        for (const auto& r : parcialSinopsis) acumulador.sumar(r.id, r.puntuacion);
+
+        // Campo tags: solo refuerza candidatos que ya coinciden en título o sinopsis
+        const vector<uint32_t> conTag = idsConTag(termino, indices);
+        if (!conTag.empty()) {
+            const double idfTag = SistemaPuntuacion::PESO_TAG *
+                                  SistemaPuntuacion::idf(conTag.size(), estadisticas.totalDocumentos);
+            for (uint32_t id : conTag) {
+                if (acumulador.contiene(id)) {
+                    acumulador.sumar(id, idfTag * SistemaPuntuacion::saturacion(1, estadisticas.tags.normalizacion[id]));
+                }
+            }
         }
 
-        string linea;
-        getline(archivo, linea); // Saltar cabecera
+        const uint64_t hashTermino = SistemaPuntuacion::hashTexto(termino);
+        for (uint32_t id : acumulador.idsTocados()) {
+            if (estadisticas.hashTitulo[id] == hashTermino) {
+                acumulador.sumar(id, SistemaPuntuacion::BONUS_TITULO_EXACTO);
+            }
+        }
 
-        while (getline(archivo, linea)) {
-            if (linea.empty()) continue;
+        ResultadosBusqueda resultados = acumulador.extraer();
+        if (filtro) aplicarFiltro(resultados, *filtro);
+        sort(resultados.begin(), resultados.end(), [](const ResultadoBusqueda& a, const ResultadoBusqueda& b) {
+            return a.puntuacion > b.puntuacion;
+        });
+        return resultados;
+    }
 
-            try {
-                Pelicula pelicula = procesarLinea(linea);
-                peliculas.push_back(pelicula);
-            } catch (const exception& e) {
-                cerr << "Error procesando línea: " << e.what() << endl;
-                continue;
+    /**
+     * @brief Página de buscarDifusa para un único término, sin pasar por la caché
+     */
+    ResultadosBusqueda puntuarDifusa(const string& termino, size_t k, uint32_t maxDistancia, size_t offset,
+                                     const string& filtroTags, size_t presupuestoNodos) const {
+        const IndicesPublicados* indices = publicados.load(memory_order_acquire);
+        const size_t limite = min(k, numeric_limits<size_t>::max() - offset) + offset;
+        vector<uint64_t> bits;
+        const vector<uint64_t>* filtro = prepararFiltro(filtroTags, indices, bits);
+        ResultadosBusqueda resultados = evaluarPrefijo(termino, indices, limite, filtro);
+
+        const uint32_t distanciaMaxima = min(maxDistancia, distanciaAdmitida(termino.size()));
+        if (resultados.size() < limite && distanciaMaxima > 0) {
+            size_t presupuesto = presupuestoNodos;
+            vector<vector<TerminoConsulta>> porDistancia = terminosDifusos(termino, distanciaMaxima, indices,
+                                                                           presupuesto);
+            // Cada película aparece solo en el grupo de su menor distancia
+            vector<uint64_t> admitidas = filtro ? *filtro
+                                                : vector<uint64_t>((catalogoDe(indices).size() + 63) / 64, ~0ULL);
+            for (const auto& resultado : resultados) {
+                admitidas[resultado.id >> 6] &= ~(1ULL << (resultado.id & 63));
+            }
+            for (uint32_t distancia = 1; distancia <= distanciaMaxima && resultados.size() < limite; ++distancia) {
+                const ResultadosBusqueda grupo = EvaluadorTopK::evaluar(
+                    move(porDistancia[distancia]), {}, nullptr, 0, limite - resultados.size(),
+                    estadisticasDe(indices).totalDocumentos, &admitidas);
+                for (const auto& resultado : grupo) {
+                    admitidas[resultado.id >> 6] &= ~(1ULL << (resultado.id & 63));
+                    resultados.push_back(resultado);
+                }
             }
         }
+        resultados.erase(resultados.begin(), resultados.begin() + min(offset, resultados.size()));
+        return resultados;
+    }
 
-        return peliculas;
+    /**
+     * @brief Clave de la caché: tipo de búsqueda, ventana de resultados, consulta y filtro normalizados
+     */
+    static string claveCache(char tipo, const ConsultaBooleana& consulta, const string& filtroTags, size_t k,
+                             size_t offset, const string& opciones = "") {
+        string clave(1, tipo);
+        clave += to_string(k) + ':' + to_string(offset) + ':' + opciones + '\x1f' + consulta.clave() + '\x1f';
+        if (filtroTags.find_first_not_of(" \t") != string::npos) {
+            clave += ConsultaBooleana::analizarTags(filtroTags).clave();
+        }
+        return clave;
     }
 
-    // FUNCIÓN CORREGIDA PARA PROCESAR LÍNEAS
-    Pelicula procesarLinea(const string& linea) {
-        stringstream ss(linea);
-        Pelicula pelicula;
+    /**
+     * @brief Top-'limite' de una consulta ya analizada, sin medir ni imprimir (buscar y buscarLote)
+     */
+    ResultadosBusqueda evaluarConsulta(const ConsultaBooleana& consulta, const IndicesPublicados* indices,
+                                       size_t limite, const vector<uint64_t>* filtro,
+                                       const TerminosCompartidos* compartidos = nullptr) const {
+        if (consulta.esTerminoSimple()) {
+            return evaluarPrefijo(consulta.clausulas[0].alternativas[0].palabras[0], indices, limite, filtro,
+                                  compartidos);
+        }
+        ResultadosBusqueda resultados = buscarBooleana(consulta, indices, compartidos);
+        if (filtro) aplicarFiltro(resultados, *filtro);
+        EvaluadorTopK::seleccionarMejores(resultados, limite);
+        return resultados;
+    }
 
-        getline(ss, pelicula.titulo, ';');
-        getline(ss, pelicula.sinopsis, ';');
+    /**
+     * @brief Top-'limite' BM25 de las palabras con el prefijo en títulos y sinopsis, más tags y título exacto
+     *
+     * Con varios segmentos cada uno calcula su propio top-'limite' (en paralelo si
+     * las postings lo justifican) y se mezclan.
+     *
+     * @param compartidos Expansiones ya resueltas por buscarLote (nullptr = expandir aquí)
+     */
+    ResultadosBusqueda evaluarPrefijo(const string& termino, const IndicesPublicados* indices, size_t limite,
+                                      const vector<uint64_t>* filtro,
+                                      const TerminosCompartidos* compartidos = nullptr) const {
+        const EstadisticasDocumentos& estadisticas = estadisticasDe(indices);
+        const size_t total = estadisticas.totalDocumentos;
+        TerminosPrefijo propia;
+        const TerminosPrefijo& expansion = compartidos ? compartidos->buscar(termino)->terminos
+                                                       : (propia = expandirPrefijo(termino, indices));
+        auto terminosDe = [&expansion](size_t s) {
+            vector<TerminoConsulta> terminos = expansion.titulos[s];
+            terminos.insert(terminos.end(), expansion.sinopsis[s].begin(), expansion.sinopsis[s].end());
+            return terminos;
+        };
 
-        string tags_str;
-        getline(ss, tags_str, ';');
-        pelicula.tags = procesarTags(tags_str); // Función corregida
+        const vector<uint32_t> idsTag = idsConTag(termino, indices);
+        const double pesoIdfTag = SistemaPuntuacion::PESO_TAG * SistemaPuntuacion::idf(idsTag.size(), total);
+        const double cotaTag = pesoIdfTag * SistemaPuntuacion::saturacion(
+            1, estadisticas.tags.longitudMinima, estadisticas.tags.longitudPromedio);
+        auto refuerzosEntre = [&](uint32_t desde, uint32_t hasta) {
+            vector<TerminoConsulta> refuerzos;
+            const auto inicio = lower_bound(idsTag.begin(), idsTag.end(), desde);
+            const auto fin = lower_bound(inicio, idsTag.end(), hasta);
+            if (inicio != fin) {
+                refuerzos.push_back({ListaPostings(&*inicio, nullptr, static_cast<uint32_t>(fin - inicio)),
+                                     &estadisticas.tags, pesoIdfTag, cotaTag});
+            }
+            return refuerzos;
+        };
+        const uint64_t hashTermino = SistemaPuntuacion::hashTexto(termino);
 
-        getline(ss, pelicula.split, ';');
-        getline(ss, pelicula.fuente_sinopsis, ';');
+        if (!indices) {
+            return EvaluadorTopK::evaluar(terminosDe(0), refuerzosEntre(0, UINT32_MAX), &estadisticas.hashTitulo,
+                                          hashTermino, limite, total, filtro);
+        }
 
-        pelicula.titulo = limpiarTexto(pelicula.titulo);
-        pelicula.sinopsis = limpiarTexto(pelicula.sinopsis);
+        const auto& segmentos = indices->segmentos;
+        vector<ResultadosBusqueda> parciales(segmentos.size());
+        auto evaluarSegmento = [&](size_t s) {
+            const SegmentoIndice& segmento = *segmentos[s];
+            parciales[s] = EvaluadorTopK::evaluar(terminosDe(s), refuerzosEntre(segmento.primerId, segmento.finId),
+                                                  &estadisticas.hashTitulo, hashTermino, limite, total, filtro);
+        };
+        if (segmentos.size() > 1 && grupoHilos.size() > 1 &&
+            indices->postingsConPrefijo(termino) >= POSTINGS_MINIMAS_PARALELO) {
+            grupoHilos.paraCada(segmentos.size(), evaluarSegmento);
+        } else {
+            for (size_t s = 0; s < segmentos.size(); ++s) evaluarSegmento(s);
+        }
+        if (parciales.size() == 1) return move(parciales[0]);
 
-        return pelicula;
+        ResultadosBusqueda resultados;
+        for (const auto& parcial : parciales) resultados.insert(resultados.end(), parcial.begin(), parcial.end());
+        EvaluadorTopK::seleccionarMejores(resultados, limite);
+        return resultados;
     }
 
-    // NUEVA FUNCIÓN PARA PROCESAR TAGS CORRECTAMENTE
-    vector<string> procesarTags(const string& tags_str) {
-        vector<string> tags;
-        stringstream ss(tags_str);
-        string tag;
-
-        // Separar por comas
-        while (getline(ss, tag, ',')) {
-            // Limpiar espacios y normalizar
-            tag = limpiarTexto(tag);
-            if (!tag.empty()) {
-                // Normalizar el tag (minúsculas)
-                string tagNormalizado = normalizarTag(tag);
-                tags.push_back(tagNormalizado);
+    /**
+     * @brief Términos BM25 de las palabras a distancia 1..maxDistancia del prefijo, agrupados por distancia
+     *
+     * Todos los Tries (de cada segmento) comparten el presupuesto de nodos; si se
+     * agota, los grupos quedan con lo encontrado hasta ese momento.
+     */
+    vector<vector<TerminoConsulta>> terminosDifusos(const string& termino, uint32_t maxDistancia,
+                                                    const IndicesPublicados* indices, size_t& presupuesto) const {
+        const EstadisticasDocumentos& estadisticas = estadisticasDe(indices);
+        const size_t total = estadisticas.totalDocumentos;
+        vector<vector<TerminoConsulta>> porDistancia(maxDistancia + 1);
+        auto recolector = [&porDistancia, indices, total](TrieCongelado SegmentoIndice::*campo,
+                                                          const EstadisticasCampo& estadisticasCampo, double peso) {
+            return [&porDistancia, indices, campo, &estadisticasCampo, peso, total](
+                       string_view palabra, const ListaPostings& lista, uint16_t maxFrecuencia, uint32_t distancia) {
+                porDistancia[distancia].push_back(terminoBM25(lista, maxFrecuencia, estadisticasCampo, peso,
+                                                              frecuenciaGlobal(indices, campo, palabra, lista.df),
+                                                              total));
+            };
+        };
+        auto titulos = recolector(&SegmentoIndice::titulos, estadisticas.titulo, SistemaPuntuacion::PESO_TITULO);
+        auto sinopsis = recolector(&SegmentoIndice::sinopsis, estadisticas.sinopsis, SistemaPuntuacion::PESO_SINOPSIS);
+        if (indices) {
+            for (const auto& segmento : indices->segmentos) {
+                segmento->titulos.recorrerDifusos(termino, maxDistancia, presupuesto, titulos);
             }
+            for (const auto& segmento : indices->segmentos) {
+                segmento->sinopsis.recorrerDifusos(termino, maxDistancia, presupuesto, sinopsis);
+            }
+        } else {
+            indiceTitulos.recorrerDifusos(termino, maxDistancia, presupuesto, titulos);
+            indiceSinopsis.recorrerDifusos(termino, maxDistancia, presupuesto, sinopsis);
         }
-
-        return tags;
+        return porDistancia;
     }
 
-    // FUNCIÓN PARA NORMALIZAR TAGS
-    string normalizarTag(const string& tag)  {
-        string tagNormalizado = limpiarTexto(tag);
-        transform(tagNormalizado.begin(), tagNormalizado.end(), tagNormalizado.begin(), ::tolower);
-        return tagNormalizado;
+    /**
+     * @brief Errores tolerados según el largo de la palabra: con 1 o 2 letras cualquier
+     *        error coincide con medio Trie, y con 3 a 5 dos errores cambian la palabra
+     */
+    static uint32_t distanciaAdmitida(size_t largo) {
+        return largo <= 2 ? 0 : (largo <= 5 ? 1 : 2);
     }
 
-    vector<string> splitString(const string& str, char delimiter) {
-        vector<string> tokens;
-        stringstream ss(str);
-        string token;
-
-        while (getline(ss, token, delimiter)) {
-            token = limpiarTexto(token);
-            if (!token.empty()) {
-                tokens.push_back(token);
-            }
+    /**
+     * @brief Bitmap plano de los IDs admitidos: cumplen filtroTags y no están borrados
+     *
+     * @param bits Almacenamiento del bitmap si hay que construirlo
+     * @return nullptr si se admiten todos los IDs
+     */
+    const vector<uint64_t>* prepararFiltro(const string& filtroTags, const IndicesPublicados* indices,
+                                           vector<uint64_t>& bits) const {
+        const bool conBorradas = indices && indices->borradas > 0;
+        if (filtroTags.find_first_not_of(" \t") == string::npos) {
+            return conBorradas ? &indices->vigentes : nullptr;
         }
-
-        return tokens;
+        bits.assign((catalogoDe(indices).size() + 63) / 64, 0);
+        conjuntoDeTags(filtroTags, indices).vista().marcar(bits);
+        if (conBorradas) {
+            for (size_t i = 0; i < bits.size(); ++i) bits[i] &= indices->vigentes[i];
+        }
+        return &bits;
     }
 
-    string limpiarTexto(const string& texto) {
-        string resultado = texto;
-
-        // Eliminar espacios al inicio y final
-        resultado.erase(resultado.begin(), find_if(resultado.begin(), resultado.end(), [](unsigned char ch) {
-            return !isspace(ch);
-        }));
-        resultado.erase(find_if(resultado.rbegin(), resultado.rend(), [](unsigned char ch) {
-            return !isspace(ch);
-        }).base(), resultado.end());
-
-        return resultado;
+    static void aplicarFiltro(ResultadosBusqueda& resultados, const vector<uint64_t>& bits) {
+        resultados.erase(remove_if(resultados.begin(), resultados.end(), [&bits](const ResultadoBusqueda& r) {
+            return !((bits[r.id >> 6] >> (r.id & 63)) & 1);
+        }), resultados.end());
     }
 
-    void indexarPeliculasConcurrente() {
-        const size_t numHilos = thread::hardware_concurrency();
-        const size_t peliculasPorHilo = peliculas.size() / numHilos;
-
-        vector<thread> hilos;
-
-        for (size_t i = 0; i < numHilos; ++i) {
-            size_t inicio = i * peliculasPorHilo;
-            size_t fin = (i == numHilos - 1) ? peliculas.size() : (i + 1) * peliculasPorHilo;
-
-            hilos.emplace_back([this, inicio, fin]() {
-                for (size_t j = inicio; j < fin; ++j) {
-                    indexarPelicula(peliculas[j]);
-                }
-            });
+    /**
+     * @brief Suma el BM25 de los términos de un campo (de todos los segmentos), solo en 'coincidencias'
+     */
+    void puntuarCoincidencias(const vector<vector<TerminoConsulta>>& porSegmento,
+                              const vector<uint32_t>& coincidencias, vector<double>& puntuaciones,
+                              const IndicesPublicados* indices) const {
+        thread_local IndiceCandidatos indice;
+        indice.preparar(coincidencias, static_cast<uint32_t>(catalogoDe(indices).size()));
+        for (const auto& terminos : porSegmento) {
+            for (const auto& termino : terminos) {
+                indice.intersectar(termino.lista, [&](size_t i, uint16_t frecuencia) {
+                    puntuaciones[i] += termino.contribucion(coincidencias[i], frecuencia);
+                });
+            }
         }
+        indice.liberar();
+    }
 
-        for (auto& hilo : hilos) {
-            hilo.join();
+    /**
+     * @brief Acumula la contribución BM25 de los términos de un campo (de todos los segmentos)
+     */
+    ResultadosBusqueda puntuarCampo(const vector<vector<TerminoConsulta>>& porSegmento,
+                                    const IndicesPublicados* indices) const {
+        thread_local AcumuladorPuntuaciones acumulador;
+        acumulador.preparar(catalogoDe(indices).size());
+        for (const auto& terminos : porSegmento) {
+            for (const auto& termino : terminos) {
+                termino.lista.recorrer([&](const uint32_t* ids, const uint16_t* frecuencias, uint32_t cantidad) {
+                    for (uint32_t k = 0; k < cantidad; ++k) {
+                        acumulador.sumar(ids[k], termino.contribucion(ids[k], frecuencias[k]));
+                    }
+                });
+            }
         }
+        return acumulador.extraer();
     }
 
     // FUNCIÓN CORREGIDA PARA INDEXAR PELÍCULA
-    void indexarPelicula(Pelicula& pelicula) {
-        // Indexar título por palabras
-        istringstream titleStream(pelicula.titulo);
-        string palabra;
-        while (titleStream >> palabra) {
-            indiceTitulos.insertar(palabra, &pelicula);
-        }
-
-        // Indexar sinopsis por palabras
-        istringstream synopsisStream(pelicula.sinopsis);
-        while (synopsisStream >> palabra) {
-            indiceSinopsis.insertar(palabra, &pelicula);
-        }
+    // Indexa título y sinopsis con el ID local del fragmento; los tags se indexan
+    // después, cuando la película ya está en su posición definitiva
+    void indexarPelicula(const RegistroPelicula& pelicula, uint32_t id, FragmentoCarga& destino) {
+        uint32_t palabrasTitulo = 0;
+        uint32_t palabrasSinopsis = 0;
+
+        // Las consultas pasan por el mismo NormalizadorTexto (ConsultaBooleana::analizar)
+        thread_local string buffer;
+        NormalizadorTexto::paraCadaToken(pelicula.titulo, buffer, [&](string_view palabra) {
+            destino.indices.titulos.insertar(palabra, id, palabrasTitulo++);
+        });
+        // Una palabra vacía conserva su posición para que las frases sigan midiendo distancias reales
+        NormalizadorTexto::paraCadaToken(pelicula.sinopsis, buffer, [&](string_view palabra) {
+            if (palabrasVacias.contiene(palabra)) {
+                ++destino.aparicionesOmitidas;
+                ++palabrasSinopsis;
+                return;
+            }
+            destino.indices.sinopsis.insertar(palabra, id, palabrasSinopsis++);
+        });
 
-        // INDEXAR TAGS CORRECTAMENTE
-        for (const auto& tag : pelicula.tags) {
-            // Cada tag ya está normalizado desde procesarTags()
-            indiceTags.agregar(tag, &pelicula);
-        }
+        destino.estadisticas.titulo.longitudes[id] = palabrasTitulo;
+        destino.estadisticas.sinopsis.longitudes[id] = palabrasSinopsis;
+        destino.estadisticas.tags.longitudes[id] = pelicula.cantidadTags;
+        destino.estadisticas.hashTitulo[id] = SistemaPuntuacion::hashTexto(NormalizadorTexto::normalizar(pelicula.titulo));
     }
 };
 
@@ -481,9 +8036,15 @@ private:
  */
 class InterfazUsuario {
 private:
+    using ProveedorPagina = function<ResultadosBusqueda(size_t inicio, size_t cantidad)>;
+
+    // Errores de tipeo tolerados en las búsquedas de una palabra
+    static constexpr uint32_t DISTANCIA_DIFUSA = 2;
+
     GestorPeliculas& gestor;
-    unordered_set<string> peliculasLike;
-    unordered_set<string> peliculasVerMasTarde;
+    // Por ID en el catálogo: los likes se usan tal cual para recomendar
+    unordered_set<uint32_t> peliculasLike;
+    unordered_set<uint32_t> peliculasVerMasTarde;
     vector<string> historialBusquedas;
 
 public:
@@ -566,59 +8127,138 @@ private:
         cout << "BÚSQUEDA DE PELÍCULAS\n";
         cout << string(40, '-') << "\n";
         cout << "[1] Buscar por título/sinopsis\n";
-        cout << "[2] Buscar por tag\n";
+        cout << "[2] Buscar por tags\n";
+        cout << "[3] Buscar por título/sinopsis filtrando por tags\n";
+        cout << "[4] Autocompletar título\n";
         cout << "Seleccione tipo de búsqueda: ";
 
         int tipoBusqueda = leerOpcion();
 
-        vector<Pelicula*> resultados;
+        ProveedorPagina obtenerPagina;
+        size_t total = 0;
         string termino;
 
         if (tipoBusqueda == 1) {
+            cout << "(Admite \"frase exacta\", OR, -palabra o NOT palabra)\n";
             cout << "Ingrese término de búsqueda: ";
             cin.ignore();
             getline(cin, termino);
 
             historialBusquedas.push_back(termino);
-            resultados = gestor.buscarPorTituloOSinopsis(termino);
+            obtenerPagina = paginarBusqueda(termino);
 
         } else if (tipoBusqueda == 2) {
-            cout << "Ingrese tag: ";
+            cout << "(Admite horror AND comedy, drama OR romance y NOT tag o -tag)\n";
+            cout << "Ingrese tags: ";
+            cin.ignore();
+            getline(cin, termino);
+
+            auto resultados = make_shared<const ResultadosBusqueda>(gestor.buscarPorTags(termino));
+            obtenerPagina = paginarVector(resultados);
+            total = resultados->size();
+        } else if (tipoBusqueda == 3) {
+            cout << "Ingrese término de búsqueda: ";
             cin.ignore();
             getline(cin, termino);
+            cout << "Ingrese filtro de tags: ";
+            string filtroTags;
+            getline(cin, filtroTags);
 
-            resultados = gestor.buscarPorTag(termino);
+            historialBusquedas.push_back(termino);
+            obtenerPagina = paginarBusqueda(termino, filtroTags);
+        } else if (tipoBusqueda == 4) {
+            autocompletarTitulo();
+            return;
         } else {
             cout << "Opción no válida\n";
             return;
         }
 
-        if (resultados.empty()) {
-            cout << "No se encontraron resultados para: " << termino << "\n";
+        mostrarResultadosPaginados(obtenerPagina, total, termino);
+    }
+
+    void autocompletarTitulo() {
+        cout << "Ingrese el comienzo del título: ";
+        cin.ignore();
+        string texto;
+        getline(cin, texto);
+
+        auto inicio = chrono::high_resolution_clock::now();
+        auto sugerencias = gestor.autocompletar(texto, 10);
+        auto duracion = chrono::duration_cast<chrono::microseconds>(chrono::high_resolution_clock::now() - inicio);
+
+        if (sugerencias.empty()) {
+            cout << "Ningún título se completa con: " << texto << "\n";
             return;
         }
 
-        mostrarResultadosPaginados(resultados);
+        cout << "Sugerencias en " << duracion.count() << " μs:\n\n";
+        for (size_t i = 0; i < sugerencias.size(); ++i) {
+            cout << i + 1 << ". " << gestor.obtenerPelicula(sugerencias[i].id).titulo << "\n";
+        }
+
+        cout << "\n[#] Seleccionar película | [0] Volver: ";
+        int seleccion = leerOpcion();
+
+        if (seleccion > 0 && seleccion <= static_cast<int>(sugerencias.size())) {
+            mostrarSinopsis(sugerencias[seleccion - 1].id);
+        }
+    }
+
+    /**
+     * @brief Cada página es una consulta top-K: solo se ordenan los resultados visibles
+     *
+     * Las búsquedas de una palabra toleran errores de tipeo; las coincidencias
+     * exactas siempre van primero (ver GestorPeliculas::buscarDifusa).
+     */
+    ProveedorPagina paginarBusqueda(const string& termino, const string& filtroTags = "") const {
+        return [this, termino, filtroTags](size_t inicio, size_t cantidad) {
+            return gestor.buscarDifusa(termino, cantidad, DISTANCIA_DIFUSA, inicio, filtroTags);
+        };
+    }
+
+    static ProveedorPagina paginarVector(shared_ptr<const ResultadosBusqueda> resultados) {
+        return [resultados](size_t inicio, size_t cantidad) {
+            size_t fin = min(inicio + cantidad, resultados->size());
+            return inicio < fin ? ResultadosBusqueda(resultados->begin() + inicio, resultados->begin() + fin)
+                                : ResultadosBusqueda{};
+        };
     }
 
-    void mostrarResultadosPaginados(const vector<Pelicula*>& resultados) {
+    /**
+     * @brief Muestra resultados de 5 en 5 pidiendo cada página al proveedor
+     *
+     * Se pide un resultado extra por página para saber si existe una siguiente.
+     *
+     * @param total Número total de resultados si se conoce (0 = desconocido)
+     */
+    void mostrarResultadosPaginados(const ProveedorPagina& obtenerPagina, size_t total, const string& termino) {
         const size_t peliculasPorPagina = 5;
         size_t inicio = 0;
+        ResultadosBusqueda pagina = obtenerPagina(inicio, peliculasPorPagina + 1);
+
+        if (pagina.empty()) {
+            cout << "No se encontraron resultados para: " << termino << "\n";
+            return;
+        }
+
+        while (!pagina.empty()) {
+            const bool haySiguiente = pagina.size() > peliculasPorPagina;
+            const size_t enPagina = min(pagina.size(), peliculasPorPagina);
 
-        while (inicio < resultados.size()) {
             cout << "\n" << string(60, '-') << "\n";
-            cout << "RESULTADOS (" << inicio + 1 << "-"
-                 << min(inicio + peliculasPorPagina, resultados.size())
-                 << " de " << resultados.size() << ")\n";
+            cout << "RESULTADOS (" << inicio + 1 << "-" << inicio + enPagina;
+            if (total > 0) {
+                cout << " de " << total;
+            }
+            cout << ")\n";
             cout << string(60, '-') << "\n";
 
-            size_t fin = min(inicio + peliculasPorPagina, resultados.size());
-
-            for (size_t i = inicio; i < fin; ++i) {
-                cout << "[" << i + 1 << "] " << resultados[i]->titulo;
-                if (resultados[i]->relevancia > 0) {
+            for (size_t i = 0; i < enPagina; ++i) {
+                cout << "[" << inicio + i + 1 << "] " << gestor.obtenerPelicula(pagina[i].id).titulo;
+                if (pagina[i].puntuacion > 0) {
                     cout << " (Relevancia: " << fixed << setprecision(2)
-                         << resultados[i]->relevancia << ")";
+                         << pagina[i].puntuacion << ")";
                 }
                 cout << "\n";
             }
@@ -631,22 +8271,24 @@ private:
             if (opcion == "0") {
                 break;
             } else if (opcion == "N" || opcion == "n") {
-                if (inicio + peliculasPorPagina < resultados.size()) {
+                if (haySiguiente) {
                     inicio += peliculasPorPagina;
+                    pagina = obtenerPagina(inicio, peliculasPorPagina + 1);
                 } else {
                     cout << "No hay más resultados.\n";
                 }
             } else if (opcion == "A" || opcion == "a") {
                 if (inicio >= peliculasPorPagina) {
                     inicio -= peliculasPorPagina;
+                    pagina = obtenerPagina(inicio, peliculasPorPagina + 1);
                 } else {
                     cout << "Ya está en la primera página.\n";
                 }
             } else {
                 try {
                     int seleccion = stoi(opcion);
-                    if (seleccion > 0 && seleccion <= static_cast<int>(resultados.size())) {
-                        mostrarSinopsis(*resultados[seleccion - 1]);
+                    if (seleccion > static_cast<int>(inicio) && seleccion <= static_cast<int>(inicio + enPagina)) {
+                        mostrarSinopsis(pagina[seleccion - 1 - inicio].id);
                     } else {
                         cout << "Selección inválida.\n";
                     }
@@ -657,7 +8299,8 @@ private:
         }
     }
 
-    void mostrarSinopsis(const Pelicula& pelicula) {
+    void mostrarSinopsis(uint32_t id) {
+        const Pelicula pelicula = gestor.obtenerPelicula(id);
         cout << "\n" << string(80, '=') << "\n";
         cout << "TÍTULO: " << pelicula.titulo << "\n";
         cout << string(80, '=') << "\n";
@@ -665,7 +8308,7 @@ private:
         cout << string(80, '-') << "\n";
         cout << "TAGS: ";
         for (size_t i = 0; i < pelicula.tags.size(); ++i) {
-            cout << pelicula.tags[i];
+            cout << gestor.getCatalogo().nombreTag(pelicula.tags[i]);
             if (i < pelicula.tags.size() - 1) cout << ", ";
         }
         cout << "\n";
@@ -673,23 +8316,54 @@ private:
         cout << "FUENTE: " << pelicula.fuente_sinopsis << "\n";
         cout << string(80, '=') << "\n";
 
-        cout << "\n[1] Like | [2] Ver más tarde | [0] Volver: ";
+        cout << "\n[1] Like | [2] Ver más tarde | [3] Películas similares | [0] Volver: ";
         int opcion = leerOpcion();
 
         switch (opcion) {
             case 1:
-                peliculasLike.insert(pelicula.titulo);
+                peliculasLike.insert(id);
                 cout << "✓ Película añadida a favoritos\n";
                 break;
             case 2:
-                peliculasVerMasTarde.insert(pelicula.titulo);
+                peliculasVerMasTarde.insert(id);
                 cout << "✓ Película añadida a 'Ver más tarde'\n";
                 break;
+            case 3:
+                mostrarSimilares(id);
+                break;
             default:
                 break;
         }
     }
 
+    void mostrarSimilares(uint32_t id) {
+        cout << "\n" << string(50, '-') << "\n";
+        cout << "PELÍCULAS SIMILARES A '" << gestor.obtenerPelicula(id).titulo << "'\n";
+        cout << string(50, '-') << "\n";
+
+        auto inicio = chrono::high_resolution_clock::now();
+        auto similares = gestor.buscarSimilares(id, 10);
+        auto duracion = chrono::duration_cast<chrono::microseconds>(chrono::high_resolution_clock::now() - inicio);
+
+        if (similares.empty()) {
+            cout << "No se encontraron películas con una sinopsis parecida.\n";
+            return;
+        }
+
+        cout << "Encontradas en " << duracion.count() << " μs:\n\n";
+        for (size_t i = 0; i < similares.size(); ++i) {
+            cout << i + 1 << ". " << gestor.obtenerPelicula(similares[i].id).titulo
+                 << " (Similitud: " << fixed << setprecision(2) << similares[i].puntuacion << ")\n";
+        }
+
+        cout << "\n[#] Seleccionar película | [0] Volver: ";
+        int seleccion = leerOpcion();
+
+        if (seleccion > 0 && seleccion <= static_cast<int>(similares.size())) {
+            mostrarSinopsis(similares[seleccion - 1].id);
+        }
+    }
+
     void mostrarPeliculasVerMasTarde() {
         cout << "\n" << string(50, '-') << "\n";
         cout << "PELÍCULAS EN 'VER MÁS TARDE'\n";
@@ -701,8 +8375,8 @@ private:
         }
 
         int contador = 1;
-        for (const auto& titulo : peliculasVerMasTarde) {
-            cout << contador++ << ". " << titulo << "\n";
+        for (uint32_t id : peliculasVerMasTarde) {
+            cout << contador++ << ". " << gestor.obtenerPelicula(id).titulo << "\n";
         }
 
         cout << "\n[#] Seleccionar película | [0] Volver: ";
@@ -711,13 +8385,7 @@ private:
         if (seleccion > 0 && seleccion <= static_cast<int>(peliculasVerMasTarde.size())) {
             auto it = peliculasVerMasTarde.begin();
             advance(it, seleccion - 1);
-
-            for (const auto& pelicula : gestor.getPeliculas()) {
-                if (pelicula.titulo == *it) {
-                    mostrarSinopsis(pelicula);
-                    break;
-                }
-            }
+            mostrarSinopsis(*it);
         }
     }
 
@@ -731,7 +8399,7 @@ private:
             return;
         }
 
-        auto recomendaciones = generarRecomendaciones();
+        auto recomendaciones = generarRecomendaciones(10);
 
         if (recomendaciones.empty()) {
             cout << "No se encontraron recomendaciones en este momento.\n";
@@ -740,16 +8408,16 @@ private:
 
         cout << "Películas recomendadas para ti:\n\n";
         for (size_t i = 0; i < min(size_t(10), recomendaciones.size()); ++i) {
-            cout << i + 1 << ". " << recomendaciones[i]->titulo
+            cout << i + 1 << ". " << gestor.obtenerPelicula(recomendaciones[i].id).titulo
                  << " (Puntuación: " << fixed << setprecision(2)
-                 << recomendaciones[i]->relevancia << ")\n";
+                 << recomendaciones[i].puntuacion << ")\n";
         }
 
         cout << "\n[#] Seleccionar película | [0] Volver: ";
         int seleccion = leerOpcion();
 
         if (seleccion > 0 && seleccion <= static_cast<int>(min(size_t(10), recomendaciones.size()))) {
-            mostrarSinopsis(*recomendaciones[seleccion - 1]);
+            mostrarSinopsis(recomendaciones[seleccion - 1].id);
         }
     }
 
@@ -774,59 +8442,458 @@ private:
             string termino = historialBusquedas[seleccion - 1];
             cout << "Repitiendo búsqueda: " << termino << "\n";
 
-            auto resultados = gestor.buscarPorTituloOSinopsis(termino);
-            if (!resultados.empty()) {
-                mostrarResultadosPaginados(resultados);
-            } else {
-                cout << "No se encontraron resultados.\n";
-            }
+            mostrarResultadosPaginados(paginarBusqueda(termino), 0, termino);
         }
     }
     /**
-     * @brief Genera recomendaciones basadas en los likes del usuario
+     * @brief Genera recomendaciones basadas en los likes del usuario (ver GestorPeliculas::recomendar)
      *
-     * @return Vector de películas recomendadas ordenadas por relevancia
-     *
-     * Complejidad temporal: O(n * m) donde n es el número de películas y m el número de tags promedio
+     * @param k Número de recomendaciones a devolver
+     * @return IDs de películas recomendadas con su puntuación, ordenados de mayor a menor
      */
-    vector<Pelicula*> generarRecomendaciones() {
-        // Recopilar tags de películas con like
-        unordered_map<string, int> tagsPopulares;
-        for (const auto& pelicula : gestor.getPeliculas()) {
-            if (peliculasLike.count(pelicula.titulo)) {
-                for (const auto& tag : pelicula.tags) {
-                    tagsPopulares[tag]++;
-                }
+    ResultadosBusqueda generarRecomendaciones(size_t k) const {
+        return gestor.recomendar(vector<uint32_t>(peliculasLike.begin(), peliculasLike.end()), k);
+    }
+};
+
+/**
+ * @brief Mide el tiempo de arranque con 1, 2, 4, 8 y 16 hilos de indexación y desde la imagen,
+ *        y lo que ahorran las palabras vacías y la poda en el índice de sinopsis
+ *
+ * Uso: ./streaming_platform --bench-indexacion data.csv
+ */
+void ejecutarBenchmarkIndexacion(const string& nombreArchivo) {
+    vector<string> filas;
+    for (size_t hilos : {1, 2, 4, 8, 16}) {
+        GestorPeliculas gestor(nombreArchivo, false, hilos, false);
+        const MetricasArranque& m = gestor.obtenerMetricasArranque();
+
+        stringstream fila;
+        fila << setw(5) << hilos << setw(12) << m.cargaMs << setw(12) << m.indexacionMs
+             << setw(12) << m.congelacionMs << setw(12) << (m.cargaMs + m.indexacionMs + m.congelacionMs);
+        filas.push_back(fila.str());
+    }
+
+    cout << "\n=== BENCHMARK DE ARRANQUE (" << thread::hardware_concurrency() << " núcleos) ===\n";
+    cout << "Hilos    Carga ms  Indexar ms Congelar ms    Total ms\n";
+    for (const auto& fila : filas) {
+        cout << fila << "\n";
+    }
+
+    // El primer arranque escribe la imagen si falta o está desactualizada
+    { GestorPeliculas gestor(nombreArchivo); }
+    GestorPeliculas gestor(nombreArchivo);
+    if (gestor.obtenerMetricasArranque().desdeImagen) {
+        cout << "Arranque desde la imagen del índice: " << gestor.obtenerMetricasArranque().cargaMs << " ms\n";
+    }
+
+    const vector<pair<string, VocabularioSinopsis>> vocabularios = {
+        {"Completo", VocabularioSinopsis{{}, 1.0}},
+        {"Palabras vacías", VocabularioSinopsis()},
+        {"Vacías + df > 10%", VocabularioSinopsis{VocabularioSinopsis::palabrasVaciasIngles(), 0.1}},
+    };
+    filas.clear();
+    for (const auto& [nombre, vocabulario] : vocabularios) {
+        GestorPeliculas gestor(nombreArchivo, false, 0, false, 0, vocabulario);
+        const MetricasArranque& m = gestor.obtenerMetricasArranque();
+
+        stringstream fila;
+        fila << left << setw(20) << nombre << right << setw(12) << m.indexacionMs << setw(12) << m.congelacionMs
+             << setw(14) << gestor.memoriaPostingsSinopsis() / 1024
+             << setw(14) << m.aparicionesOmitidas + m.postingsPodados;
+        filas.push_back(fila.str());
+    }
+
+    cout << "\n=== VOCABULARIO DE SINOPSIS ===\n";
+    cout << "Vocabulario           Indexar ms Congelar ms  Postings KB     Omitidas\n";
+    for (const auto& fila : filas) {
+        cout << fila << "\n";
+    }
+}
+
+/**
+ * @brief Compara consultas por segundo de buscar (una por llamada) contra buscarLote
+ *
+ * Las consultas son títulos completos y su primera palabra, con películas
+ * repetidas como en un trabajo nocturno real. buscar se mide con y sin la
+ * caché de resultados, que buscarLote no usa. Uso: ./streaming_platform --bench-lote data.csv
+ */
+void ejecutarBenchmarkLote(const string& nombreArchivo) {
+    GestorPeliculas gestor(nombreArchivo);
+    const CatalogoPeliculas& catalogo = gestor.getCatalogo();
+    if (catalogo.size() == 0) return;
+
+    constexpr size_t CONSULTAS = 100000;
+    constexpr size_t K = 10;
+    vector<string> consultas;
+    consultas.reserve(CONSULTAS);
+    uint64_t estado = 12345;
+    for (size_t i = 0; i < CONSULTAS; ++i) {
+        estado = estado * 6364136223846793005ULL + 1442695040888963407ULL;
+        // La mitad de las consultas cae en el 10% de las películas
+        const size_t universo = (estado >> 63) ? catalogo.size() : max<size_t>(1, catalogo.size() / 10);
+        const string titulo(catalogo.titulo(static_cast<uint32_t>((estado >> 20) % universo)));
+        consultas.push_back((estado >> 62) & 1 ? titulo : titulo.substr(0, titulo.find(' ')));
+    }
+
+    // buscarLote no usa la caché de resultados: la comparación es contra buscar sin
+    // caché, y buscar con caché se mide aparte
+    streambuf* salida = cout.rdbuf(nullptr); // buscar imprime el tiempo de cada consulta
+    auto porLlamada = [&]() {
+        size_t total = 0;
+        for (const auto& consulta : consultas) {
+            total += gestor.buscar(consulta, K).size();
+        }
+        return total;
+    };
+    gestor.configurarCache(0);
+    auto inicio = chrono::high_resolution_clock::now();
+    const size_t totalIndividual = porLlamada();
+    auto finIndividual = chrono::high_resolution_clock::now();
+    gestor.configurarCache(CacheResultados::BYTES_DEFECTO);
+    porLlamada();
+    auto finConCache = chrono::high_resolution_clock::now();
+    cout.rdbuf(salida);
+
+    ResultadosLote lote;
+    gestor.buscarLote(consultas, K, lote);
+    auto finLote = chrono::high_resolution_clock::now();
+
+    auto qps = [](size_t n, chrono::high_resolution_clock::duration d) {
+        return static_cast<long long>(n / max(1e-9, chrono::duration<double>(d).count()));
+    };
+    cout << "\n=== BENCHMARK DE CONSULTAS POR LOTE (" << CONSULTAS << " consultas, top-" << K << ") ===\n";
+    cout << "Una por llamada, sin caché: " << qps(CONSULTAS, finIndividual - inicio) << " consultas/s\n";
+    cout << "Una por llamada, con caché: " << qps(CONSULTAS, finConCache - finIndividual) << " consultas/s\n";
+    cout << "buscarLote:                 " << qps(CONSULTAS, finLote - finConCache) << " consultas/s\n";
+    if (lote.resultados.size() != totalIndividual) {
+        cout << "Advertencia: los resultados no coinciden (" << lote.resultados.size() << " vs "
+             << totalIndividual << ")\n";
+    }
+}
+
+/**
+ * @brief Mide los ms por actualización (agregar, reemplazar y borrar) mientras otros hilos consultan
+ *
+ * Las películas nuevas son copias de las existentes con otro título. Al final
+ * se compactan todos los segmentos en uno y se mide cuánto tarda. Uso: ./streaming_platform --bench-actualizaciones data.csv
+ */
+void ejecutarBenchmarkActualizaciones(const string& nombreArchivo) {
+    GestorPeliculas gestor(nombreArchivo, false, 0, true);
+    const CatalogoPeliculas catalogo = gestor.getCatalogo();
+    if (catalogo.size() == 0) return;
+
+    constexpr size_t ACTUALIZACIONES = 3000;
+    constexpr size_t LECTORES = 2;
+    streambuf* salida = cout.rdbuf(nullptr); // buscar imprime el tiempo de cada consulta
+
+    atomic<bool> terminar{false};
+    atomic<size_t> consultas{0};
+    atomic<long long> peorConsultaUs{0};
+    vector<thread> lectores;
+    for (size_t l = 0; l < LECTORES; ++l) {
+        lectores.emplace_back([&, l]() {
+            for (uint32_t i = static_cast<uint32_t>(l); !terminar; i += LECTORES) {
+                const string titulo(catalogo.titulo(i % catalogo.size()));
+                auto inicio = chrono::high_resolution_clock::now();
+                gestor.buscar(titulo.substr(0, titulo.find(' ')), 10);
+                const long long us = chrono::duration_cast<chrono::microseconds>(
+                    chrono::high_resolution_clock::now() - inicio).count();
+                long long peor = peorConsultaUs;
+                while (us > peor && !peorConsultaUs.compare_exchange_weak(peor, us)) {}
+                ++consultas;
             }
+        });
+    }
+
+    vector<double> duraciones;
+    duraciones.reserve(ACTUALIZACIONES);
+    vector<uint32_t> agregadas;
+    uint64_t estado = 12345;
+    for (size_t i = 0; i < ACTUALIZACIONES; ++i) {
+        estado = estado * 6364136223846793005ULL + 1442695040888963407ULL;
+        const Pelicula original = catalogo.obtener(static_cast<uint32_t>((estado >> 20) % catalogo.size()));
+        DatosPelicula datos{string(original.titulo) + " " + to_string(i), string(original.sinopsis), {},
+                            string(original.split), string(original.fuente_sinopsis)};
+        for (IdTag tag : original.tags) datos.tags.emplace_back(catalogo.nombreTag(tag));
+
+        auto inicio = chrono::high_resolution_clock::now();
+        const uint32_t operacion = (estado >> 60) % 4;
+        if (operacion == 0 && !agregadas.empty()) {
+            gestor.eliminarPelicula(agregadas.back());
+            agregadas.pop_back();
+        } else if (operacion == 1 && !agregadas.empty()) {
+            agregadas.back() = gestor.reemplazarPelicula(agregadas.back(), datos);
+        } else {
+            agregadas.push_back(gestor.agregarPelicula(datos));
         }
+        duraciones.push_back(chrono::duration<double, milli>(chrono::high_resolution_clock::now() - inicio).count());
+    }
+    gestor.esperarCompactacion();
+    const size_t segmentos = gestor.cantidadSegmentos();
+    auto inicioCompactacion = chrono::high_resolution_clock::now();
+    gestor.compactarAhora();
+    const double compactacionMs =
+        chrono::duration<double, milli>(chrono::high_resolution_clock::now() - inicioCompactacion).count();
+    terminar = true;
+    for (auto& lector : lectores) lector.join();
+    cout.rdbuf(salida);
+
+    sort(duraciones.begin(), duraciones.end());
+    double total = 0.0;
+    for (double d : duraciones) total += d;
+    cout << "\n=== BENCHMARK DE ACTUALIZACIONES (" << ACTUALIZACIONES << " con " << LECTORES
+         << " hilos consultando) ===\n";
+    cout << fixed << setprecision(3);
+    cout << "Promedio: " << total / duraciones.size() << " ms, p50: " << duraciones[duraciones.size() / 2]
+         << " ms, p99: " << duraciones[duraciones.size() * 99 / 100] << " ms, máximo: " << duraciones.back() << " ms\n";
+    cout << "Compactación final de " << segmentos << " segmentos: " << compactacionMs << " ms\n";
+    cout << "Consultas durante las actualizaciones: " << consultas << ", la más lenta " << peorConsultaUs << " μs\n";
+    cout << gestor.obtenerEstadisticas();
+}
 
-        // Calcular puntuación para cada película
-        vector<Pelicula*> candidatos;
-        for (const auto& pelicula : gestor.getPeliculas()) {
-            // Excluir películas ya con like
-            if (peliculasLike.count(pelicula.titulo)) continue;
+/**
+ * @brief Comprueba que CodecPostings y CursorPostings devuelvan exactamente lo comprimido
+ *
+ * Comprime listas pseudoaleatorias con bloques parciales, anchos de 0 a 32 bits
+ * y frecuencias de 1 a 65535 (o ninguna). Verifica descomprimir,
+ * descomprimirFrecuencias, ListaPostings::recorrer, el cursor avanzando de a uno
+ * y avanzarHasta contra lower_bound. Cubre la ruta compilada (SSE2 o escalar;
+ * la escalar se prueba compilando con -U__SSE2__). Uso: ./streaming_platform --verificar-codec
+ *
+ * @return true si no hubo diferencias
+ */
+bool verificarCodec() {
+    constexpr uint32_t B = CodecPostings::TAMANO_BLOQUE;
+    uint64_t estado = 12345;
+    auto aleatorio = [&estado]() {
+        estado = estado * 6364136223846793005ULL + 1442695040888963407ULL;
+        return static_cast<uint32_t>(estado >> 32);
+    };
+
+    size_t casos = 0;
+    size_t fallos = 0;
+    auto fallar = [&fallos](const string& caso, const string& detalle) {
+        if (fallos++ < 10) cout << "FALLO " << caso << ": " << detalle << "\n";
+    };
+
+    const uint32_t cantidades[] = {1, 2, 3, 4, 5, 127, 128, 129, 255, 256, 257, 1000, 4099};
+    for (uint32_t cantidad : cantidades) {
+        for (uint32_t anchoSaltos = 0; anchoSaltos <= 32; anchoSaltos += (anchoSaltos < 4 ? 1 : 7)) {
+            for (int modoFrecuencias = 0; modoFrecuencias < 3; ++modoFrecuencias) {
+                // Saltos de hasta 2^anchoSaltos sin pasarse de 32 bits; 0 = IDs consecutivos
+                vector<uint32_t> ids(cantidad);
+                const uint64_t maximo = min<uint64_t>(uint64_t(1) << anchoSaltos,
+                                                      (uint64_t(UINT32_MAX) - cantidad) / cantidad + 1);
+                uint64_t id = anchoSaltos == 32 ? 0 : aleatorio() % 1000;
+                for (uint32_t i = 0; i < cantidad; ++i) {
+                    ids[i] = static_cast<uint32_t>(id);
+                    id += 1 + (anchoSaltos == 0 ? 0 : aleatorio() % maximo);
+                }
+                if (anchoSaltos == 32 && cantidad > 1) ids.back() = UINT32_MAX; // Un salto de 32 bits
+                vector<uint16_t> frecuencias(cantidad, 1);
+                if (modoFrecuencias == 2) {
+                    for (auto& f : frecuencias) f = static_cast<uint16_t>(1 + aleatorio() % 65535);
+                    frecuencias[aleatorio() % cantidad] = 65535;
+                }
+                const uint16_t* origenFrecuencias = modoFrecuencias == 0 ? nullptr : frecuencias.data();
+                const string caso = "df=" + to_string(cantidad) + " saltos<=2^" + to_string(anchoSaltos) +
+                                    " frecuencias=" + to_string(modoFrecuencias);
+                ++casos;
+
+                vector<BloquePostings> bloques;
+                vector<uint32_t> datos;
+                CodecPostings::comprimir(ids.data(), origenFrecuencias, cantidad, bloques, datos);
+                if (bloques.size() != (cantidad + B - 1) / B) {
+                    fallar(caso, "cantidad de bloques");
+                    continue;
+                }
 
-            double puntuacion = 0.0;
-            for (const auto& tag : pelicula.tags) {
-                if (tagsPopulares.count(tag)) {
-                    puntuacion += tagsPopulares[tag];
+                // Bloque a bloque: IDs, frecuencias y frecuencias solas
+                alignas(16) uint32_t bufferIds[B];
+                uint16_t bufferFrecuencias[B];
+                uint16_t soloFrecuencias[B];
+                for (uint32_t b = 0; b < bloques.size(); ++b) {
+                    const uint32_t inicio = b * B;
+                    const uint32_t n = min(B, cantidad - inicio);
+                    if (bloques[b].primerId != ids[inicio]) fallar(caso, "primerId del bloque " + to_string(b));
+                    CodecPostings::descomprimir(bloques[b], datos.data(), n, bufferIds, bufferFrecuencias);
+                    CodecPostings::descomprimirFrecuencias(bloques[b], datos.data(), n, soloFrecuencias);
+                    if (!equal(bufferIds, bufferIds + n, ids.begin() + inicio)) {
+                        fallar(caso, "IDs del bloque " + to_string(b));
+                    }
+                    if (!equal(bufferFrecuencias, bufferFrecuencias + n, frecuencias.begin() + inicio) ||
+                        !equal(soloFrecuencias, soloFrecuencias + n, frecuencias.begin() + inicio)) {
+                        fallar(caso, "frecuencias del bloque " + to_string(b));
+                    }
                 }
-            }
 
-            if (puntuacion > 0) {
-                const_cast<Pelicula&>(pelicula).relevancia = puntuacion;
-                candidatos.push_back(const_cast<Pelicula*>(&pelicula));
+                const ListaPostings lista = ListaPostings::comprimida(bloques.data(), datos.data(), cantidad);
+                vector<uint32_t> recorridos;
+                vector<uint16_t> frecuenciasRecorridas;
+                lista.recorrer([&](const uint32_t* tramo, const uint16_t* f, uint32_t n) {
+                    recorridos.insert(recorridos.end(), tramo, tramo + n);
+                    frecuenciasRecorridas.insert(frecuenciasRecorridas.end(), f, f + n);
+                });
+                if (recorridos != ids || frecuenciasRecorridas != frecuencias) fallar(caso, "recorrer");
+
+                CursorPostings cursor(lista);
+                for (uint32_t i = 0; i < cantidad; ++i, cursor.avanzar()) {
+                    if (cursor.terminado() || cursor.id() != ids[i] || cursor.frecuencia() != frecuencias[i] ||
+                        cursor.posicion() != i) {
+                        fallar(caso, "cursor en la posición " + to_string(i));
+                        break;
+                    }
+                }
+                if (!cursor.terminado()) fallar(caso, "el cursor no termina");
+
+                // Saltos crecientes: a IDs presentes, entre IDs, a primeros de bloque y más allá del último
+                for (int ronda = 0; ronda < 4; ++ronda) {
+                    CursorPostings saltos(lista);
+                    uint64_t objetivo = ids[0] > 0 ? ids[0] - 1 : 0;
+                    while (objetivo <= UINT32_MAX) {
+                        const auto esperado = lower_bound(ids.begin(), ids.end(), static_cast<uint32_t>(objetivo));
+                        const bool hay = saltos.avanzarHasta(static_cast<uint32_t>(objetivo));
+                        if (hay != (esperado != ids.end()) ||
+                            (hay && (saltos.id() != *esperado ||
+                                     saltos.posicion() != static_cast<uint32_t>(esperado - ids.begin()) ||
+                                     saltos.frecuencia() != frecuencias[esperado - ids.begin()]))) {
+                            fallar(caso, "avanzarHasta(" + to_string(objetivo) + ")");
+                            break;
+                        }
+                        if (!hay) break;
+                        const size_t actual = static_cast<size_t>(esperado - ids.begin());
+                        const size_t distancia = size_t(1) << (aleatorio() % (ronda == 0 ? 1 : 4 * ronda));
+                        switch (aleatorio() % 3) {
+                            case 0: // Un ID presente más adelante
+                                objetivo = ids[min(ids.size() - 1, actual + distancia)];
+                                break;
+                            case 1: // El primero de un bloque posterior
+                                objetivo = ids[min(ids.size() - 1, (actual / B + 1 + aleatorio() % 2) * B)];
+                                break;
+                            default: // Entre dos IDs, o más allá del último
+                                objetivo = actual + distancia < ids.size() ? ids[actual + distancia] - 1
+                                                                          : uint64_t(ids.back()) + 1;
+                                break;
+                        }
+                        objetivo = max<uint64_t>(objetivo, saltos.id());
+                    }
+                }
             }
         }
+    }
 
-        // Ordenar por puntuación
-        sort(candidatos.begin(), candidatos.end(), [](const Pelicula* a, const Pelicula* b) {
-            return a->relevancia > b->relevancia;
-        });
+    cout << "\n=== VERIFICACIÓN DEL CODEC DE POSTINGS ===\n";
+#if defined(__SSE2__) || defined(_M_X64)
+    cout << "Ruta: SSE2\n";
+#else
+    cout << "Ruta: escalar\n";
+#endif
+    cout << casos << " listas, " << fallos << " fallos\n";
+    return fallos == 0;
+}
 
-        return candidatos;
+/**
+ * @brief Comprueba que partir el catálogo en segmentos no cambie ningún puntaje
+ *
+ * Agrega una copia de cada película con una política que nunca fusiona, así
+ * que quedan decenas de segmentos, y guarda los resultados de consultas por
+ * prefijo, booleanas, frases y buscarPorTituloOSinopsis. Después compactarAhora
+ * deja un solo segmento y las mismas consultas deben dar los mismos puntajes
+ * (con tolerancia de redondeo: el orden de las sumas cambia). Copiar todo el
+ * catálogo no mueve los promedios de longitud, que solo se recalculan al
+ * fusionar. No hay bajas, que dejan de contar en la frecuencia documental al
+ * compactar. La difusa queda fuera porque su presupuesto de nodos es por Trie.
+ * Uso: ./streaming_platform --verificar-segmentos data.csv
+ *
+ * @return true si no hubo diferencias
+ */
+bool verificarSegmentos(const string& nombreArchivo) {
+    GestorPeliculas gestor(nombreArchivo, false, 0, false);
+    const CatalogoPeliculas catalogo = gestor.getCatalogo();
+    if (catalogo.size() == 0) return false;
+    gestor.configurarCache(0);
+    PoliticaSegmentos politica;
+    politica.peliculasDelta = 1024;
+    politica.segmentosPorNivel = numeric_limits<uint32_t>::max();
+    gestor.configurarSegmentos(politica);
+
+    uint64_t estado = 12345;
+    auto aleatorio = [&estado](size_t n) {
+        estado = estado * 6364136223846793005ULL + 1442695040888963407ULL;
+        return static_cast<uint32_t>((estado >> 20) % n);
+    };
+    vector<string> consultas;
+    for (uint32_t i = 0; i < catalogo.size(); ++i) {
+        const Pelicula original = catalogo.obtener(i);
+        DatosPelicula datos{string(original.titulo), string(original.sinopsis), {},
+                            string(original.split), string(original.fuente_sinopsis)};
+        for (IdTag tag : original.tags) datos.tags.emplace_back(catalogo.nombreTag(tag));
+        gestor.agregarPelicula(datos);
+        if (i % 50 != 0) continue;
+
+        istringstream palabras(datos.sinopsis);
+        vector<string> sinopsis;
+        for (string palabra; palabras >> palabra;) sinopsis.push_back(palabra);
+        if (sinopsis.size() < 3) continue;
+        const size_t j = aleatorio(sinopsis.size() - 2);
+        const string& a = sinopsis[j];
+        const string& b = sinopsis[j + 1];
+        consultas.push_back(a);
+        consultas.push_back(a.substr(0, 2));
+        consultas.push_back(datos.titulo);
+        consultas.push_back(a + " " + sinopsis[j + 2]);
+        consultas.push_back(a + " -" + b);
+        consultas.push_back(a + " OR " + b);
+        consultas.push_back("\"" + a + " " + b + "\"");
     }
-};
+    gestor.esperarCompactacion();
+    const size_t segmentos = gestor.cantidadSegmentos();
+
+    constexpr size_t K = 20;
+    streambuf* salida = cout.rdbuf(nullptr); // buscar imprime el tiempo de cada consulta
+    auto ejecutar = [&]() {
+        vector<ResultadosBusqueda> resultados;
+        for (const auto& consulta : consultas) {
+            resultados.push_back(gestor.buscar(consulta, K));
+            ResultadosBusqueda todos = gestor.buscarPorTituloOSinopsis(consulta.substr(0, consulta.find(' ')));
+            EvaluadorTopK::seleccionarMejores(todos, K);
+            resultados.push_back(move(todos));
+        }
+        return resultados;
+    };
+    const vector<ResultadosBusqueda> enSegmentos = ejecutar();
+    gestor.compactarAhora();
+    const vector<ResultadosBusqueda> enUno = ejecutar();
+    cout.rdbuf(salida);
+
+    size_t fallos = 0;
+    auto fallar = [&fallos](const string& consulta, const string& detalle) {
+        if (fallos++ < 10) cout << "FALLO \"" << consulta << "\": " << detalle << "\n";
+    };
+    for (size_t i = 0; i < enUno.size(); ++i) {
+        const string& consulta = consultas[i / 2];
+        const ResultadosBusqueda& a = enSegmentos[i];
+        const ResultadosBusqueda& b = enUno[i];
+        if (a.size() != b.size()) {
+            fallar(consulta, to_string(a.size()) + " resultados vs " + to_string(b.size()));
+            continue;
+        }
+        // Con empates el ID puede variar; el puntaje de cada posición no
+        for (size_t r = 0; r < a.size(); ++r) {
+            if (fabs(a[r].puntuacion - b[r].puntuacion) > 1e-9 * max(1.0, fabs(b[r].puntuacion))) {
+                fallar(consulta, "posición " + to_string(r) + ": " + to_string(a[r].puntuacion) + " vs " +
+                                 to_string(b[r].puntuacion));
+                break;
+            }
+        }
+    }
+
+    cout << "\n=== VERIFICACIÓN DE SEGMENTOS ===\n";
+    cout << consultas.size() << " consultas con " << segmentos << " segmentos y con " << gestor.cantidadSegmentos()
+         << ", " << fallos << " fallos\n";
+    return fallos == 0;
+}
 
 /**
  * @brief Función principal con manejo de excepciones y ejemplos de uso
@@ -839,11 +8906,11 @@ private:
  *
  * 2. Búsqueda por tag:
  *    - Buscar "horror" encontrará todas las películas de terror
- *    - Complejidad: O(1) acceso promedio
+ *    - Complejidad: O(C + r), C = contenedores del bitmap del tag, r = películas con el tag
  *
  * 3. Sistema de recomendaciones:
  *    - Basado en tags de películas con like
- *    - Utiliza puntuación ponderada
+ *    - Utiliza puntuación ponderada por idf del tag
  *
  * 4. Procesamiento concurrente:
  *    - Indexación paralela usando todos los cores disponibles
@@ -854,31 +8921,55 @@ private:
  * - Carga inicial: O(n * m) donde n = número de películas, m = tamaño promedio de texto
  * - Inserción en Trie: O(m) donde m = longitud de la palabra
  * - Búsqueda en Trie: O(m + k) donde m = longitud del prefijo, k = número de resultados
- * - Búsqueda por tag: O(1) promedio
+ * - Búsqueda por tag: O(C + r) recorriendo el bitmap del tag
+ * - Expresión de tags: O(C + Σ min(|a|, |b|)) con operaciones entre bitmaps
  * - Ordenamiento de resultados: O(k log k) donde k = número de resultados
- * - Generación de recomendaciones: O(n * m) donde n = películas, m = tags promedio
+ * - Generación de recomendaciones: O(L × t + P + c log k) donde L = películas con like,
+ *   t = tags por película, P = postings de esos tags, c = candidatos
  *
  * OPTIMIZACIONES IMPLEMENTADAS:
  *
  * 1. Trie para búsquedas por prefijo O(m) vs O(n*m) en búsqueda lineal
- * 2. Hash maps para búsquedas por tag O(1) vs O(n)
+ * 2. Bitmaps comprimidos por tag (BitmapIds) en vez de recorrer el catálogo
  * 3. Indexación concurrente para reducir tiempo de carga
  * 4. Búsquedas paralelas en múltiples índices
- * 5. Sistema de puntuación TF-IDF para ranking de relevancia
- * 6. Cache implícito a través de índices pre-computados
+ * 5. Sistema de puntuación BM25 (estadísticas precalculadas) para ranking de relevancia
+ * 6. Caché de resultados (CacheResultados): LRU por fragmentos con admisión TinyLFU
  */
-int main() {
+int main(int argc, char* argv[]) {
     try {
+        if (argc >= 3 && string(argv[1]) == "--bench-indexacion") {
+            ejecutarBenchmarkIndexacion(argv[2]);
+            return 0;
+        }
+        if (argc >= 3 && string(argv[1]) == "--bench-lote") {
+            ejecutarBenchmarkLote(argv[2]);
+            return 0;
+        }
+        if (argc >= 3 && string(argv[1]) == "--bench-actualizaciones") {
+            ejecutarBenchmarkActualizaciones(argv[2]);
+            return 0;
+        }
+        if (argc >= 2 && string(argv[1]) == "--verificar-codec") {
+            return verificarCodec() ? 0 : 1;
+        }
+        if (argc >= 3 && string(argv[1]) == "--verificar-segmentos") {
+            return verificarSegmentos(argv[2]) ? 0 : 1;
+        }
+
         // Ejemplo de uso básico
         cout << "=== PLATAFORMA DE STREAMING - EJEMPLO DE USO ===\n\n";
         cout << "Funcionalidades implementadas:\n";
         cout << "✓ Búsqueda por prefijos usando Trie (O(m + k))\n";
-        cout << "✓ Búsqueda por tags usando hash maps (O(1))\n";
-        cout << "✓ Sistema de puntuación TF-IDF para ranking\n";
+        cout << "✓ Búsqueda por tags con bitmaps comprimidos (AND/OR/NOT)\n";
+        cout << "✓ Sistema de puntuación BM25 para ranking\n";
         cout << "✓ Indexación concurrente para mejor rendimiento\n";
+        cout << "✓ Imagen binaria del índice para arranques sin reindexar\n";
         cout << "✓ Programación genérica con templates\n";
         cout << "✓ Interfaz de usuario mejorada con paginación\n";
         cout << "✓ Sistema de recomendaciones basado en tags\n";
+        cout << "✓ Películas similares por sinopsis (TF-IDF + MinHash-LSH)\n";
+        cout << "✓ Altas, reemplazos y bajas de películas sin reindexar\n";
         cout << "✓ Manejo robusto de errores y archivos\n\n";
 
         // Inicializar el sistema
@@ -897,9 +8988,9 @@ int main() {
         if (!resultados.empty()) {
             cout << "Primeros 3 resultados:\n";
             for (size_t i = 0; i < min(size_t(3), resultados.size()); ++i) {
-                cout << "  " << i + 1 << ". " << resultados[i]->titulo
+                cout << "  " << i + 1 << ". " << gestor.obtenerPelicula(resultados[i].id).titulo
                      << " (Relevancia: " << fixed << setprecision(2)
-                     << resultados[i]->relevancia << ")\n";
+                     << resultados[i].puntuacion << ")\n";
             }
         }
 